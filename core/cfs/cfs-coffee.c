@@ -90,6 +90,61 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING	1
 #endif
 
+/*
+ * Keep an index from file name hashes to file pages in RAM, so that
+ * opening a file does not require a scan of all file headers. The
+ * index is built by one scan when the file system is first used. If
+ * there are more files than index entries, lookups that miss the
+ * index fall back to scanning. Set to 0 to disable the index.
+ */
+#ifndef COFFEE_INDEX_SIZE
+#define COFFEE_INDEX_SIZE	0
+#endif
+
+/*
+ * Keep the number of free pages at the end of each sector in RAM, so
+ * that reserving pages for a new file does not require reading
+ * headers from the storage.
+ */
+#ifndef COFFEE_FREE_MAP
+#define COFFEE_FREE_MAP		0
+#endif
+
+#define COFFEE_INDEXING		(COFFEE_INDEX_SIZE > 0 || COFFEE_FREE_MAP)
+
+/*
+ * Erase obsolete sectors from a background process, one sector per
+ * slice, when the number of free pages drops below the low watermark.
+ * The process continues until the high watermark is reached, so that
+ * reserve() seldom has to collect garbage synchronously. Sectors that
+ * have been erased fewer times are collected first. The process only
+ * reads the sector headers after a file has been reserved or removed,
+ * so an idle file system is not scanned.
+ *
+ * The erase counts are kept in RAM, so the levelling only covers the
+ * time since the system was started.
+ */
+#ifndef COFFEE_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC	0
+#endif
+
+#ifndef COFFEE_GC_INTERVAL
+#define COFFEE_GC_INTERVAL	(10 * CLOCK_SECOND)
+#endif
+
+#ifndef COFFEE_GC_LOW_WATERMARK
+#define COFFEE_GC_LOW_WATERMARK		(COFFEE_PAGE_COUNT / 4)
+#endif
+
+#ifndef COFFEE_GC_HIGH_WATERMARK
+#define COFFEE_GC_HIGH_WATERMARK	(COFFEE_PAGE_COUNT / 2)
+#endif
+
+#if COFFEE_BACKGROUND_GC
+#include "sys/process.h"
+#include "sys/etimer.h"
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -193,6 +248,17 @@ struct file_header {
   char name[COFFEE_NAME_LENGTH];
 };
 
+#if COFFEE_INDEX_SIZE > 0
+/* An entry in the in-RAM file index. */
+struct index_entry {
+  uint16_t hash;
+  coffee_page_t page;
+};
+#endif /* COFFEE_INDEX_SIZE > 0 */
+
+#define INDEX_VALID		0x1	/* The index has been built. */
+#define INDEX_COMPLETE		0x2	/* All files are in the index. */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -211,11 +277,50 @@ static struct protected_mem_t {
   struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
   coffee_page_t next_free;
   char gc_wait;
+#if COFFEE_INDEXING
+  uint8_t index_flags;
+#endif
+#if COFFEE_INDEX_SIZE > 0
+  uint16_t index_count;
+  struct index_entry index[COFFEE_INDEX_SIZE];
+#endif
+#if COFFEE_FREE_MAP
+  coffee_page_t sector_free[COFFEE_SECTOR_COUNT];
+#endif
 } protected_mem;
 static struct file * const coffee_files = protected_mem.coffee_files;
 static struct file_desc * const coffee_fd_set = protected_mem.coffee_fd_set;
 static coffee_page_t * const next_free = &protected_mem.next_free;
 static char * const gc_wait = &protected_mem.gc_wait;
+#if COFFEE_INDEXING
+static uint8_t * const index_flags = &protected_mem.index_flags;
+#endif
+#if COFFEE_INDEX_SIZE > 0
+static uint16_t * const index_count = &protected_mem.index_count;
+static struct index_entry * const file_index = protected_mem.index;
+#endif
+#if COFFEE_FREE_MAP
+static coffee_page_t * const sector_free = protected_mem.sector_free;
+#endif
+
+/* The number of times each sector has been erased since boot. The
+   counts are not stored, so they start from zero after a reboot. */
+static uint16_t erase_count[COFFEE_SECTOR_COUNT];
+
+#if COFFEE_BACKGROUND_GC
+PROCESS(coffee_gc_process, "Coffee GC");
+
+/* Set when pages have been reserved or made obsolete since the last
+   scan. The first scan after boot is always made. */
+static uint8_t gc_dirty = 1;
+
+static void
+gc_notify(void)
+{
+  gc_dirty = 1;
+  process_poll(&coffee_gc_process);
+}
+#endif
 
 /*---------------------------------------------------------------------------*/
 static void
@@ -360,6 +465,30 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
   PRINTF("Coffee: Isolated %u pages starting in sector %d\n",
          (unsigned)skip_pages, (int)start / COFFEE_PAGES_PER_SECTOR);
 
+}
+/*---------------------------------------------------------------------------*/
+static void
+erase_sector(uint16_t sector, coffee_page_t isolation_count)
+{
+  coffee_page_t first_page;
+
+  first_page = sector * COFFEE_PAGES_PER_SECTOR;
+  if(first_page < *next_free) {
+    *next_free = first_page;
+  }
+
+  if(isolation_count > 0) {
+    isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+  }
+
+  COFFEE_ERASE(sector);
+  erase_count[sector]++;
+  PRINTF("Coffee: Erased sector %d!\n", sector);
+#if COFFEE_INDEXING
+  /* Erasing a sector can expose free pages that are not at the
+     end of a sector, so the index is rebuilt on its next use. */
+  *index_flags &= ~INDEX_VALID;
+#endif
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -367,7 +496,7 @@ collect_garbage(int mode)
 {
   uint16_t sector;
   struct sector_status stats;
-  coffee_page_t first_page, isolation_count;
+  coffee_page_t isolation_count;
 
   PRINTF("Coffee: Running the file system garbage collector in %s mode\n",
 	 mode == GC_RELUCTANT ? "reluctant" : "greedy");
@@ -387,22 +516,54 @@ collect_garbage(int mode)
 
     if((mode == GC_RELUCTANT && stats.free == 0) ||
        (mode == GC_GREEDY && stats.obsolete > 0)) {
-      first_page = sector * COFFEE_PAGES_PER_SECTOR;
-      if(first_page < *next_free) {
-        *next_free = first_page;
-      }
+      erase_sector(sector, isolation_count);
 
-      if(isolation_count > 0) {
-        isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+      if(mode == GC_RELUCTANT && isolation_count > 0) {
+        break;
       }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sum_sector_status(struct cfs_coffee_stats *total, int *victim,
+		  coffee_page_t *victim_isolation)
+{
+  uint16_t sector;
+  struct sector_status stats;
+  coffee_page_t isolation_count, victim_free;
 
-      COFFEE_ERASE(sector);
-      PRINTF("Coffee: Erased sector %d!\n", sector);
+  /*
+   * Sum up the page states of all sectors and select the erasable
+   * sector that has been erased the fewest times. Sectors with only
+   * obsolete pages are preferred since erasing them does not waste
+   * any free pages.
+   */
+  memset(total, 0, sizeof(*total));
+  *victim = -1;
+  *victim_isolation = victim_free = 0;
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    isolation_count = get_sector_status(sector, &stats);
+    total->active += stats.active;
+    total->obsolete += stats.obsolete;
+    total->free += stats.free;
+    total->erases += erase_count[sector];
 
-      if(mode == GC_RELUCTANT && isolation_count > 0) {
-        break;
+    if(stats.active > 0 || stats.obsolete == 0) {
+      continue;
+    }
+    if(*victim >= 0) {
+      if(stats.free > 0 && victim_free == 0) {
+	continue;
+      }
+      if((stats.free > 0) == (victim_free > 0) &&
+	 erase_count[sector] >= erase_count[*victim]) {
+	continue;
       }
     }
+    *victim = sector;
+    *victim_isolation = isolation_count;
+    victim_free = stats.free;
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -427,6 +588,144 @@ next_file(coffee_page_t page, struct file_header *hdr)
   return page + hdr->max_pages;    
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_INDEX_SIZE > 0
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  hash = 0;
+  for(i = 0; i < COFFEE_NAME_LENGTH && name[i] != '\0'; i++) {
+    hash = (hash << 3) + (hash >> 13) + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(coffee_page_t page, struct file_header *hdr)
+{
+  if(*index_count == COFFEE_INDEX_SIZE) {
+    *index_flags &= ~INDEX_COMPLETE;
+    return;
+  }
+  file_index[*index_count].hash = name_hash(hdr->name);
+  file_index[*index_count].page = page;
+  ++*index_count;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < *index_count; i++) {
+    if(file_index[i].page == page) {
+      file_index[i] = file_index[--*index_count];
+      return;
+    }
+  }
+}
+#endif /* COFFEE_INDEX_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
+#if COFFEE_FREE_MAP
+static void
+free_map_allocate(coffee_page_t start, coffee_page_t amount)
+{
+  coffee_page_t end, sector_end;
+  uint16_t sector;
+
+  end = start + amount;
+  for(sector = start / COFFEE_PAGES_PER_SECTOR;
+      sector * COFFEE_PAGES_PER_SECTOR < end;
+      sector++) {
+    sector_end = (sector + 1) * COFFEE_PAGES_PER_SECTOR;
+    sector_free[sector] = end < sector_end ? sector_end - end : 0;
+  }
+}
+#endif /* COFFEE_FREE_MAP */
+/*---------------------------------------------------------------------------*/
+#if COFFEE_INDEXING
+/*
+ * Build the file index and the free map with one scan of the file
+ * headers. This is also the recovery path if an index entry turns
+ * out to be stale.
+ */
+static void
+index_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+
+  PRINTF("Coffee: Building the file index\n");
+
+  *index_flags = INDEX_VALID | INDEX_COMPLETE;
+#if COFFEE_INDEX_SIZE > 0
+  *index_count = 0;
+#endif
+#if COFFEE_FREE_MAP
+  memset(sector_free, 0, sizeof(protected_mem.sector_free));
+#endif
+
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_FREE(hdr)) {
+#if COFFEE_FREE_MAP
+      /* Only the end of a sector can be free. */
+      sector_free[page / COFFEE_PAGES_PER_SECTOR] =
+	COFFEE_PAGES_PER_SECTOR - page % COFFEE_PAGES_PER_SECTOR;
+#endif
+#if COFFEE_INDEX_SIZE > 0
+    } else if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      index_add(page, &hdr);
+#endif
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_check(void)
+{
+  if(!(*index_flags & INDEX_VALID)) {
+    index_build();
+  }
+}
+#endif /* COFFEE_INDEXING */
+/*---------------------------------------------------------------------------*/
+#if COFFEE_INDEX_SIZE > 0
+static coffee_page_t
+index_lookup(const char *name, struct file_header *hdr)
+{
+  uint16_t hash;
+  int i, attempt;
+
+  hash = name_hash(name);
+  for(attempt = 0; attempt < 2; attempt++) {
+    index_check();
+    for(i = 0; i < *index_count; i++) {
+      if(file_index[i].hash != hash) {
+	continue;
+      }
+      read_header(hdr, file_index[i].page);
+      if(!HDR_ACTIVE(*hdr) || HDR_LOG(*hdr)) {
+	/* The index does not match the storage; rebuild it. */
+	PRINTF("Coffee: Stale index entry for page %u\n",
+	       (unsigned)file_index[i].page);
+	*index_flags = 0;
+	break;
+      }
+      if(strcmp(name, hdr->name) == 0) {
+	return file_index[i].page;
+      }
+    }
+    if(*index_flags & INDEX_VALID) {
+      break;
+    }
+  }
+  return INVALID_PAGE;
+}
+#endif /* COFFEE_INDEX_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
 static struct file *
 load_file(coffee_page_t start, struct file_header *hdr)
 {
@@ -476,6 +775,21 @@ find_file(const char *name)
   struct file_header hdr;
   coffee_page_t page;
   
+#if COFFEE_INDEX_SIZE > 0
+  page = index_lookup(name, &hdr);
+  if(page != INVALID_PAGE) {
+    for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
+      if(!FILE_FREE(&coffee_files[i]) && coffee_files[i].page == page) {
+	return &coffee_files[i];
+      }
+    }
+    return load_file(page, &hdr);
+  }
+  if(*index_flags & INDEX_COMPLETE) {
+    return NULL;
+  }
+#endif /* COFFEE_INDEX_SIZE > 0 */
+
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
     if(FILE_FREE(&coffee_files[i])) {
@@ -533,12 +847,69 @@ file_end(coffee_page_t start)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_FREE_MAP
+static coffee_page_t
+free_map_find(coffee_page_t amount)
+{
+  coffee_page_t start, first_free, sector_start;
+  uint16_t sector;
+
+  /* Only the end of a sector can be free, so a run of free pages
+     is the free end of one sector followed by completely free
+     sectors. */
+  start = INVALID_PAGE;
+  for(sector = *next_free / COFFEE_PAGES_PER_SECTOR;
+      sector < COFFEE_SECTOR_COUNT;
+      sector++) {
+    if(sector_free[sector] == 0) {
+      start = INVALID_PAGE;
+      continue;
+    }
+    sector_start = sector * COFFEE_PAGES_PER_SECTOR;
+    first_free = sector_start + COFFEE_PAGES_PER_SECTOR - sector_free[sector];
+    if(first_free < *next_free) {
+      first_free = *next_free;
+    }
+    if(start == INVALID_PAGE || first_free != sector_start) {
+      start = first_free;
+      if(start + amount >= COFFEE_PAGE_COUNT) {
+	/* We can stop immediately if the remaining pages are not enough. */
+	break;
+      }
+    }
+    if(start + amount <= sector_start + COFFEE_PAGES_PER_SECTOR) {
+      return start;
+    }
+  }
+  return INVALID_PAGE;
+}
+#endif /* COFFEE_FREE_MAP */
+/*---------------------------------------------------------------------------*/
 static coffee_page_t
 find_contiguous_pages(coffee_page_t amount)
 {
-  coffee_page_t page, start;
+  coffee_page_t start;
   struct file_header hdr;
 
+#if COFFEE_FREE_MAP
+  index_check();
+  start = free_map_find(amount);
+  if(start != INVALID_PAGE) {
+    read_header(&hdr, start);
+    if(!HDR_FREE(hdr)) {
+      /* The free map does not match the storage; rebuild it. */
+      PRINTF("Coffee: Stale free map at page %u\n", (unsigned)start);
+      index_build();
+      start = free_map_find(amount);
+    }
+  }
+  if(start != INVALID_PAGE && start == *next_free) {
+    *next_free = start + amount;
+  }
+  return start;
+#else /* COFFEE_FREE_MAP */
+  coffee_page_t page;
+
   start = INVALID_PAGE;
   for(page = *next_free; page < COFFEE_PAGE_COUNT;) {
     read_header(&hdr, page);
@@ -567,6 +938,7 @@ find_contiguous_pages(coffee_page_t amount)
     }
   }
   return INVALID_PAGE;
+#endif /* COFFEE_FREE_MAP */
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -589,8 +961,14 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
 
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
+#if COFFEE_INDEX_SIZE > 0
+  index_remove(page);
+#endif
 
   *gc_wait = 0;
+#if COFFEE_BACKGROUND_GC
+  gc_notify();
+#endif
 
   /* Close all file descriptors that reference the removed file. */
   if(close_fds) {
@@ -637,6 +1015,12 @@ reserve(const char *name, coffee_page_t pages,
     return NULL;
   }
 
+#if COFFEE_BACKGROUND_GC
+  if(!process_is_running(&coffee_gc_process)) {
+    process_start(&coffee_gc_process, NULL);
+  }
+#endif
+
   page = find_contiguous_pages(pages);
   if(page == INVALID_PAGE) {
     if(*gc_wait) {
@@ -655,6 +1039,18 @@ reserve(const char *name, coffee_page_t pages,
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
+#if COFFEE_FREE_MAP
+  free_map_allocate(page, pages);
+#endif
+#if COFFEE_INDEX_SIZE > 0
+  if(!(flags & HDR_FLAG_LOG)) {
+    index_add(page, &hdr);
+  }
+#endif
+
+#if COFFEE_BACKGROUND_GC
+  gc_notify();
+#endif
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
       pages, page, name);
@@ -1260,6 +1656,26 @@ cfs_readdir(struct cfs_dir *dir, struct cfs_dirent *record)
 
   memcpy(&page, dir->dummy_space, sizeof(coffee_page_t));
 
+#if COFFEE_INDEX_SIZE > 0
+  /* If all files are indexed, jump directly to the next file. */
+  index_check();
+  if(*index_flags & INDEX_COMPLETE) {
+    coffee_page_t next_page;
+    int i;
+
+    next_page = COFFEE_PAGE_COUNT;
+    for(i = 0; i < *index_count; i++) {
+      if(file_index[i].page >= page && file_index[i].page < next_page) {
+	next_page = file_index[i].page;
+      }
+    }
+    if(next_page == COFFEE_PAGE_COUNT) {
+      return -1;
+    }
+    page = next_page;
+  }
+#endif /* COFFEE_INDEX_SIZE > 0 */
+
   while(page < COFFEE_PAGE_COUNT) {
     read_header(&hdr, page);
     if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
@@ -1351,14 +1767,88 @@ cfs_coffee_format(void)
   /* Formatting invalidates the file information. */
   memset(&protected_mem, 0, sizeof(protected_mem));
 
+#if COFFEE_INDEXING
+  /* The file system is empty, so there is no need to scan it. */
+  *index_flags = INDEX_VALID | INDEX_COMPLETE;
+#endif
+#if COFFEE_FREE_MAP
+  for(i = 0; i < COFFEE_SECTOR_COUNT; i++) {
+    sector_free[i] = COFFEE_PAGES_PER_SECTOR;
+  }
+#endif
+
   PRINTF(" done!\n");
 
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+int
+cfs_coffee_get_stats(struct cfs_coffee_stats *stats)
+{
+  int sector;
+  coffee_page_t isolation_count;
+
+  sum_sector_status(stats, &sector, &isolation_count);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+unsigned
+cfs_coffee_sector_erases(unsigned sector)
+{
+  if(sector >= COFFEE_SECTOR_COUNT) {
+    return 0;
+  }
+  return erase_count[sector];
+}
+/*---------------------------------------------------------------------------*/
 void *
 cfs_coffee_get_protected_mem(unsigned *size)
 {
   *size = sizeof(protected_mem);
   return &protected_mem;
 }
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  static struct etimer et;
+  struct cfs_coffee_stats stats;
+  int sector;
+  coffee_page_t isolation_count;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    /* Sleep until the file system has changed, and then wait for one
+       interval so that a burst of changes leads to a single scan. */
+    PROCESS_WAIT_UNTIL(gc_dirty);
+    etimer_set(&et, COFFEE_GC_INTERVAL);
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && data == &et);
+    gc_dirty = 0;
+
+    sum_sector_status(&stats, &sector, &isolation_count);
+    if(stats.free >= COFFEE_GC_LOW_WATERMARK) {
+      continue;
+    }
+
+    /* Erase one sector per slice, and only when no other events are
+       pending, until the high watermark has been reached. */
+    while(1) {
+      PROCESS_PAUSE();
+      if(process_nevents() > 0) {
+	continue;
+      }
+
+      sum_sector_status(&stats, &sector, &isolation_count);
+      if(sector < 0 || stats.free >= COFFEE_GC_HIGH_WATERMARK) {
+	break;
+      }
+      PRINTF("Coffee: Background GC of sector %d (%u free pages)\n",
+	     sector, stats.free);
+      erase_sector(sector, isolation_count);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* COFFEE_BACKGROUND_GC */
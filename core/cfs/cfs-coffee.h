@@ -126,6 +126,40 @@ int cfs_coffee_set_io_semantics(int fd, unsigned flags);
  */
 int cfs_coffee_format(void);
 
+/**
+ * The page and erase statistics of the storage assigned to Coffee,
+ * as returned by cfs_coffee_get_stats().
+ */
+struct cfs_coffee_stats {
+  unsigned active;
+  unsigned obsolete;
+  unsigned free;
+  unsigned long erases;
+};
+
+/**
+ * \brief Get page and erase statistics for the file system.
+ * \param stats A pointer to a structure that is filled in.
+ * \return 0 on success, -1 on failure.
+ *
+ * The statistics are computed by reading the file headers. Obsolete
+ * pages can be reclaimed by the garbage collector, but only in sectors
+ * that have no active pages. The erase count covers the time since
+ * the system was started.
+ */
+int cfs_coffee_get_stats(struct cfs_coffee_stats *stats);
+
+/**
+ * \brief Get the number of times a sector has been erased.
+ * \param sector The sector number, counted from the start of Coffee.
+ * \return The number of erase operations since the system was started.
+ *
+ * The counts are kept in RAM and are not stored in the file system, so
+ * the wear levelling of the background garbage collector only takes
+ * the erases made since the last reboot into account.
+ */
+unsigned cfs_coffee_sector_erases(unsigned sector);
+
 /**
  * \brief Points out a memory region that may not be altered during
  * checkpointing operations that use the file system.
@@ -71,6 +71,10 @@
 void
 cc2420_aes_set_key(const uint8_t *key, int index)
 {
+  int s;
+
+  cc2420_lock();
+  s = splhigh();
   switch(index) {
   case 0:
     CC2420_WRITE_RAM_REV(key, CC2420RAM_KEY0, KEYLEN);
@@ -79,31 +83,44 @@ cc2420_aes_set_key(const uint8_t *key, int index)
     CC2420_WRITE_RAM_REV(key, CC2420RAM_KEY1, KEYLEN);
     break;
   }
+  splx(s);
+  cc2420_unlock();
+}
+/*---------------------------------------------------------------------------*/
+static void
+wait_for_encryption(void)
+{
+  uint8_t status;
+
+  do {
+    CC2420_GET_STATUS(status);
+  } while(status & BV(CC2420_ENC_BUSY));
 }
 /*---------------------------------------------------------------------------*/
 /* Encrypt at most 16 bytes of data. */
 static void
 cipher16(uint8_t *data, int len)
 {
-  uint8_t status;
+  int s;
 
   len = MIN(len, MAX_DATALEN);
 
+  s = splhigh();
   CC2420_WRITE_RAM(data, CC2420RAM_SABUF, len);
   CC2420_STROBE(CC2420_SAES);
   /* Wait for the encryption to finish */
-  do {
-    CC2420_GET_STATUS(status);
-  } while(status & BV(CC2420_ENC_BUSY));
+  wait_for_encryption();
   CC2420_READ_RAM(data, CC2420RAM_SABUF, len);
+  splx(s);
 }
 /*---------------------------------------------------------------------------*/
-void
-cc2420_aes_cipher(uint8_t *data, int len, int key_index)
+static void
+select_key(int key_index)
 {
-  int i;
   uint16_t secctrl0;
+  int s;
 
+  s = splhigh();
   CC2420_READ_REG(CC2420_SECCTRL0, secctrl0);
 
   secctrl0 &= ~(CC2420_SECCTRL0_SAKEYSEL0 | CC2420_SECCTRL0_SAKEYSEL1);
@@ -117,9 +134,68 @@ cc2420_aes_cipher(uint8_t *data, int len, int key_index)
     break;
   }
   CC2420_WRITE_REG(CC2420_SECCTRL0, secctrl0);
+  splx(s);
+}
+/*---------------------------------------------------------------------------*/
+void
+cc2420_aes_cipher(uint8_t *data, int len, int key_index)
+{
+  int i;
+
+  cc2420_lock();
+  select_key(key_index);
 
   for(i = 0; i < len; i = i + MAX_DATALEN) {
     cipher16(data + i, MIN(len - i, MAX_DATALEN));
   }
+  cc2420_unlock();
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * AES-128 driver for the stand-alone encryption of the CC2420, using
+ * key 0. start() returns while the CC2420 is encrypting, so that the
+ * caller can work on other data until it calls finish(). The radio
+ * driver is locked and interrupts are disabled during each SPI
+ * transfer, since ContikiMAC uses the radio from its rtimer interrupt.
+ */
+static void
+aes_128_set_key(const uint8_t *key)
+{
+  cc2420_aes_set_key(key, 0);
+  cc2420_lock();
+  select_key(0);
+  cc2420_unlock();
+}
+/*---------------------------------------------------------------------------*/
+static void
+aes_128_start(const uint8_t *plaintext)
+{
+  int s;
+
+  cc2420_lock();
+  s = splhigh();
+  CC2420_WRITE_RAM(plaintext, CC2420RAM_SABUF, AES_128_BLOCK_SIZE);
+  CC2420_STROBE(CC2420_SAES);
+  splx(s);
+  cc2420_unlock();
+}
+/*---------------------------------------------------------------------------*/
+static void
+aes_128_finish(uint8_t *ciphertext)
+{
+  int s;
+
+  cc2420_lock();
+  s = splhigh();
+  wait_for_encryption();
+  CC2420_READ_RAM(ciphertext, CC2420RAM_SABUF, AES_128_BLOCK_SIZE);
+  splx(s);
+  cc2420_unlock();
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver cc2420_aes_128_driver = {
+  aes_128_set_key,
+  aes_128_start,
+  aes_128_finish
+};
+/*---------------------------------------------------------------------------*/
@@ -41,6 +41,8 @@
 #ifndef __CC2420_AES_H__
 #define __CC2420_AES_H__
 
+#include "lib/aes-128.h"
+
 /**
  * \brief      Setup an AES key
  * \param key  A pointer to a 16-byte AES key
@@ -72,5 +74,12 @@ void cc2420_aes_set_key(const uint8_t *key, int index);
  */
 void cc2420_aes_cipher(uint8_t *data, int len, int key_index);
 
+/**
+ * AES-128 driver for the CC2420, see lib/aes-128.h. It uses key 0,
+ * and can be selected with
+ * \code #define AES_128_CONF cc2420_aes_128_driver \endcode
+ */
+extern const struct aes_128_driver cc2420_aes_128_driver;
+
 
 #endif /* __CC2420_AES_H__ */
@@ -71,6 +71,15 @@
 #define CC2420_CONF_AUTOACK 0
 #endif /* CC2420_CONF_AUTOACK */
 
+/* The number of received frames that can be queued by the driver, a
+   power of two. If zero, frames are left in the RX FIFO until the
+   driver process reads them. With a queue, the FIFOP interrupt reads
+   the RX FIFO over SPI, so every other user of the SPI bus must keep
+   interrupts disabled during its transfers. */
+#ifndef CC2420_CONF_RX_QUEUE
+#define CC2420_CONF_RX_QUEUE 0
+#endif /* CC2420_CONF_RX_QUEUE */
+
 #if CC2420_CONF_CHECKSUM
 #include "lib/crc16.h"
 #define CHECKSUM_LEN 2
@@ -126,6 +135,36 @@ volatile uint16_t cc2420_sfd_start_time;
 volatile uint16_t cc2420_sfd_end_time;
 
 static volatile uint16_t last_packet_timestamp;
+
+int cc2420_rx_queue_overflows, cc2420_rx_fifo_overflows;
+
+#if CC2420_CONF_RX_QUEUE
+#if (CC2420_CONF_RX_QUEUE & (CC2420_CONF_RX_QUEUE - 1)) != 0
+#error CC2420_CONF_RX_QUEUE must be a power of two
+#endif
+/*
+ * Frames are moved from the RX FIFO to rxframes[rx_head] by the
+ * interrupt, and from rxframes[rx_tail] to the packetbuf by the
+ * driver process. The counters run freely.
+ *
+ * rx_mark is the first frame that arrived after the last
+ * transmission. The RDC reads acks and replies right after it sends,
+ * so cc2420_read() and pending_packet() only see the frames from
+ * rx_mark on. The earlier ones are left to the driver process.
+ */
+struct rxframe {
+  uint16_t timestamp;
+  uint8_t len;
+  uint8_t footer[FOOTER_LEN];
+  uint8_t data[CC2420_MAX_PACKET_LEN];
+};
+static struct rxframe rxframes[CC2420_CONF_RX_QUEUE];
+static volatile uint8_t rx_head, rx_tail;
+static uint8_t rx_mark;
+
+#define RXFRAME(n) (&rxframes[(n) & (CC2420_CONF_RX_QUEUE - 1)])
+#define RX_QUEUE_FULL() ((uint8_t)(rx_head - rx_tail) == CC2420_CONF_RX_QUEUE)
+#endif /* CC2420_CONF_RX_QUEUE */
 /*---------------------------------------------------------------------------*/
 PROCESS(cc2420_process, "CC2420 driver");
 /*---------------------------------------------------------------------------*/
@@ -135,6 +174,10 @@ int cc2420_on(void);
 int cc2420_off(void);
 
 static int cc2420_read(void *buf, unsigned short bufsize);
+#if CC2420_CONF_RX_QUEUE
+static void drain_fifo(void);
+static int dequeue(void *buf, unsigned short bufsize);
+#endif /* CC2420_CONF_RX_QUEUE */
 
 static int cc2420_prepare(const void *data, unsigned short len);
 static int cc2420_transmit(unsigned short len);
@@ -204,7 +247,10 @@ status(void)
   return status;
 }
 /*---------------------------------------------------------------------------*/
-static uint8_t locked, lock_on, lock_off;
+/* The interrupt handler reads locked to see if it may use the SPI
+   bus. */
+static volatile uint8_t locked;
+static uint8_t lock_on, lock_off;
 
 static void
 on(void)
@@ -357,6 +403,13 @@ cc2420_transmit(unsigned short payload_len)
 
   GET_LOCK();
 
+#if CC2420_CONF_RX_QUEUE
+  /* Frames that arrive from now on are replies to this
+     transmission. */
+  drain_fifo();
+  rx_mark = rx_head;
+#endif /* CC2420_CONF_RX_QUEUE */
+
   txpower = 0;
   if(packetbuf_attr(PACKETBUF_ATTR_RADIO_TXPOWER) > 0) {
     /* Remember the current transmission power */
@@ -544,6 +597,18 @@ cc2420_get_channel(void)
   return channel;
 }
 /*---------------------------------------------------------------------------*/
+void
+cc2420_lock(void)
+{
+  GET_LOCK();
+}
+/*---------------------------------------------------------------------------*/
+void
+cc2420_unlock(void)
+{
+  RELEASE_LOCK();
+}
+/*---------------------------------------------------------------------------*/
 int
 cc2420_set_channel(int c)
 {
@@ -622,13 +687,22 @@ int
 cc2420_interrupt(void)
 {
   CC2420_CLEAR_FIFOP_INT();
+  last_packet_timestamp = cc2420_sfd_start_time;
+#if CC2420_CONF_RX_QUEUE
+  /* Empty the RX FIFO right away, unless the driver is using the SPI
+     bus. In that case, the driver process does it. */
+  if(!locked) {
+    GET_LOCK();
+    drain_fifo();
+    RELEASE_LOCK();
+  }
+#endif /* CC2420_CONF_RX_QUEUE */
   process_poll(&cc2420_process);
 #if CC2420_TIMETABLE_PROFILING
   timetable_clear(&cc2420_timetable);
   TIMETABLE_TIMESTAMP(cc2420_timetable, "interrupt");
 #endif /* CC2420_TIMETABLE_PROFILING */
 
-  last_packet_timestamp = cc2420_sfd_start_time;
   pending++;
   cc2420_packets_seen++;
   return 1;
@@ -649,6 +723,25 @@ PROCESS_THREAD(cc2420_process, ev, data)
     
     PRINTF("cc2420_process: calling receiver callback\n");
 
+#if CC2420_CONF_RX_QUEUE
+    /* Frames that arrived while the driver was locked. */
+    if(!locked) {
+      GET_LOCK();
+      drain_fifo();
+      RELEASE_LOCK();
+    }
+
+    /* Deliver all queued frames. */
+    while(rx_head != rx_tail) {
+      packetbuf_clear();
+      packetbuf_set_attr(PACKETBUF_ATTR_TIMESTAMP, RXFRAME(rx_tail)->timestamp);
+      len = dequeue(packetbuf_dataptr(), PACKETBUF_SIZE);
+
+      packetbuf_set_datalen(len);
+
+      NETSTACK_RDC.input();
+    }
+#else /* CC2420_CONF_RX_QUEUE */
     packetbuf_clear();
     packetbuf_set_attr(PACKETBUF_ATTR_TIMESTAMP, last_packet_timestamp);
     len = cc2420_read(packetbuf_dataptr(), PACKETBUF_SIZE);
@@ -656,6 +749,7 @@ PROCESS_THREAD(cc2420_process, ev, data)
     packetbuf_set_datalen(len);
     
     NETSTACK_RDC.input();
+#endif /* CC2420_CONF_RX_QUEUE */
 #if CC2420_TIMETABLE_PROFILING
     TIMETABLE_TIMESTAMP(cc2420_timetable, "end");
     timetable_aggregate_compute_detailed(&aggregate_time,
@@ -667,26 +761,18 @@ PROCESS_THREAD(cc2420_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Read one frame from the RX FIFO. Returns the length of the frame,
+ * or zero if it was broken. Must be called with the lock held.
+ */
 static int
-cc2420_read(void *buf, unsigned short bufsize)
+read_fifo(void *buf, unsigned short bufsize, uint8_t *footer)
 {
-  uint8_t footer[2];
   uint8_t len;
 #if CC2420_CONF_CHECKSUM
   uint16_t checksum;
 #endif /* CC2420_CONF_CHECKSUM */
 
-  if(!CC2420_FIFOP_IS_1) {
-    return 0;
-  }
-  /*  if(!pending) {
-    return 0;
-    }*/
-  
-  pending = 0;
-  
-  GET_LOCK();
-
   cc2420_packets_read++;
 
   getrxbyte(&len);
@@ -695,21 +781,18 @@ cc2420_read(void *buf, unsigned short bufsize)
     /* Oops, we must be out of sync. */
     flushrx();
     RIMESTATS_ADD(badsynch);
-    RELEASE_LOCK();
     return 0;
   }
 
   if(len <= AUX_LEN) {
     flushrx();
     RIMESTATS_ADD(tooshort);
-    RELEASE_LOCK();
     return 0;
   }
 
   if(len - AUX_LEN > bufsize) {
     flushrx();
     RIMESTATS_ADD(toolong);
-    RELEASE_LOCK();
     return 0;
   }
 
@@ -730,18 +813,144 @@ cc2420_read(void *buf, unsigned short bufsize)
 #else
   if(footer[1] & FOOTER1_CRC_OK) {
 #endif /* CC2420_CONF_CHECKSUM */
-    cc2420_last_rssi = footer[0];
-    cc2420_last_correlation = footer[1] & FOOTER1_CORRELATION;
+    RIMESTATS_ADD(llrx);
+  } else {
+    RIMESTATS_ADD(badcrc);
+    return 0;
+  }
+
+  return len - AUX_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_footer_attrs(uint8_t *footer)
+{
+  cc2420_last_rssi = footer[0];
+  cc2420_last_correlation = footer[1] & FOOTER1_CORRELATION;
+
+  packetbuf_set_attr(PACKETBUF_ATTR_RSSI, cc2420_last_rssi);
+  packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, cc2420_last_correlation);
+}
+/*---------------------------------------------------------------------------*/
+#if CC2420_CONF_RX_QUEUE
+/*
+ * Move all complete frames from the RX FIFO to the receive queue.
+ * Called with the lock held, from the interrupt or the driver
+ * process.
+ */
+static void
+drain_fifo(void)
+{
+  struct rxframe *f;
+  int len;
 
+  while(CC2420_FIFOP_IS_1) {
+    if(RX_QUEUE_FULL()) {
+      /* The frames stay in the FIFO until the queue has room. */
+      cc2420_rx_queue_overflows++;
+      return;
+    }
+    pending = 0;
+
+    f = RXFRAME(rx_head);
+    len = read_fifo(f->data, sizeof(f->data), f->footer);
+    if(len > 0) {
+      f->len = len;
+      f->timestamp = last_packet_timestamp;
+      rx_head++;
+    }
 
-    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, cc2420_last_rssi);
-    packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, cc2420_last_correlation);
+    if(CC2420_FIFOP_IS_1 && !CC2420_FIFO_IS_1) {
+      /* Clean up in case of FIFO overflow, see cc2420_read(). */
+      flushrx();
+      cc2420_rx_fifo_overflows++;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+dequeue(void *buf, unsigned short bufsize)
+{
+  struct rxframe *f;
+  int len;
 
-    RIMESTATS_ADD(llrx);
+  f = RXFRAME(rx_tail);
+  len = f->len;
+  if(len > bufsize) {
+    RIMESTATS_ADD(toolong);
+    len = 0;
+  } else {
+    memcpy(buf, f->data, len);
+    set_footer_attrs(f->footer);
+  }
+  if(rx_mark == rx_tail) {
+    rx_mark++;
+  }
+  rx_tail++;
+  return len;
+}
+#endif /* CC2420_CONF_RX_QUEUE */
+/*---------------------------------------------------------------------------*/
+#if CC2420_CONF_RX_QUEUE
+static int
+cc2420_read(void *buf, unsigned short bufsize)
+{
+  struct rxframe *f;
+  uint8_t i;
+  int len;
+
+  if(locked) {
+    return 0;
+  }
+
+  GET_LOCK();
+  drain_fifo();
+  if(rx_head == rx_mark) {
+    RELEASE_LOCK();
+    return 0;
+  }
 
+  /* Return the oldest frame that arrived after our transmission, and
+     close the gap it leaves so that the queue stays in order. */
+  f = RXFRAME(rx_mark);
+  len = f->len;
+  if(len > bufsize) {
+    RIMESTATS_ADD(toolong);
+    len = 0;
   } else {
-    RIMESTATS_ADD(badcrc);
-    len = AUX_LEN;
+    memcpy(buf, f->data, len);
+    set_footer_attrs(f->footer);
+  }
+  for(i = rx_mark; (uint8_t)(i + 1) != rx_head; i++) {
+    memcpy(RXFRAME(i), RXFRAME(i + 1), sizeof(struct rxframe));
+  }
+  rx_head--;
+  RELEASE_LOCK();
+
+  return len;
+}
+#else /* CC2420_CONF_RX_QUEUE */
+static int
+cc2420_read(void *buf, unsigned short bufsize)
+{
+  uint8_t footer[FOOTER_LEN];
+  int len;
+
+  if(!CC2420_FIFOP_IS_1) {
+    return 0;
+  }
+  /*  if(!pending) {
+    return 0;
+    }*/
+  
+  pending = 0;
+  
+  GET_LOCK();
+
+  len = read_fifo(buf, bufsize, footer);
+  if(len > 0) {
+    set_footer_attrs(footer);
   }
 
   if(CC2420_FIFOP_IS_1) {
@@ -750,6 +959,7 @@ cc2420_read(void *buf, unsigned short bufsize)
        * full length frame and is signaled by FIFOP = 1 and FIFO =
        * 0. */
       flushrx();
+      cc2420_rx_fifo_overflows++;
     } else {
       /* Another packet has been received and needs attention. */
       process_poll(&cc2420_process);
@@ -758,12 +968,9 @@ cc2420_read(void *buf, unsigned short bufsize)
 
   RELEASE_LOCK();
 
-  if(len < AUX_LEN) {
-    return 0;
-  }
-
-  return len - AUX_LEN;
+  return len;
 }
+#endif /* CC2420_CONF_RX_QUEUE */
 /*---------------------------------------------------------------------------*/
 void
 cc2420_set_txpower(uint8_t power)
@@ -880,6 +1087,11 @@ cc2420_receiving_packet(void)
 static int
 pending_packet(void)
 {
+#if CC2420_CONF_RX_QUEUE
+  if(rx_head != rx_mark) {
+    return 1;
+  }
+#endif /* CC2420_CONF_RX_QUEUE */
   return CC2420_FIFOP_IS_1;
 }
 /*---------------------------------------------------------------------------*/
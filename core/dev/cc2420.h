@@ -61,6 +61,10 @@ void cc2420_set_pan_addr(unsigned pan,
 extern signed char cc2420_last_rssi;
 extern uint8_t cc2420_last_correlation;
 
+/* Frames left in the RX FIFO because the receive queue
+   (CC2420_CONF_RX_QUEUE) was full, and RX FIFO overflows. */
+extern int cc2420_rx_queue_overflows, cc2420_rx_fifo_overflows;
+
 int cc2420_rssi(void);
 
 extern const struct radio_driver cc2420_driver;
@@ -87,6 +91,20 @@ extern int cc2420_authority_level_of_sender;
 int cc2420_on(void);
 int cc2420_off(void);
 
+/**
+ * With CC2420_CONF_RX_QUEUE, the FIFOP interrupt reads the RX FIFO
+ * over the SPI bus. Every other user of the bus, such as the xmem
+ * driver for the external flash, must disable interrupts while it
+ * selects its device, or the interrupt corrupts the transfer.
+ *
+ * Lock the driver while other code uses the CC2420 over the SPI bus,
+ * e.g. for encryption, so that the radio interrupt does not empty
+ * the RX FIFO in the middle of the transfer. Every cc2420_lock() must
+ * be followed by a cc2420_unlock().
+ */
+void cc2420_lock(void);
+void cc2420_unlock(void);
+
 void cc2420_set_cca_threshold(int value);
 
 /************************************************************************/
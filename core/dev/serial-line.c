@@ -46,15 +46,45 @@
 #error Change SERIAL_LINE_CONF_BUFSIZE in contiki-conf.h.
 #endif
 
+#if (SERIAL_LINE_LINES & (SERIAL_LINE_LINES - 1)) != 0
+#error SERIAL_LINE_CONF_LINES must be a power of two (i.e., 1, 2, 4, 8, 16, 32, 64, ...).
+#error Change SERIAL_LINE_CONF_LINES in contiki-conf.h.
+#endif
+
+/*
+ * If SERIAL_LINE_CONF_FLOW_CONTROL(stop) is defined, it is called
+ * with a non-zero argument when the input buffer is about to fill
+ * up, and with zero when there is room again, e.g. to drive RTS or to
+ * send XOFF/XON. It may be called from interrupt context.
+ */
+#define HIGH_WATER (BUFSIZE - BUFSIZE / 4)
+#define LOW_WATER  (BUFSIZE / 4)
+
 #define IGNORE_CHAR(c) (c == 0x0d)
 #define END 0x0a
 
 static struct ringbuf rxbuf;
 static uint8_t rxbuf_data[BUFSIZE];
+#ifdef SERIAL_LINE_CONF_FLOW_CONTROL
+static volatile uint8_t stopped;
+#endif /* SERIAL_LINE_CONF_FLOW_CONTROL */
+
+/*
+ * The lines [tail, posted) are being handled by other processes,
+ * [posted, head) are complete but not posted yet, and line head is
+ * being filled. The counters run freely.
+ */
+static char lines[SERIAL_LINE_LINES][BUFSIZE];
+static uint8_t head, posted, tail;
+#define LINE(n) lines[(n) & (SERIAL_LINE_LINES - 1)]
+
+static struct serial_line_batch batch;
+static struct process *batch_consumer;
 
 PROCESS(serial_line_process, "Serial driver");
 
 process_event_t serial_line_event_message;
+process_event_t serial_line_event_batch;
 
 /*---------------------------------------------------------------------------*/
 int
@@ -80,48 +110,102 @@ serial_line_input_byte(unsigned char c)
     }
   }
 
+#ifdef SERIAL_LINE_CONF_FLOW_CONTROL
+  if(!stopped && ringbuf_elements(&rxbuf) >= HIGH_WATER) {
+    stopped = 1;
+    SERIAL_LINE_CONF_FLOW_CONTROL(1);
+  }
+#endif /* SERIAL_LINE_CONF_FLOW_CONTROL */
+
   /* Wake up consumer process */
   process_poll(&serial_line_process);
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+static void
+post_lines(void)
+{
+  if(batch_consumer == NULL) {
+    while(posted != head) {
+      /* Broadcast event */
+      process_post(PROCESS_BROADCAST, serial_line_event_message,
+                   LINE(posted));
+      posted++;
+
+      /* The line is reused when all processes have handled the event */
+      if(PROCESS_ERR_OK !=
+         process_post(&serial_line_process, PROCESS_EVENT_CONTINUE, lines)) {
+        tail++;
+      }
+    }
+  } else if(batch.count == 0 && posted != head) {
+    /* All lines that have arrived since the last batch */
+    while(posted != head) {
+      batch.lines[batch.count++] = LINE(posted);
+      posted++;
+    }
+    process_post(batch_consumer, serial_line_event_batch, &batch);
+
+    if(PROCESS_ERR_OK !=
+       process_post(&serial_line_process, PROCESS_EVENT_CONTINUE, &batch)) {
+      tail += batch.count;
+      batch.count = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(serial_line_process, ev, data)
 {
-  static char buf[BUFSIZE];
   static int ptr;
+  int c;
 
   PROCESS_BEGIN();
 
   serial_line_event_message = process_alloc_event();
+  serial_line_event_batch = process_alloc_event();
   ptr = 0;
 
   while(1) {
-    /* Fill application buffer until newline or empty */
-    int c = ringbuf_get(&rxbuf);
-    
-    if(c == -1) {
-      /* Buffer empty, wait for poll */
-      PROCESS_YIELD();
-    } else {
+    /* Fill line buffers until the input is empty or all lines are
+       being handled */
+    while((uint8_t)(head - tail) < SERIAL_LINE_LINES &&
+          (c = ringbuf_get(&rxbuf)) != -1) {
+#ifdef SERIAL_LINE_CONF_FLOW_CONTROL
+      if(stopped && ringbuf_elements(&rxbuf) <= LOW_WATER) {
+        stopped = 0;
+        SERIAL_LINE_CONF_FLOW_CONTROL(0);
+      }
+#endif /* SERIAL_LINE_CONF_FLOW_CONTROL */
+
       if(c != END) {
         if(ptr < BUFSIZE-1) {
-          buf[ptr++] = (uint8_t)c;
+          LINE(head)[ptr++] = (uint8_t)c;
         } else {
           /* Ignore character (wait for EOL) */
         }
       } else {
         /* Terminate */
-        buf[ptr++] = (uint8_t)'\0';
+        LINE(head)[ptr] = (uint8_t)'\0';
+        ptr = 0;
+        head++;
+        if(batch_consumer == NULL) {
+          post_lines();
+        }
+      }
+    }
 
-        /* Broadcast event */
-        process_post(PROCESS_BROADCAST, serial_line_event_message, buf);
+    /* A batch holds all lines that were completed in the meantime */
+    post_lines();
 
-        /* Wait until all processes have handled the serial line event */
-        if(PROCESS_ERR_OK ==
-          process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL)) {
-          PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
-        }
-        ptr = 0;
+    /* Wait for more input or for lines to be handled */
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_CONTINUE) {
+      if(data == &batch) {
+        tail += batch.count;
+        batch.count = 0;
+      } else if(data == lines) {
+        tail++;
       }
     }
   }
@@ -130,6 +214,13 @@ PROCESS_THREAD(serial_line_process, ev, data)
 }
 /*---------------------------------------------------------------------------*/
 void
+serial_line_set_batch_consumer(struct process *p)
+{
+  batch_consumer = p;
+  process_poll(&serial_line_process);
+}
+/*---------------------------------------------------------------------------*/
+void
 serial_line_init(void)
 {
   ringbuf_init(&rxbuf, rxbuf_data, sizeof(rxbuf_data));
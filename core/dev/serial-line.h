@@ -42,6 +42,26 @@
 
 #include "contiki.h"
 
+/*
+ * The number of received lines that can be handed out at the same
+ * time. While the earlier lines are being handled by the receiving
+ * processes, input is copied into the next line buffer instead of
+ * being held back. Must be a power of two.
+ */
+#ifdef SERIAL_LINE_CONF_LINES
+#define SERIAL_LINE_LINES SERIAL_LINE_CONF_LINES
+#else /* SERIAL_LINE_CONF_LINES */
+#define SERIAL_LINE_LINES 1
+#endif /* SERIAL_LINE_CONF_LINES */
+
+/**
+ * The lines carried by a serial_line_event_batch event.
+ */
+struct serial_line_batch {
+  uint8_t count;
+  char *lines[SERIAL_LINE_LINES];
+};
+
 /**
  * Event posted when a line of input has been received.
  *
@@ -51,6 +71,16 @@
  */
 extern process_event_t serial_line_event_message;
 
+/**
+ * Event posted when one or more lines of input have been received,
+ * if a batch consumer has been set.
+ *
+ * The data pointer points to a struct serial_line_batch with all
+ * lines that were received since the previous batch. The lines are
+ * valid until the receiving process has returned from the event.
+ */
+extern process_event_t serial_line_event_batch;
+
 /**
  * Get one byte of input from the serial driver.
  *
@@ -72,6 +102,19 @@ int serial_line_input_byte(unsigned char c);
 
 void serial_line_init(void);
 
+/**
+ * Deliver the input lines to one process in batches.
+ *
+ * \param p The process that gets serial_line_event_batch events,
+ *          or NULL for a serial_line_event_message broadcast for
+ *          each line.
+ *
+ * This is useful for processes that handle bulk input, like
+ * scripts, since the lines that arrive while the process handles
+ * one batch are delivered together in the next one.
+ */
+void serial_line_set_batch_consumer(struct process *p);
+
 PROCESS_NAME(serial_line_process);
 
 #endif /* __SERIAL_LINE_H__ */
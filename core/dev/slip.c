@@ -63,6 +63,20 @@ u16_t slip_rubbish, slip_twopackets, slip_overflow, slip_ip_drop;
 /* Must be at least one byte larger than UIP_BUFSIZE! */
 #define RX_BUFSIZE (UIP_BUFSIZE - UIP_LLH_LEN + 16)
 
+/*
+ * The number of frame buffers. If zero, incoming bytes are put in a
+ * single ring buffer that holds at most two packets, and one packet
+ * is handed to uIP per poll. Otherwise, each frame is assembled in a
+ * buffer of its own, so that it can be moved to uip_buf with a single
+ * memcpy(), and all complete frames are handed to uIP in one
+ * poll. Must be a power of two, not larger than 128.
+ */
+#ifdef SLIP_CONF_RX_FRAMES
+#define SLIP_RX_FRAMES SLIP_CONF_RX_FRAMES
+#else /* SLIP_CONF_RX_FRAMES */
+#define SLIP_RX_FRAMES 0
+#endif /* SLIP_CONF_RX_FRAMES */
+
 enum {
   STATE_TWOPACKETS = 0,	/* We have 2 packets and drop incoming data. */
   STATE_OK = 1,
@@ -70,6 +84,27 @@ enum {
   STATE_RUBBISH = 3,
 };
 
+static u8_t state = STATE_TWOPACKETS;
+
+#if SLIP_RX_FRAMES
+/*
+ * The interrupt assembles a frame in frames[rx_head], and the poll
+ * handler takes frames from frames[rx_tail]. Both counters run
+ * freely, so rx_head - rx_tail is the number of complete frames, and
+ * each of them is only written by one side.
+ */
+struct rxframe {
+  u16_t len;
+  u8_t data[RX_BUFSIZE];
+};
+
+static struct rxframe frames[SLIP_RX_FRAMES];
+static volatile u8_t rx_head, rx_tail;
+static u16_t rxpos;
+
+#define FRAME(n) (&frames[(n) & (SLIP_RX_FRAMES - 1)])
+#define FRAMES_FULL() ((u8_t)(rx_head - rx_tail) == SLIP_RX_FRAMES)
+#else /* SLIP_RX_FRAMES */
 /*
  * Variables begin and end manage the buffer space in a cyclic
  * fashion. The first used byte is at begin and end is one byte past
@@ -81,12 +116,26 @@ enum {
  * they are discarded.
  */
 
-static u8_t state = STATE_TWOPACKETS;
 static u16_t begin, end;
 static u8_t rxbuf[RX_BUFSIZE];
 static u16_t pkt_end;		/* SLIP_END tracker. */
+#endif /* SLIP_RX_FRAMES */
+
+/*
+ * The bytes that have to be escaped on transmission, one bit per
+ * byte value: SLIP_END (0300) and SLIP_ESC (0333).
+ */
+static const u8_t escape_map[32] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0, 0, 0x08, 0, 0, 0, 0
+};
+#define NEEDS_ESCAPE(c) (escape_map[(c) >> 3] & (1 << ((c) & 7)))
 
 static void (* input_callback)(void) = NULL;
+
+#ifdef SLIP_CONF_TCPIP_INPUT
+void SLIP_CONF_TCPIP_INPUT(void);
+#endif /* SLIP_CONF_TCPIP_INPUT */
 /*---------------------------------------------------------------------------*/
 void
 slip_set_input_callback(void (*c)(void))
@@ -94,6 +143,40 @@ slip_set_input_callback(void (*c)(void))
   input_callback = c;
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Write data with the SLIP escapes. Runs of bytes that need no
+ * escaping are written in one go if the platform provides a
+ * SLIP_CONF_ARCH_WRITE(ptr, len) function.
+ */
+static void
+write_escaped(const u8_t *ptr, u16_t len)
+{
+  const u8_t *run;
+
+  while(len > 0) {
+    run = ptr;
+    while(len > 0 && !NEEDS_ESCAPE(*ptr)) {
+      ++ptr;
+      --len;
+    }
+    if(ptr != run) {
+#ifdef SLIP_CONF_ARCH_WRITE
+      SLIP_CONF_ARCH_WRITE(run, ptr - run);
+#else /* SLIP_CONF_ARCH_WRITE */
+      while(run != ptr) {
+	slip_arch_writeb(*run++);
+      }
+#endif /* SLIP_CONF_ARCH_WRITE */
+    }
+    if(len > 0) {
+      slip_arch_writeb(SLIP_ESC);
+      slip_arch_writeb(*ptr == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC);
+      ++ptr;
+      --len;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* slip_send: forward (IPv4) packets with {UIP_FW_NETIF(..., slip_send)}
  * was used in slip-bridge.c
  */
@@ -101,26 +184,14 @@ slip_set_input_callback(void (*c)(void))
 u8_t
 slip_send(void)
 {
-  u16_t i;
-  u8_t *ptr;
-  u8_t c;
-
   slip_arch_writeb(SLIP_END);
 
-  ptr = &uip_buf[UIP_LLH_LEN];
-  for(i = 0; i < uip_len; ++i) {
-    if(i == UIP_TCPIP_HLEN) {
-      ptr = (u8_t *)uip_appdata;
-    }
-    c = *ptr++;
-    if(c == SLIP_END) {
-      slip_arch_writeb(SLIP_ESC);
-      c = SLIP_ESC_END;
-    } else if(c == SLIP_ESC) {
-      slip_arch_writeb(SLIP_ESC);
-      c = SLIP_ESC_ESC;
-    }
-    slip_arch_writeb(c);
+  /* The headers are in uip_buf, the data at uip_appdata. */
+  if(uip_len <= UIP_TCPIP_HLEN) {
+    write_escaped(&uip_buf[UIP_LLH_LEN], uip_len);
+  } else {
+    write_escaped(&uip_buf[UIP_LLH_LEN], UIP_TCPIP_HLEN);
+    write_escaped((u8_t *)uip_appdata, uip_len - UIP_TCPIP_HLEN);
   }
   slip_arch_writeb(SLIP_END);
 
@@ -131,28 +202,86 @@ slip_send(void)
 u8_t
 slip_write(const void *_ptr, int len)
 {
-  const u8_t *ptr = _ptr;
-  u16_t i;
-  u8_t c;
-
+  slip_arch_writeb(SLIP_END);
+  write_escaped(_ptr, len);
   slip_arch_writeb(SLIP_END);
 
-  for(i = 0; i < len; ++i) {
-    c = *ptr++;
-    if(c == SLIP_END) {
-      slip_arch_writeb(SLIP_ESC);
-      c = SLIP_ESC_END;
-    } else if(c == SLIP_ESC) {
-      slip_arch_writeb(SLIP_ESC);
-      c = SLIP_ESC_ESC;
-    }
-    slip_arch_writeb(c);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+answer_client(void)
+{
+  int i;
+
+  for(i = 0; i < 13; i++) {
+    slip_arch_writeb("CLIENTSERVER\300"[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#ifdef SLIP_CONF_ANSWER_MAC_REQUEST
+static void
+answer_mac_request(void)
+{
+  /* Used by tapslip6 to request mac for auto configure */
+  int j;
+  char* hexchar = "0123456789abcdef";
+  rimeaddr_t addr = get_mac_addr();
+
+  /* this is just a test so far... just to see if it works */
+  slip_arch_writeb('!');
+  slip_arch_writeb('M');
+  for(j = 0; j < 8; j++) {
+    slip_arch_writeb(hexchar[addr.u8[j] >> 4]);
+    slip_arch_writeb(hexchar[addr.u8[j] & 15]);
   }
   slip_arch_writeb(SLIP_END);
+}
+#endif /* SLIP_CONF_ANSWER_MAC_REQUEST */
+/*---------------------------------------------------------------------------*/
+#if SLIP_RX_FRAMES
+static void
+rxbuf_init(void)
+{
+  rx_head = rx_tail = 0;
+  rxpos = 0;
+  state = STATE_OK;
+}
+/*---------------------------------------------------------------------------*/
+/* Upper half does the polling. */
+static u16_t
+slip_poll_handler(u8_t *outbuf, u16_t blen)
+{
+  struct rxframe *f;
+  u16_t len;
+
+  if(rx_head == rx_tail) {
+    return 0;
+  }
+
+  f = FRAME(rx_tail);
+  len = f->len;
+  if(len == 6 && memcmp(f->data, "CLIENT", 6) == 0) {
+    len = 0;
+    answer_client();
+  }
+#ifdef SLIP_CONF_ANSWER_MAC_REQUEST
+  else if(len >= 2 && f->data[0] == '?' && f->data[1] == 'M') {
+    len = 0;
+    answer_mac_request();
+  }
+#endif /* SLIP_CONF_ANSWER_MAC_REQUEST */
+  else if(len > blen) {
+    len = 0;
+  } else {
+    memcpy(outbuf, f->data, len);
+  }
 
+  /* The frame buffer can be reused by the interrupt from now on. */
+  ++rx_tail;
   return len;
 }
-/*---------------------------------------------------------------------------*/
+#else /* SLIP_RX_FRAMES */
 static void
 rxbuf_init(void)
 {
@@ -166,7 +295,6 @@ slip_poll_handler(u8_t *outbuf, u16_t blen)
 {
   /* This is a hack and won't work across buffer edge! */
   if(rxbuf[begin] == 'C') {
-    int i;
     if(begin < end && (end - begin) >= 6
        && memcmp(&rxbuf[begin], "CLIENT", 6) == 0) {
       state = STATE_TWOPACKETS;	/* Interrupts do nothing. */
@@ -174,17 +302,12 @@ slip_poll_handler(u8_t *outbuf, u16_t blen)
       
       rxbuf_init();
       
-      for(i = 0; i < 13; i++) {
-	slip_arch_writeb("CLIENTSERVER\300"[i]);
-      }
+      answer_client();
       return 0;
     }
   }
 #ifdef SLIP_CONF_ANSWER_MAC_REQUEST
   else if(rxbuf[begin] == '?') { 
-    /* Used by tapslip6 to request mac for auto configure */
-    int i, j;
-    char* hexchar = "0123456789abcdef";
     if(begin < end && (end - begin) >= 2
        && rxbuf[begin + 1] == 'M') {
       state = STATE_TWOPACKETS; /* Interrupts do nothing. */
@@ -193,15 +316,7 @@ slip_poll_handler(u8_t *outbuf, u16_t blen)
       
       rxbuf_init();
       
-      rimeaddr_t addr = get_mac_addr();
-      /* this is just a test so far... just to see if it works */
-      slip_arch_writeb('!');
-      slip_arch_writeb('M');
-      for(j = 0; j < 8; j++) {
-        slip_arch_writeb(hexchar[addr.u8[j] >> 4]);
-        slip_arch_writeb(hexchar[addr.u8[j] & 15]);
-      }
-      slip_arch_writeb(SLIP_END);
+      answer_mac_request();
       return 0;
     }
   }
@@ -250,9 +365,66 @@ slip_poll_handler(u8_t *outbuf, u16_t blen)
 
   return 0;
 }
+#endif /* SLIP_RX_FRAMES */
+/*---------------------------------------------------------------------------*/
+/* Hand the packet in uip_buf to uIP. */
+static void
+input_packet(void)
+{
+#if !UIP_CONF_IPV6
+  if(uip_len == 4 && strncmp((char*)&uip_buf[UIP_LLH_LEN], "?IPA", 4) == 0) {
+    char buf[8];
+    memcpy(&buf[0], "=IPA", 4);
+    memcpy(&buf[4], &uip_hostaddr, 4);
+    if(input_callback) {
+      input_callback();
+    }
+    slip_write(buf, 8);
+  } else if(uip_len > 0
+     && uip_len == (((u16_t)(BUF->len[0]) << 8) + BUF->len[1])
+     && uip_ipchksum() == 0xffff) {
+#define IP_DF   0x40
+    if(BUF->ipid[0] == 0 && BUF->ipid[1] == 0 && BUF->ipoffset[0] & IP_DF) {
+      static u16_t ip_id;
+      u16_t nid = ip_id++;
+      BUF->ipid[0] = nid >> 8;
+      BUF->ipid[1] = nid;
+      nid = uip_htons(nid);
+      nid = ~nid;		/* negate */
+      BUF->ipchksum += nid;	/* add */
+      if(BUF->ipchksum < nid) { /* 1-complement overflow? */
+	BUF->ipchksum++;
+      }
+    }
+#ifdef SLIP_CONF_TCPIP_INPUT
+    SLIP_CONF_TCPIP_INPUT();
+#else
+    tcpip_input();
+#endif
+  } else {
+    uip_len = 0;
+    SLIP_STATISTICS(slip_ip_drop++);
+  }
+#else /* UIP_CONF_IPV6 */
+  if(uip_len > 0) {
+    if(input_callback) {
+      input_callback();
+    }
+#ifdef SLIP_CONF_TCPIP_INPUT
+    SLIP_CONF_TCPIP_INPUT();
+#else
+    tcpip_input();
+#endif
+  }
+#endif /* UIP_CONF_IPV6 */
+}
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(slip_process, ev, data)
 {
+#if SLIP_RX_FRAMES
+  u8_t n;
+#endif /* SLIP_RX_FRAMES */
+
   PROCESS_BEGIN();
 
   rxbuf_init();
@@ -262,60 +434,95 @@ PROCESS_THREAD(slip_process, ev, data)
     
     slip_active = 1;
 
+#if SLIP_RX_FRAMES
+    /* Hand all complete frames to uIP, not only the first one. */
+    for(n = 0; n < SLIP_RX_FRAMES && rx_head != rx_tail; ++n) {
+      uip_len = slip_poll_handler(&uip_buf[UIP_LLH_LEN],
+				  UIP_BUFSIZE - UIP_LLH_LEN);
+      if(uip_len > 0) {
+	input_packet();
+      }
+    }
+#else /* SLIP_RX_FRAMES */
     /* Move packet from rxbuf to buffer provided by uIP. */
     uip_len = slip_poll_handler(&uip_buf[UIP_LLH_LEN],
 				UIP_BUFSIZE - UIP_LLH_LEN);
-#if !UIP_CONF_IPV6
-    if(uip_len == 4 && strncmp((char*)&uip_buf[UIP_LLH_LEN], "?IPA", 4) == 0) {
-      char buf[8];
-      memcpy(&buf[0], "=IPA", 4);
-      memcpy(&buf[4], &uip_hostaddr, 4);
-      if(input_callback) {
-	input_callback();
-      }
-      slip_write(buf, 8);
-    } else if(uip_len > 0
-       && uip_len == (((u16_t)(BUF->len[0]) << 8) + BUF->len[1])
-       && uip_ipchksum() == 0xffff) {
-#define IP_DF   0x40
-      if(BUF->ipid[0] == 0 && BUF->ipid[1] == 0 && BUF->ipoffset[0] & IP_DF) {
-	static u16_t ip_id;
-	u16_t nid = ip_id++;
-	BUF->ipid[0] = nid >> 8;
-	BUF->ipid[1] = nid;
-	nid = uip_htons(nid);
-	nid = ~nid;		/* negate */
-	BUF->ipchksum += nid;	/* add */
-	if(BUF->ipchksum < nid) { /* 1-complement overflow? */
-	  BUF->ipchksum++;
-	}
-      }
-#ifdef SLIP_CONF_TCPIP_INPUT
-      SLIP_CONF_TCPIP_INPUT();
-#else
-      tcpip_input();
-#endif
+    input_packet();
+#endif /* SLIP_RX_FRAMES */
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+#if SLIP_RX_FRAMES
+int
+slip_input_byte(unsigned char c)
+{
+  struct rxframe *f;
+
+  switch(state) {
+  case STATE_RUBBISH:
+    if(c == SLIP_END) {
+      state = STATE_OK;
+      rxpos = 0;
+    }
+    return 0;
+
+  case STATE_TWOPACKETS:	/* Not initialized yet. */
+    return 0;
+
+  case STATE_ESC:
+    if(c == SLIP_ESC_END) {
+      c = SLIP_END;
+    } else if(c == SLIP_ESC_ESC) {
+      c = SLIP_ESC;
     } else {
-      uip_len = 0;
-      SLIP_STATISTICS(slip_ip_drop++);
+      state = STATE_RUBBISH;
+      SLIP_STATISTICS(slip_rubbish++);
+      return 0;
     }
-#else /* UIP_CONF_IPV6 */
-    if(uip_len > 0) {
-      if(input_callback) {
-        input_callback();
+    state = STATE_OK;
+    break;
+
+  case STATE_OK:
+    if(c == SLIP_ESC) {
+      state = STATE_ESC;
+      return 0;
+    } else if(c == SLIP_END) {
+      if(rxpos > 0) {		/* Non zero length. */
+	FRAME(rx_head)->len = rxpos;
+	++rx_head;
+	rxpos = 0;
+	process_poll(&slip_process);
+	return 1;
       }
-#ifdef SLIP_CONF_TCPIP_INPUT
-      SLIP_CONF_TCPIP_INPUT();
-#else
-      tcpip_input();
-#endif
+      return 0;
     }
-#endif /* UIP_CONF_IPV6 */
+    break;
   }
 
-  PROCESS_END();
+  /* The frame is dropped if all buffers hold complete frames, or if
+     it does not fit in its buffer. */
+  if(FRAMES_FULL() || rxpos == RX_BUFSIZE) {
+    state = STATE_RUBBISH;
+    SLIP_STATISTICS(slip_overflow++);
+    return 0;
+  }
+  f = FRAME(rx_head);
+  f->data[rxpos++] = c;
+
+  /* The CLIENT string is not terminated by SLIP_END. */
+  if(c == 'T' && rxpos == 6 && f->data[0] == 'C') {
+    f->len = rxpos;
+    ++rx_head;
+    rxpos = 0;
+    process_poll(&slip_process);
+    return 1;
+  }
+
+  return 0;
 }
-/*---------------------------------------------------------------------------*/
+#else /* SLIP_RX_FRAMES */
 int
 slip_input_byte(unsigned char c)
 {
@@ -393,4 +600,5 @@ slip_input_byte(unsigned char c)
 
   return 0;
 }
+#endif /* SLIP_RX_FRAMES */
 /*---------------------------------------------------------------------------*/
@@ -80,6 +80,15 @@ void slip_set_input_callback(void (*callback)(void));
 /*
  * These machine dependent functions and an interrupt service routine
  * must be provided externally (slip_arch.c).
+ *
+ * A platform that can write several bytes at once may also define
+ * SLIP_CONF_ARCH_WRITE(ptr, len), which is then used for the runs of
+ * bytes that need no escaping.
+ *
+ * If SLIP_CONF_RX_FRAMES is non-zero, that many frame buffers are
+ * used for reception instead of the shared ring buffer, so that the
+ * line can be received at full speed while earlier frames are being
+ * handed to uIP.
  */
 void slip_arch_init(unsigned long ubr);
 void slip_arch_writeb(unsigned char c);
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A hash table that maps keys, such as Rime addresses, to items
+ */
+
+#include "lib/addrmap.h"
+
+#include <string.h>
+
+#define KEY(m, item) ((const uint8_t *)(item) + (m)->keyoffset)
+/*---------------------------------------------------------------------------*/
+static uint8_t
+hash(const struct addrmap *m, const uint8_t *key)
+{
+  uint8_t i, h;
+
+  h = 0;
+  for(i = 0; i < m->keylen; ++i) {
+    h = h * 31 + key[i];
+  }
+  return h & m->mask;
+}
+/*---------------------------------------------------------------------------*/
+static int
+find_slot(const struct addrmap *m, const void *item)
+{
+  uint8_t i;
+
+  for(i = hash(m, KEY(m, item)); m->slots[i] != NULL;
+      i = (i + 1) & m->mask) {
+    if(m->slots[i] == item) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+void
+addrmap_init(struct addrmap *m, void **slots, uint8_t size,
+             uint8_t keyoffset, uint8_t keylen)
+{
+  m->slots = slots;
+  m->mask = size - 1;
+  m->keyoffset = keyoffset;
+  m->keylen = keylen;
+  addrmap_clear(m);
+}
+/*---------------------------------------------------------------------------*/
+void
+addrmap_clear(struct addrmap *m)
+{
+  memset(m->slots, 0, (m->mask + 1) * sizeof(void *));
+}
+/*---------------------------------------------------------------------------*/
+int
+addrmap_add(struct addrmap *m, void *item)
+{
+  uint8_t i, n;
+
+  /* Always leave one slot empty, so that probe sequences end. */
+  i = hash(m, KEY(m, item));
+  for(n = 0; n < m->mask; ++n) {
+    if(m->slots[i] == NULL) {
+      m->slots[i] = item;
+      return 1;
+    }
+    if(m->slots[i] == item) {
+      return 1;
+    }
+    i = (i + 1) & m->mask;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+addrmap_remove(struct addrmap *m, void *item)
+{
+  int slot;
+  uint8_t i, j, home;
+
+  slot = find_slot(m, item);
+  if(slot < 0) {
+    return;
+  }
+
+  /* Move later items of the probe sequence back into the hole, so
+     that no lookup stops at an empty slot before reaching its item. */
+  i = slot;
+  m->slots[i] = NULL;
+  for(j = (i + 1) & m->mask; m->slots[j] != NULL; j = (j + 1) & m->mask) {
+    home = hash(m, KEY(m, m->slots[j]));
+    if(((j - home) & m->mask) >= ((j - i) & m->mask)) {
+      m->slots[i] = m->slots[j];
+      m->slots[j] = NULL;
+      i = j;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void *
+lookup(struct addrmap *m, const uint8_t *key, uint8_t i)
+{
+  for(; m->slots[i] != NULL; i = (i + 1) & m->mask) {
+    if(memcmp(KEY(m, m->slots[i]), key, m->keylen) == 0) {
+      return m->slots[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void *
+addrmap_get(struct addrmap *m, const void *key)
+{
+  return lookup(m, key, hash(m, key));
+}
+/*---------------------------------------------------------------------------*/
+void *
+addrmap_get_next(struct addrmap *m, const void *item)
+{
+  int slot;
+
+  slot = find_slot(m, item);
+  if(slot < 0) {
+    return NULL;
+  }
+  return lookup(m, KEY(m, item), (slot + 1) & m->mask);
+}
+/*---------------------------------------------------------------------------*/
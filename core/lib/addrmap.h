@@ -0,0 +1,164 @@
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup addrmap Address map library
+ * @{
+ *
+ * The address map library implements a small hash table that maps
+ * keys to items that are stored elsewhere, typically in a MEMB()
+ * block and on a list. The key is a field inside the item, usually a
+ * rimeaddr_t, but it can be any sequence of bytes inside the item,
+ * such as an originator address directly followed by a sequence
+ * number. The map is used to replace linear list walks in per-packet
+ * lookups. Several items may have the same key.
+ *
+ * The map uses open addressing with linear probing. The slot array
+ * is defined separately and must have room for more items than will
+ * ever be put in the map.
+ */
+
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the address map library
+ */
+
+#ifndef __ADDRMAP_H__
+#define __ADDRMAP_H__
+
+#include "contiki-conf.h"
+#include "net/rime/rimeaddr.h"
+
+#include <stddef.h>
+
+/* This option makes the Rime neighbor and route tables, the
+   neighbor attribute table, and the collect duplicate packet
+   detection use address maps instead of list walks for their
+   per-packet lookups. */
+#ifdef ADDRMAP_CONF_HASHED_LOOKUPS
+#define ADDRMAP_HASHED_LOOKUPS ADDRMAP_CONF_HASHED_LOOKUPS
+#else /* ADDRMAP_CONF_HASHED_LOOKUPS */
+#define ADDRMAP_HASHED_LOOKUPS 0
+#endif /* ADDRMAP_CONF_HASHED_LOOKUPS */
+
+/**
+ * \brief      Structure that holds the state of an address map.
+ *
+ *             This structure holds the state of an address map. The
+ *             slot array needs to be defined separately. This struct
+ *             is an opaque structure with no user-visible elements.
+ */
+struct addrmap {
+  void **slots;
+  uint8_t mask;
+  uint8_t keyoffset;
+  uint8_t keylen;
+};
+
+/**
+ * \brief      Initialize an address map
+ * \param m    A pointer to a struct addrmap to hold the state of the map
+ * \param slots A pointer to an array of pointers that holds the map slots
+ * \param size_power_of_two The number of slots, which must be a power of two
+ * \param keyoffset The offset of the key inside the items, as given by offsetof()
+ * \param keylen The length of the key in bytes
+ *
+ *             This function initializes an empty address map. The
+ *             number of slots must be a power of two, not larger than
+ *             128, and larger than the number of items that will be
+ *             put in the map. About twice the number of items gives
+ *             short probe sequences.
+ */
+void addrmap_init(struct addrmap *m, void **slots, uint8_t size_power_of_two,
+                  uint8_t keyoffset, uint8_t keylen);
+
+/**
+ * \brief      Initialize an address map keyed by a rimeaddr_t
+ * \param m    A pointer to a struct addrmap
+ * \param slots The slot array
+ * \param structure The type of the items
+ * \param field The name of the rimeaddr_t field in the items
+ */
+#define ADDRMAP_INIT(m, slots, structure, field)                        \
+  addrmap_init((m), (slots), sizeof(slots) / sizeof(void *),            \
+               offsetof(structure, field), sizeof(rimeaddr_t))
+
+/**
+ * \brief      Remove all items from an address map
+ * \param m    A pointer to a struct addrmap
+ */
+void addrmap_clear(struct addrmap *m);
+
+/**
+ * \brief      Add an item to an address map
+ * \param m    A pointer to a struct addrmap
+ * \param item The item
+ * \return     Non-zero if the item was added, or zero if the map was full.
+ *
+ *             The key of the item must not be changed while the item
+ *             is in the map. To change the key, remove the item,
+ *             change the key, and add the item again.
+ */
+int addrmap_add(struct addrmap *m, void *item);
+
+/**
+ * \brief      Remove an item from an address map
+ * \param m    A pointer to a struct addrmap
+ * \param item The item
+ *
+ *             Removing an item that is not in the map does nothing.
+ */
+void addrmap_remove(struct addrmap *m, void *item);
+
+/**
+ * \brief      Find the first item with a key
+ * \param m    A pointer to a struct addrmap
+ * \param key  A pointer to the key, e.g. a rimeaddr_t
+ * \return     The item, or NULL if no item with the key is in the map.
+ */
+void *addrmap_get(struct addrmap *m, const void *key);
+
+/**
+ * \brief      Find the next item with the same key as an item
+ * \param m    A pointer to a struct addrmap
+ * \param item An item returned by addrmap_get() or addrmap_get_next()
+ * \return     The next item with the same key, or NULL if there is none.
+ */
+void *addrmap_get_next(struct addrmap *m, const void *item);
+
+#endif /* __ADDRMAP_H__ */
+
+/** @} */
+/** @} */
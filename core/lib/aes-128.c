@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Software implementation of AES-128 encryption (FIPS-197)
+ */
+
+#include "lib/aes-128.h"
+#include <string.h>
+
+#define ROUNDS 10
+
+static const uint8_t sbox[256] = {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+  0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+  0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+  0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+  0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+  0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+  0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+  0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+  0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+  0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+  0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+  0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+  0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+  0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+  0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+  0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+  0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/* The expanded key, one block per round. */
+static uint8_t round_keys[(ROUNDS + 1) * AES_128_BLOCK_SIZE];
+
+static uint8_t state[AES_128_BLOCK_SIZE];
+/*---------------------------------------------------------------------------*/
+static uint8_t
+xtime(uint8_t x)
+{
+  return (x << 1) ^ ((x & 0x80) ? 0x1b : 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_key(const uint8_t *key)
+{
+  uint8_t i;
+  uint8_t rcon;
+  uint8_t *k;
+
+  memcpy(round_keys, key, AES_128_KEY_LENGTH);
+
+  rcon = 1;
+  for(i = AES_128_KEY_LENGTH; i < sizeof(round_keys); i += 4) {
+    k = &round_keys[i];
+    if((i % AES_128_KEY_LENGTH) == 0) {
+      /* RotWord, SubWord and the round constant. */
+      k[0] = k[-16] ^ sbox[k[-3]] ^ rcon;
+      k[1] = k[-15] ^ sbox[k[-2]];
+      k[2] = k[-14] ^ sbox[k[-1]];
+      k[3] = k[-13] ^ sbox[k[-4]];
+      rcon = xtime(rcon);
+    } else {
+      k[0] = k[-16] ^ k[-4];
+      k[1] = k[-15] ^ k[-3];
+      k[2] = k[-14] ^ k[-2];
+      k[3] = k[-13] ^ k[-1];
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_round_key(uint8_t round)
+{
+  uint8_t i;
+  const uint8_t *k;
+
+  k = &round_keys[round * AES_128_BLOCK_SIZE];
+  for(i = 0; i < AES_128_BLOCK_SIZE; i++) {
+    state[i] ^= k[i];
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* SubBytes and ShiftRows. The state is stored column by column. */
+static void
+sub_shift(void)
+{
+  uint8_t t;
+
+  /* Row 0 is not shifted. */
+  state[0] = sbox[state[0]];
+  state[4] = sbox[state[4]];
+  state[8] = sbox[state[8]];
+  state[12] = sbox[state[12]];
+
+  /* Row 1 is shifted one step. */
+  t = state[1];
+  state[1] = sbox[state[5]];
+  state[5] = sbox[state[9]];
+  state[9] = sbox[state[13]];
+  state[13] = sbox[t];
+
+  /* Row 2 is shifted two steps. */
+  t = state[2];
+  state[2] = sbox[state[10]];
+  state[10] = sbox[t];
+  t = state[6];
+  state[6] = sbox[state[14]];
+  state[14] = sbox[t];
+
+  /* Row 3 is shifted three steps. */
+  t = state[15];
+  state[15] = sbox[state[11]];
+  state[11] = sbox[state[7]];
+  state[7] = sbox[state[3]];
+  state[3] = sbox[t];
+}
+/*---------------------------------------------------------------------------*/
+static void
+mix_columns(void)
+{
+  uint8_t i;
+  uint8_t a0, a1, a2, a3, all;
+
+  for(i = 0; i < AES_128_BLOCK_SIZE; i += 4) {
+    a0 = state[i];
+    a1 = state[i + 1];
+    a2 = state[i + 2];
+    a3 = state[i + 3];
+    all = a0 ^ a1 ^ a2 ^ a3;
+    state[i] ^= all ^ xtime(a0 ^ a1);
+    state[i + 1] ^= all ^ xtime(a1 ^ a2);
+    state[i + 2] ^= all ^ xtime(a2 ^ a3);
+    state[i + 3] ^= all ^ xtime(a3 ^ a0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+start(const uint8_t *plaintext)
+{
+  uint8_t round;
+
+  memcpy(state, plaintext, AES_128_BLOCK_SIZE);
+
+  add_round_key(0);
+  for(round = 1; round < ROUNDS; round++) {
+    sub_shift();
+    mix_columns();
+    add_round_key(round);
+  }
+  sub_shift();
+  add_round_key(ROUNDS);
+}
+/*---------------------------------------------------------------------------*/
+static void
+finish(uint8_t *ciphertext)
+{
+  memcpy(ciphertext, state, AES_128_BLOCK_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver aes_128_soft_driver = {
+  set_key,
+  start,
+  finish
+};
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Interface to AES-128 block encryption, with a software
+ *         implementation
+ */
+
+#ifndef __AES_128_H__
+#define __AES_128_H__
+
+#include "contiki-conf.h"
+
+#define AES_128_BLOCK_SIZE 16
+#define AES_128_KEY_LENGTH 16
+
+/**
+ * The structure of an AES-128 driver.
+ *
+ * Encryption is split in two steps, so that drivers for hardware
+ * AES engines can return from start() while the engine is busy. The
+ * caller can then do other work before it calls finish().
+ */
+struct aes_128_driver {
+  /** Set the key used by the following blocks. */
+  void (* set_key)(const uint8_t *key);
+
+  /** Start encrypting one block. */
+  void (* start)(const uint8_t *plaintext);
+
+  /** Wait for the block started last and copy the ciphertext. */
+  void (* finish)(uint8_t *ciphertext);
+};
+
+#ifdef AES_128_CONF
+#define AES_128 AES_128_CONF
+#else /* AES_128_CONF */
+#define AES_128 aes_128_soft_driver
+#endif /* AES_128_CONF */
+
+extern const struct aes_128_driver AES_128;
+
+extern const struct aes_128_driver aes_128_soft_driver;
+
+#endif /* __AES_128_H__ */
@@ -145,10 +145,125 @@ static const unsigned char elf_magic_header[] =
    0x01,                    /* Only ELF version 1. */
   };
 
+/*---------------------------------------------------------------------------*/
+/*
+ * The relocator reads small pieces of the symbol table, the string
+ * table and the relocation sections in an order that jumps back and
+ * forth in the file. To avoid one CFS seek and read per access, small
+ * reads are served from a few cached pages of the file.
+ */
+#ifdef ELFLOADER_CONF_CACHE_PAGES
+#define CACHE_PAGES ELFLOADER_CONF_CACHE_PAGES
+#else
+#define CACHE_PAGES 4
+#endif
+
+#ifdef ELFLOADER_CONF_CACHE_PAGESIZE
+#define CACHE_PAGESIZE ELFLOADER_CONF_CACHE_PAGESIZE
+#else
+#define CACHE_PAGESIZE 32
+#endif
+
+#define CACHE_INVALID ((unsigned int)-1)
+
+#if CACHE_PAGES > 0
+struct cache_page {
+  unsigned int offset;
+  unsigned short len;
+  unsigned char age;
+  char data[CACHE_PAGESIZE];
+};
+
+static struct cache_page cache[CACHE_PAGES];
+static unsigned char cache_clock;
+#endif /* CACHE_PAGES > 0 */
+/*---------------------------------------------------------------------------*/
+static void
+cache_invalidate(unsigned int offset, int len)
+{
+#if CACHE_PAGES > 0
+  int i;
+
+  for(i = 0; i < CACHE_PAGES; ++i) {
+    if(cache[i].offset != CACHE_INVALID &&
+       offset < cache[i].offset + CACHE_PAGESIZE &&
+       offset + len > cache[i].offset) {
+      cache[i].offset = CACHE_INVALID;
+    }
+  }
+#endif /* CACHE_PAGES > 0 */
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_flush(void)
+{
+#if CACHE_PAGES > 0
+  int i;
+
+  for(i = 0; i < CACHE_PAGES; ++i) {
+    cache[i].offset = CACHE_INVALID;
+  }
+#endif /* CACHE_PAGES > 0 */
+}
+/*---------------------------------------------------------------------------*/
+#if CACHE_PAGES > 0
+static struct cache_page *
+cache_get(int fd, unsigned int offset)
+{
+  struct cache_page *p, *oldest;
+  int i, n;
+
+  offset -= offset % CACHE_PAGESIZE;
+  oldest = &cache[0];
+  for(i = 0; i < CACHE_PAGES; ++i) {
+    p = &cache[i];
+    if(p->offset == offset) {
+      p->age = ++cache_clock;
+      return p;
+    }
+    if(p->offset == CACHE_INVALID ||
+       (unsigned char)(cache_clock - p->age) >
+       (unsigned char)(cache_clock - oldest->age)) {
+      oldest = p;
+    }
+  }
+
+  cfs_seek(fd, offset, CFS_SEEK_SET);
+  n = cfs_read(fd, oldest->data, CACHE_PAGESIZE);
+  oldest->offset = offset;
+  oldest->len = n < 0 ? 0 : n;
+  oldest->age = ++cache_clock;
+  return oldest;
+}
+#endif /* CACHE_PAGES > 0 */
 /*---------------------------------------------------------------------------*/
 static void
 seek_read(int fd, unsigned int offset, char *buf, int len)
 {
+#if CACHE_PAGES > 0
+  if(len <= CACHE_PAGESIZE) {
+    struct cache_page *p;
+    int pos, n;
+
+    while(len > 0) {
+      p = cache_get(fd, offset);
+      pos = offset - p->offset;
+      if(pos >= p->len) {
+	/* Past the end of the file. */
+	break;
+      }
+      n = p->len - pos;
+      if(n > len) {
+	n = len;
+      }
+      memcpy(buf, &p->data[pos], n);
+      buf += n;
+      offset += n;
+      len -= n;
+    }
+    return;
+  }
+#endif /* CACHE_PAGES > 0 */
   cfs_seek(fd, offset, CFS_SEEK_SET);
   cfs_read(fd, buf, len);
 #if DEBUG
@@ -173,6 +288,71 @@ seek_write(int fd, unsigned int offset, char *buf, int len)
 }
 */
 /*---------------------------------------------------------------------------*/
+/*
+ * Index of the symbols defined by the module, built in one pass over
+ * the symbol table before relocation starts. Each entry holds the
+ * hash of the symbol name and its index in the symbol table, so that
+ * a local symbol lookup costs one symbol and one name read instead
+ * of a scan of the whole symbol table.
+ */
+#ifdef ELFLOADER_CONF_SYMINDEX_SIZE
+#define SYMINDEX_SIZE ELFLOADER_CONF_SYMINDEX_SIZE
+#else
+#define SYMINDEX_SIZE 32
+#endif
+
+struct symindex_entry {
+  unsigned short hash;
+  unsigned short sym;
+};
+
+static struct symindex_entry symindex[SYMINDEX_SIZE];
+static unsigned short symindex_len;
+/* Symbol table offset of the first symbol that did not fit in the
+   index, or 0 if all defined symbols are indexed. */
+static unsigned int symindex_overflow;
+/*---------------------------------------------------------------------------*/
+static struct relevant_section *
+defining_section(struct elf32_sym *s)
+{
+  if(s->st_shndx == bss.number) {
+    return &bss;
+  } else if(s->st_shndx == data.number) {
+    return &data;
+  } else if(s->st_shndx == text.number) {
+    return &text;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_symindex(int fd, unsigned int symtab, unsigned short symtabsize,
+	       unsigned int strtab)
+{
+  struct elf32_sym s;
+  unsigned int a;
+  char name[30];
+
+  symindex_len = 0;
+  symindex_overflow = 0;
+
+  for(a = symtab; a < symtab + symtabsize; a += sizeof(s)) {
+    seek_read(fd, a, (char *)&s, sizeof(s));
+    if(s.st_name != 0 && defining_section(&s) != NULL) {
+      if(symindex_len == SYMINDEX_SIZE) {
+	symindex_overflow = a;
+	return;
+      }
+      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      name[sizeof(name) - 1] = 0;
+      symindex[symindex_len].hash = symtab_hash(name);
+      symindex[symindex_len].sym = (a - symtab) / sizeof(s);
+      symindex_len++;
+    }
+  }
+  PRINTF("elfloader: indexed %d symbols\n", symindex_len);
+}
+/*---------------------------------------------------------------------------*/
 static void *
 find_local_symbol(int fd, const char *symbol,
 		  unsigned int symtab, unsigned short symtabsize,
@@ -180,22 +360,36 @@ find_local_symbol(int fd, const char *symbol,
 {
   struct elf32_sym s;
   unsigned int a;
+  unsigned short hash;
+  int i;
   char name[30];
   struct relevant_section *sect;
-  
-  for(a = symtab; a < symtab + symtabsize; a += sizeof(s)) {
+
+  hash = symtab_hash(symbol);
+  for(i = 0; i < symindex_len; ++i) {
+    if(symindex[i].hash == hash) {
+      seek_read(fd, symtab + sizeof(s) * symindex[i].sym,
+		(char *)&s, sizeof(s));
+      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      if(strcmp(name, symbol) == 0) {
+	return &(defining_section(&s)->address[s.st_value]);
+      }
+    }
+  }
+
+  if(symindex_overflow == 0) {
+    return NULL;
+  }
+
+  /* The index was full; scan the symbols that did not fit. */
+  for(a = symindex_overflow; a < symtab + symtabsize; a += sizeof(s)) {
     seek_read(fd, a, (char *)&s, sizeof(s));
 
     if(s.st_name != 0) {
       seek_read(fd, strtab + s.st_name, name, sizeof(name));
       if(strcmp(name, symbol) == 0) {
-	if(s.st_shndx == bss.number) {
-	  sect = &bss;
-	} else if(s.st_shndx == data.number) {
-	  sect = &data;
-	} else if(s.st_shndx == text.number) {
-	  sect = &text;
-	} else {
+	sect = defining_section(&s);
+	if(sect == NULL) {
 	  return NULL;
 	}
 	return &(sect->address[s.st_value]);
@@ -285,6 +479,8 @@ relocate_section(int fd,
     }
 
     elfloader_arch_relocate(fd, sectionaddr, sectionbase, &rela, addr);
+    /* The architecture code may have patched the file. */
+    cache_invalidate(sectionaddr + rela.r_offset, sizeof(elf32_word));
   }
   return ELFLOADER_OK;
 }
@@ -334,13 +530,26 @@ print_chars(unsigned char *ptr, int num)
 }
 #endif /* 0 */
 /*---------------------------------------------------------------------------*/
-int
-elfloader_load(int fd)
+/*
+ * Offsets and sizes of the sections that the loader needs, gathered
+ * from the section header table.
+ */
+struct elf_sections {
+  unsigned int strs;
+  unsigned char using_relas;
+  unsigned short textoff, textsize, textrelaoff, textrelasize;
+  unsigned short dataoff, datasize, datarelaoff, datarelasize;
+  unsigned short rodataoff, rodatasize, rodatarelaoff, rodatarelasize;
+  unsigned short symtaboff, symtabsize;
+  unsigned short strtaboff, strtabsize;
+  unsigned short bsssize;
+};
+/*---------------------------------------------------------------------------*/
+static int
+read_sections(int fd, struct elf32_ehdr *ehdr, struct elf_sections *e)
 {
-  struct elf32_ehdr ehdr;
   struct elf32_shdr shdr;
   struct elf32_shdr strtable;
-  unsigned int strs;
   unsigned int shdrptr;
   unsigned int nameptr;
   char name[12];
@@ -348,50 +557,27 @@ elfloader_load(int fd)
   int i;
   unsigned short shdrnum, shdrsize;
 
-  unsigned char using_relas = -1;
-  unsigned short textoff = 0, textsize, textrelaoff = 0, textrelasize;
-  unsigned short dataoff = 0, datasize, datarelaoff = 0, datarelasize;
-  unsigned short rodataoff = 0, rodatasize, rodatarelaoff = 0, rodatarelasize;
-  unsigned short symtaboff = 0, symtabsize;
-  unsigned short strtaboff = 0, strtabsize;
-  unsigned short bsssize = 0;
-
-  struct process **process;
-  int ret;
-
-  elfloader_unknown[0] = 0;
-
-  /* The ELF header is located at the start of the buffer. */
-  seek_read(fd, 0, (char *)&ehdr, sizeof(ehdr));
-
-  /*  print_chars(ehdr.e_ident, sizeof(elf_magic_header));
-      print_chars(elf_magic_header, sizeof(elf_magic_header));*/
-  /* Make sure that we have a correct and compatible ELF header. */
-  if(memcmp(ehdr.e_ident, elf_magic_header, sizeof(elf_magic_header)) != 0) {
-    PRINTF("ELF header problems\n");
-    return ELFLOADER_BAD_ELF_HEADER;
-  }
+  /* Initialize the segment sizes to zero so that we can check if
+     their sections was found in the file or not. */
+  memset(e, 0, sizeof(struct elf_sections));
+  e->using_relas = -1;
 
-  /* Grab the section header. */
-  shdrptr = ehdr.e_shoff;
-  seek_read(fd, shdrptr, (char *)&shdr, sizeof(shdr));
-  
   /* Get the size and number of entries of the section header. */
-  shdrsize = ehdr.e_shentsize;
-  shdrnum = ehdr.e_shnum;
+  shdrsize = ehdr->e_shentsize;
+  shdrnum = ehdr->e_shnum;
 
   PRINTF("Section header: size %d num %d\n", shdrsize, shdrnum);
   
   /* The string table section: holds the names of the sections. */
-  seek_read(fd, ehdr.e_shoff + shdrsize * ehdr.e_shstrndx,
+  seek_read(fd, ehdr->e_shoff + shdrsize * ehdr->e_shstrndx,
 	    (char *)&strtable, sizeof(strtable));
 
   /* Get a pointer to the actual table of strings. This table holds
      the names of the sections, not the names of other symbols in the
      file (these are in the sybtam section). */
-  strs = strtable.sh_offset;
+  e->strs = strtable.sh_offset;
 
-  PRINTF("Strtable offset %d\n", strs);
+  PRINTF("Strtable offset %d\n", e->strs);
   
   /* Go through all sections and pick out the relevant ones. The
      ".text" segment holds the actual code from the ELF file, the
@@ -409,24 +595,19 @@ elfloader_load(int fd)
   */
 
 
-  /* Initialize the segment sizes to zero so that we can check if
-     their sections was found in the file or not. */
-  textsize = textrelasize = datasize = datarelasize =
-    rodatasize = rodatarelasize = symtabsize = strtabsize = 0;
-
   bss.number = data.number = rodata.number = text.number = -1;
 		
-  shdrptr = ehdr.e_shoff;
+  shdrptr = ehdr->e_shoff;
   for(i = 0; i < shdrnum; ++i) {
 
     seek_read(fd, shdrptr, (char *)&shdr, sizeof(shdr));
     
     /* The name of the section is contained in the strings table. */
-    nameptr = strs + shdr.sh_name;
+    nameptr = e->strs + shdr.sh_name;
     seek_read(fd, nameptr, name, sizeof(name));
     PRINTF("Section shdrptr 0x%x, %d + %d type %d\n",
 	   shdrptr,
-	   strs, shdr.sh_name,
+	   e->strs, shdr.sh_name,
 	   (int)shdr.sh_type);
     /* Match the name of the section with a predefined set of names
        (.text, .data, .bss, .rela.text, .rela.data, .symtab, and
@@ -435,56 +616,56 @@ elfloader_load(int fd)
 
     if(shdr.sh_type == SHT_SYMTAB/*strncmp(name, ".symtab", 7) == 0*/) {
       PRINTF("symtab\n");
-      symtaboff = shdr.sh_offset;
-      symtabsize = shdr.sh_size;
+      e->symtaboff = shdr.sh_offset;
+      e->symtabsize = shdr.sh_size;
     } else if(shdr.sh_type == SHT_STRTAB/*strncmp(name, ".strtab", 7) == 0*/) {
       PRINTF("strtab\n");
-      strtaboff = shdr.sh_offset;
-      strtabsize = shdr.sh_size;
+      e->strtaboff = shdr.sh_offset;
+      e->strtabsize = shdr.sh_size;
     } else if(strncmp(name, ".text", 5) == 0) {
-      textoff = shdr.sh_offset;
-      textsize = shdr.sh_size;
+      e->textoff = shdr.sh_offset;
+      e->textsize = shdr.sh_size;
       text.number = i;
-      text.offset = textoff;
+      text.offset = e->textoff;
     } else if(strncmp(name, ".rel.text", 9) == 0) {
-      using_relas = 0;
-      textrelaoff = shdr.sh_offset;
-      textrelasize = shdr.sh_size;
+      e->using_relas = 0;
+      e->textrelaoff = shdr.sh_offset;
+      e->textrelasize = shdr.sh_size;
     } else if(strncmp(name, ".rela.text", 10) == 0) {
-      using_relas = 1;
-      textrelaoff = shdr.sh_offset;
-      textrelasize = shdr.sh_size;
+      e->using_relas = 1;
+      e->textrelaoff = shdr.sh_offset;
+      e->textrelasize = shdr.sh_size;
     } else if(strncmp(name, ".data", 5) == 0) {
-      dataoff = shdr.sh_offset;
-      datasize = shdr.sh_size;
+      e->dataoff = shdr.sh_offset;
+      e->datasize = shdr.sh_size;
       data.number = i;
-      data.offset = dataoff;
+      data.offset = e->dataoff;
     } else if(strncmp(name, ".rodata", 7) == 0) {
       /* read-only data handled the same way as regular text section */
-      rodataoff = shdr.sh_offset;
-      rodatasize = shdr.sh_size;
+      e->rodataoff = shdr.sh_offset;
+      e->rodatasize = shdr.sh_size;
       rodata.number = i;
-      rodata.offset = rodataoff;
+      rodata.offset = e->rodataoff;
     } else if(strncmp(name, ".rel.rodata", 11) == 0) {
       /* using elf32_rel instead of rela */
-      using_relas = 0;
-      rodatarelaoff = shdr.sh_offset;
-      rodatarelasize = shdr.sh_size;
+      e->using_relas = 0;
+      e->rodatarelaoff = shdr.sh_offset;
+      e->rodatarelasize = shdr.sh_size;
     } else if(strncmp(name, ".rela.rodata", 12) == 0) {
-      using_relas = 1;
-      rodatarelaoff = shdr.sh_offset;
-      rodatarelasize = shdr.sh_size;
+      e->using_relas = 1;
+      e->rodatarelaoff = shdr.sh_offset;
+      e->rodatarelasize = shdr.sh_size;
     } else if(strncmp(name, ".rel.data", 9) == 0) {
       /* using elf32_rel instead of rela */
-      using_relas = 0;
-      datarelaoff = shdr.sh_offset;
-      datarelasize = shdr.sh_size;
+      e->using_relas = 0;
+      e->datarelaoff = shdr.sh_offset;
+      e->datarelasize = shdr.sh_size;
     } else if(strncmp(name, ".rela.data", 10) == 0) {
-      using_relas = 1;
-      datarelaoff = shdr.sh_offset;
-      datarelasize = shdr.sh_size;
+      e->using_relas = 1;
+      e->datarelaoff = shdr.sh_offset;
+      e->datarelasize = shdr.sh_size;
     } else if(strncmp(name, ".bss", 4) == 0) {
-      bsssize = shdr.sh_size;
+      e->bsssize = shdr.sh_size;
       bss.number = i;
       bss.offset = 0;
     }
@@ -493,97 +674,303 @@ elfloader_load(int fd)
     shdrptr += shdrsize;
   }
 
-  if(symtabsize == 0) {
+  if(e->symtabsize == 0) {
     return ELFLOADER_NO_SYMTAB;
   }
-  if(strtabsize == 0) {
+  if(e->strtabsize == 0) {
     return ELFLOADER_NO_STRTAB;
   }
-  if(textsize == 0) {
+  if(e->textsize == 0) {
     return ELFLOADER_NO_TEXT;
   }
-
+  return ELFLOADER_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+allocate_sections(struct elf_sections *e)
+{
   PRINTF("before allocate ram\n");
-  bss.address = (char *)elfloader_arch_allocate_ram(bsssize + datasize);
-  data.address = (char *)bss.address + bsssize;
+  bss.address = (char *)elfloader_arch_allocate_ram(e->bsssize + e->datasize);
+  data.address = (char *)bss.address + e->bsssize;
   PRINTF("before allocate rom\n");
-  text.address = (char *)elfloader_arch_allocate_rom(textsize + rodatasize);
-  rodata.address = (char *)text.address + textsize;
+  text.address = (char *)elfloader_arch_allocate_rom(e->textsize + e->rodatasize);
+  rodata.address = (char *)text.address + e->textsize;
   
 
   PRINTF("bss base address: bss.address = 0x%08x\n", bss.address);
   PRINTF("data base address: data.address = 0x%08x\n", data.address);
   PRINTF("text base address: text.address = 0x%08x\n", text.address);
   PRINTF("rodata base address: rodata.address = 0x%08x\n", rodata.address);
+}
+/*---------------------------------------------------------------------------*/
+static int
+relocate(int fd, struct elf_sections *e,
+	 unsigned short relaoff, unsigned short relasize,
+	 unsigned short off, struct relevant_section *sect)
+{
+  if(relasize == 0) {
+    return ELFLOADER_OK;
+  }
+  return relocate_section(fd,
+			  relaoff, relasize,
+			  off,
+			  sect->address,
+			  e->strs,
+			  e->strtaboff,
+			  e->symtaboff, e->symtabsize, e->using_relas);
+}
+/*---------------------------------------------------------------------------*/
+static void
+load_data(int fd, struct elf_sections *e)
+{
+  /* This must be done after the text and rodata segments have been
+     written, since the architecture code may use the module RAM as
+     a buffer when writing to ROM. */
+  memset(bss.address, 0, e->bsssize);
+  seek_read(fd, e->dataoff, data.address, e->datasize);
+}
+/*---------------------------------------------------------------------------*/
+static int
+find_autostart(int fd, struct elf_sections *e)
+{
+  struct process **process;
+
+  PRINTF("elfloader: autostart search\n");
+  process = (struct process **) find_local_symbol(fd, "autostart_processes", e->symtaboff, e->symtabsize, e->strtaboff);
+  if(process != NULL) {
+    PRINTF("elfloader: autostart found\n");
+    elfloader_autostart_processes = process;
+    return ELFLOADER_OK;
+  } else {
+    PRINTF("elfloader: no autostart\n");
+    process = (struct process **) find_program_processes(fd, e->symtaboff, e->symtabsize, e->strtaboff);
+    if(process != NULL) {
+      PRINTF("elfloader: FOUND PRG\n");
+    }
+    return ELFLOADER_NO_STARTPOINT;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+elfloader_load(int fd)
+{
+  struct elf32_ehdr ehdr;
+  struct elf_sections e;
+  int ret;
+
+  elfloader_unknown[0] = 0;
+  cache_flush();
+
+  /* The ELF header is located at the start of the buffer. */
+  seek_read(fd, 0, (char *)&ehdr, sizeof(ehdr));
+
+  /*  print_chars(ehdr.e_ident, sizeof(elf_magic_header));
+      print_chars(elf_magic_header, sizeof(elf_magic_header));*/
+  /* Make sure that we have a correct and compatible ELF header. */
+  if(memcmp(ehdr.e_ident, elf_magic_header, sizeof(elf_magic_header)) != 0) {
+    PRINTF("ELF header problems\n");
+    return ELFLOADER_BAD_ELF_HEADER;
+  }
+
+  ret = read_sections(fd, &ehdr, &e);
+  if(ret != ELFLOADER_OK) {
+    return ret;
+  }
 
+  build_symindex(fd, e.symtaboff, e.symtabsize, e.strtaboff);
+
+  allocate_sections(&e);
 
   /* If we have text segment relocations, we process them. */
   PRINTF("elfloader: relocate text\n");
-  if(textrelasize > 0) {
-	    ret = relocate_section(fd,
-			   textrelaoff, textrelasize,
-			   textoff,
-			   text.address,
-			   strs,
-			   strtaboff,
-			   symtaboff, symtabsize, using_relas);
-    if(ret != ELFLOADER_OK) {
-      return ret;
-    }
+  ret = relocate(fd, &e, e.textrelaoff, e.textrelasize, e.textoff, &text);
+  if(ret != ELFLOADER_OK) {
+    return ret;
   }
 
   /* If we have any rodata segment relocations, we process them too. */
   PRINTF("elfloader: relocate rodata\n");
-  if(rodatarelasize > 0) {
-    ret = relocate_section(fd,
-			   rodatarelaoff, rodatarelasize,
-			   rodataoff,
-			   rodata.address,
-			   strs,
-			   strtaboff,
-			   symtaboff, symtabsize, using_relas);
-    if(ret != ELFLOADER_OK) {
-      PRINTF("elfloader: data failed\n");
-      return ret;
-    }
+  ret = relocate(fd, &e, e.rodatarelaoff, e.rodatarelasize,
+		 e.rodataoff, &rodata);
+  if(ret != ELFLOADER_OK) {
+    PRINTF("elfloader: data failed\n");
+    return ret;
   }
 
   /* If we have any data segment relocations, we process them too. */
   PRINTF("elfloader: relocate data\n");
-  if(datarelasize > 0) {
-    ret = relocate_section(fd,
-			   datarelaoff, datarelasize,
-			   dataoff,
-			   data.address,
-			   strs,
-			   strtaboff,
-			   symtaboff, symtabsize, using_relas);
+  ret = relocate(fd, &e, e.datarelaoff, e.datarelasize, e.dataoff, &data);
+  if(ret != ELFLOADER_OK) {
+    PRINTF("elfloader: data failed\n");
+    return ret;
+  }
+
+  /* Write text and rodata segment into flash and data segment into RAM. */
+  elfloader_arch_write_rom(fd, e.textoff, e.textsize, text.address);
+  elfloader_arch_write_rom(fd, e.rodataoff, e.rodatasize, rodata.address);
+  
+  load_data(fd, &e);
+
+  return find_autostart(fd, &e);
+}
+/*---------------------------------------------------------------------------*/
+#if ELFLOADER_CONF_STREAM
+/*
+ * The streaming loader does the same work as elfloader_load(), but
+ * in steps that are taken as soon as the parts of the file that they
+ * depend on have been received. With the section order produced by
+ * tools/elf-stream-order (headers and symbol tables first, each
+ * section directly followed by its relocations) the module is
+ * relocated and written to its final location while the rest of the
+ * file is still being transferred. Files with other section orders
+ * still load, but most of the work is then done at the end.
+ */
+enum {
+  STREAM_HEADER,
+  STREAM_SECTIONS,
+  STREAM_SYMBOLS,
+  STREAM_TEXT,
+  STREAM_RODATA,
+  STREAM_DATA,
+  STREAM_DONE,
+};
+
+static struct {
+  unsigned char state;
+  int result;
+  struct elf32_ehdr ehdr;
+  struct elf_sections e;
+} stream;
+/*---------------------------------------------------------------------------*/
+void
+elfloader_stream_open(void)
+{
+  elfloader_unknown[0] = 0;
+  stream.state = STREAM_HEADER;
+  stream.result = ELFLOADER_STREAM_MORE;
+}
+/*---------------------------------------------------------------------------*/
+static int
+received(unsigned int len, unsigned int off, unsigned int size)
+{
+  return off + size <= len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+stream_step(int fd, unsigned int len)
+{
+  struct elf_sections *e = &stream.e;
+  struct elf32_shdr shdr;
+  int ret;
+
+  switch(stream.state) {
+  case STREAM_HEADER:
+    if(!received(len, 0, sizeof(stream.ehdr))) {
+      return ELFLOADER_STREAM_MORE;
+    }
+    seek_read(fd, 0, (char *)&stream.ehdr, sizeof(stream.ehdr));
+    if(memcmp(stream.ehdr.e_ident, elf_magic_header,
+	      sizeof(elf_magic_header)) != 0) {
+      return ELFLOADER_BAD_ELF_HEADER;
+    }
+    break;
+
+  case STREAM_SECTIONS:
+    /* The section names are needed to classify the sections, so we
+       wait for both the section header table and .shstrtab. */
+    if(!received(len, stream.ehdr.e_shoff,
+		 stream.ehdr.e_shentsize * stream.ehdr.e_shnum)) {
+      return ELFLOADER_STREAM_MORE;
+    }
+    seek_read(fd, stream.ehdr.e_shoff +
+	      stream.ehdr.e_shentsize * stream.ehdr.e_shstrndx,
+	      (char *)&shdr, sizeof(shdr));
+    if(!received(len, shdr.sh_offset, shdr.sh_size)) {
+      return ELFLOADER_STREAM_MORE;
+    }
+    ret = read_sections(fd, &stream.ehdr, e);
+    if(ret != ELFLOADER_OK) {
+      return ret;
+    }
+    allocate_sections(e);
+    break;
+
+  case STREAM_SYMBOLS:
+    if(!received(len, e->symtaboff, e->symtabsize) ||
+       !received(len, e->strtaboff, e->strtabsize)) {
+      return ELFLOADER_STREAM_MORE;
+    }
+    build_symindex(fd, e->symtaboff, e->symtabsize, e->strtaboff);
+    break;
+
+  case STREAM_TEXT:
+    if(!received(len, e->textoff, e->textsize) ||
+       !received(len, e->textrelaoff, e->textrelasize)) {
+      return ELFLOADER_STREAM_MORE;
+    }
+    ret = relocate(fd, e, e->textrelaoff, e->textrelasize, e->textoff, &text);
     if(ret != ELFLOADER_OK) {
-      PRINTF("elfloader: data failed\n");
       return ret;
     }
+    elfloader_arch_write_rom(fd, e->textoff, e->textsize, text.address);
+    break;
+
+  case STREAM_RODATA:
+    if(!received(len, e->rodataoff, e->rodatasize) ||
+       !received(len, e->rodatarelaoff, e->rodatarelasize)) {
+      return ELFLOADER_STREAM_MORE;
+    }
+    ret = relocate(fd, e, e->rodatarelaoff, e->rodatarelasize,
+		   e->rodataoff, &rodata);
+    if(ret != ELFLOADER_OK) {
+      return ret;
+    }
+    elfloader_arch_write_rom(fd, e->rodataoff, e->rodatasize, rodata.address);
+    break;
+
+  case STREAM_DATA:
+    if(!received(len, e->dataoff, e->datasize) ||
+       !received(len, e->datarelaoff, e->datarelasize)) {
+      return ELFLOADER_STREAM_MORE;
+    }
+    ret = relocate(fd, e, e->datarelaoff, e->datarelasize, e->dataoff, &data);
+    if(ret != ELFLOADER_OK) {
+      return ret;
+    }
+    load_data(fd, e);
+    break;
+
+  case STREAM_DONE:
+    return find_autostart(fd, e);
   }
 
-  /* Write text and rodata segment into flash and data segment into RAM. */
-  elfloader_arch_write_rom(fd, textoff, textsize, text.address);
-  elfloader_arch_write_rom(fd, rodataoff, rodatasize, rodata.address);
-  
-  memset(bss.address, 0, bsssize);
-  seek_read(fd, dataoff, data.address, datasize);
+  stream.state++;
+  return ELFLOADER_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+elfloader_stream_data(int fd, unsigned int len)
+{
+  int ret;
 
-  PRINTF("elfloader: autostart search\n");
-  process = (struct process **) find_local_symbol(fd, "autostart_processes", symtaboff, symtabsize, strtaboff);
-  if(process != NULL) {
-    PRINTF("elfloader: autostart found\n");
-    elfloader_autostart_processes = process;
-    return ELFLOADER_OK;
-  } else {
-    PRINTF("elfloader: no autostart\n");
-    process = (struct process **) find_program_processes(fd, symtaboff, symtabsize, strtaboff);
-    if(process != NULL) {
-      PRINTF("elfloader: FOUND PRG\n");
+  if(stream.result != ELFLOADER_STREAM_MORE) {
+    return stream.result;
+  }
+
+  /* The file may have grown since we last looked at it. */
+  cache_flush();
+
+  while(stream.state != STREAM_DONE) {
+    ret = stream_step(fd, len);
+    if(ret == ELFLOADER_STREAM_MORE) {
+      return ret;
+    } else if(ret != ELFLOADER_OK) {
+      stream.result = ret;
+      return ret;
     }
-    return ELFLOADER_NO_STARTPOINT;
   }
+  stream.result = stream_step(fd, len);
+  return stream.result;
 }
+#endif /* ELFLOADER_CONF_STREAM */
 /*---------------------------------------------------------------------------*/
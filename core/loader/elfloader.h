@@ -119,6 +119,11 @@
  * point could be found in the loaded module.
  */
 #define ELFLOADER_NO_STARTPOINT       7
+/**
+ * Return value from elfloader_stream_data() indicating that more of
+ * the file must be received before loading can continue.
+ */
+#define ELFLOADER_STREAM_MORE         8
 
 /**
  * elfloader initialization function.
@@ -148,6 +153,45 @@ void elfloader_init(void);
  */
 int elfloader_load(int fd);
 
+/**
+ * \brief      Prepare the streaming loader for a new ELF file.
+ *
+ *             This function must be called before the first call to
+ *             elfloader_stream_data(). The streaming loader is only
+ *             available if ELFLOADER_CONF_STREAM is set.
+ */
+void elfloader_stream_open(void);
+
+/**
+ * \brief      Continue loading an ELF file that is being received.
+ * \param fd   An open CFS file descriptor for the file.
+ * \param len  The number of bytes, counted from the start of the
+ *             file, that have been received and written to the file.
+ * \return     ELFLOADER_STREAM_MORE if more data is needed,
+ *             ELFLOADER_OK if the module was loaded, or an error value.
+ *
+ *             This function is called by the code that receives a
+ *             module, e.g. from the write callback of a bulk transfer
+ *             protocol, each time the contiguous part of the file has
+ *             grown. The loader relocates and writes out every
+ *             section as soon as the section, its relocations and the
+ *             symbol table are in the file, so the work overlaps with
+ *             the transfer. Use tools/elf-stream-order to put the
+ *             sections of a module in an order that lets this happen
+ *             early.
+ *
+ *             If the whole file has been received and the function
+ *             still returns ELFLOADER_STREAM_MORE, the file is
+ *             truncated.
+ *
+ * \note       Like elfloader_load(), this function modifies the
+ *             file: sections are relocated in place. The receiver
+ *             must therefore not write to the first len bytes of the
+ *             file again, e.g. when a chunk is retransmitted. See
+ *             examples/sky/tcprudolph0.c.
+ */
+int elfloader_stream_data(int fd, unsigned int len);
+
 /**
  * A pointer to the processes loaded with elfloader_load().
  */
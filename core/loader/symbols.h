@@ -42,4 +42,11 @@ extern const int symbols_nelts;
 
 extern const struct symbols symbols[/* symbols_nelts */];
 
+/* Open addressing index into symbols[], used when SYMTAB_CONF_HASH is
+   set. The size is a power of two and empty slots hold
+   SYMBOLS_HASH_EMPTY. */
+#define SYMBOLS_HASH_EMPTY 0xffff
+extern const unsigned short symbols_hash_size;
+extern const unsigned short symbols_hash[/* symbols_hash_size */];
+
 #endif /* __SYMBOLS_H__ */
@@ -42,8 +42,46 @@
 #define SYMTAB_CONF_BINARY_SEARCH 1
 #endif
 
+/* Hashed lookup needs the symbols_hash[] table generated by
+   tools/make-symbols-nm, so it is not on by default. */
+#ifndef SYMTAB_CONF_HASH
+#define SYMTAB_CONF_HASH 0
+#endif
+
 /*---------------------------------------------------------------------------*/
-#if SYMTAB_CONF_BINARY_SEARCH
+unsigned short
+symtab_hash(const char *name)
+{
+  unsigned short h;
+
+  h = 5381;
+  while(*name != 0) {
+    h = ((h << 5) + h) ^ (unsigned char)*name++;
+  }
+  return h;
+}
+
+/*---------------------------------------------------------------------------*/
+#if SYMTAB_CONF_HASH
+void *
+symtab_lookup(const char *name)
+{
+  unsigned short mask, h, i;
+
+  mask = symbols_hash_size - 1;
+  h = symtab_hash(name) & mask;
+
+  /* The generator keeps at least half of the slots empty, so the
+     probe sequence always terminates. */
+  while((i = symbols_hash[h]) != SYMBOLS_HASH_EMPTY) {
+    if(strcmp(name, symbols[i].name) == 0) {
+      return symbols[i].value;
+    }
+    h = (h + 1) & mask;
+  }
+  return NULL;
+}
+#elif SYMTAB_CONF_BINARY_SEARCH
 void *
 symtab_lookup(const char *name)
 {
@@ -79,5 +117,5 @@ symtab_lookup(const char *name)
   }
   return 0;
 }
-#endif /* SYMTAB_CONF_BINARY_SEARCH */
+#endif /* SYMTAB_CONF_HASH */
 /*---------------------------------------------------------------------------*/
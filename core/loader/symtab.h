@@ -35,4 +35,16 @@
 
 void *symtab_lookup(const char *name);
 
+/**
+ * \brief      Compute the 16-bit hash of a symbol name
+ *
+ *             This is the hash used for the symbols_hash[] table
+ *             generated by tools/make-symbols-nm when
+ *             SYMTAB_CONF_HASH is set, and by the ELF loader for its
+ *             index of module-local symbols. The generator script
+ *             contains a copy of this function, so the two must be
+ *             kept in sync.
+ */
+unsigned short symtab_hash(const char *name);
+
 #endif /* __SYMTAB_H__ */
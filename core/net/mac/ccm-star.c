@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         CCM* authentication and encryption (IEEE 802.15.4-2006,
+ *         annex B), on top of an AES-128 driver
+ *
+ *         Each block that is encrypted with AES_128 overlaps with
+ *         preparing or using another block, so that a hardware AES
+ *         engine runs while the CPU works on the data.
+ */
+
+#include "net/mac/ccm-star.h"
+#include "lib/aes-128.h"
+#include <string.h>
+
+#define BLOCK AES_128_BLOCK_SIZE
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* The CBC-MAC state, the key stream block, and the input blocks. */
+static uint8_t x[BLOCK];
+static uint8_t s[BLOCK];
+static uint8_t b[BLOCK];
+static uint8_t ctr[BLOCK];
+/*---------------------------------------------------------------------------*/
+static void
+xor_block(uint8_t *dst, const uint8_t *src, uint8_t len)
+{
+  while(len-- > 0) {
+    *dst++ ^= *src++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_counter(const uint8_t *nonce, uint8_t i)
+{
+  ctr[0] = 1;			/* L - 1 */
+  memcpy(&ctr[1], nonce, CCM_STAR_NONCE_LENGTH);
+  ctr[14] = 0;
+  ctr[15] = i;
+}
+/*---------------------------------------------------------------------------*/
+/* Start the CBC-MAC with B0 and the authenticated data. */
+static void
+mac_header(const uint8_t *nonce, const uint8_t *a, uint8_t a_len,
+           uint8_t m_len, uint8_t mic_len)
+{
+  uint8_t pos, len;
+
+  x[0] = (a_len > 0 ? 0x40 : 0) | (((mic_len - 2) >> 1) << 3) | 1;
+  memcpy(&x[1], nonce, CCM_STAR_NONCE_LENGTH);
+  x[14] = 0;
+  x[15] = m_len;
+  AES_128.start(x);
+
+  if(a_len == 0) {
+    AES_128.finish(x);
+    return;
+  }
+
+  /* The first block holds the length of a, the others only data. */
+  memset(b, 0, BLOCK);
+  b[1] = a_len;
+  len = MIN(a_len, BLOCK - 2);
+  memcpy(&b[2], a, len);
+  pos = len;
+
+  while(1) {
+    AES_128.finish(x);
+    xor_block(x, b, BLOCK);
+    AES_128.start(x);
+    if(pos == a_len) {
+      break;
+    }
+    /* Prepare the next block while the block cipher is busy. */
+    len = MIN(a_len - pos, BLOCK);
+    memcpy(b, &a[pos], len);
+    memset(&b[len], 0, BLOCK - len);
+    pos += len;
+  }
+  AES_128.finish(x);
+}
+/*---------------------------------------------------------------------------*/
+/* Run CTR mode over m, and the CBC-MAC over its plaintext. */
+static void
+crypt(const uint8_t *nonce, uint8_t *m, uint8_t m_len, uint8_t mic_len,
+      int encrypt)
+{
+  uint8_t pos, len, i;
+
+  for(i = 1, pos = 0; pos < m_len; i++, pos += len) {
+    len = MIN(m_len - pos, BLOCK);
+
+    set_counter(nonce, i);
+    AES_128.start(ctr);
+    if(encrypt && mic_len > 0) {
+      /* The plaintext goes into the MAC while the key stream is
+         computed. */
+      xor_block(x, &m[pos], len);
+    }
+    AES_128.finish(s);
+
+    if(mic_len == 0) {
+      xor_block(&m[pos], s, len);
+    } else if(encrypt) {
+      AES_128.start(x);
+      xor_block(&m[pos], s, len);
+      AES_128.finish(x);
+    } else {
+      xor_block(&m[pos], s, len);
+      xor_block(x, &m[pos], len);
+      AES_128.start(x);
+      AES_128.finish(x);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Encrypt the tag in x with the first key stream block. */
+static void
+encrypt_tag(const uint8_t *nonce, uint8_t mic_len)
+{
+  set_counter(nonce, 0);
+  AES_128.start(ctr);
+  AES_128.finish(s);
+  xor_block(x, s, mic_len);
+}
+/*---------------------------------------------------------------------------*/
+void
+ccm_star_encrypt(const uint8_t *nonce,
+                 const uint8_t *a, uint8_t a_len,
+                 uint8_t *m, uint8_t m_len,
+                 uint8_t *mic, uint8_t mic_len)
+{
+  if(mic_len > 0) {
+    mac_header(nonce, a, a_len, m_len, mic_len);
+  }
+  crypt(nonce, m, m_len, mic_len, 1);
+  if(mic_len > 0) {
+    encrypt_tag(nonce, mic_len);
+    memcpy(mic, x, mic_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+ccm_star_decrypt(const uint8_t *nonce,
+                 const uint8_t *a, uint8_t a_len,
+                 uint8_t *m, uint8_t m_len,
+                 const uint8_t *mic, uint8_t mic_len)
+{
+  uint8_t i, diff;
+
+  if(mic_len > 0) {
+    mac_header(nonce, a, a_len, m_len, mic_len);
+  }
+  crypt(nonce, m, m_len, mic_len, 0);
+  if(mic_len == 0) {
+    return 1;
+  }
+  encrypt_tag(nonce, mic_len);
+
+  /* Compare all bytes, so that the time does not depend on where the
+     first difference is. */
+  diff = 0;
+  for(i = 0; i < mic_len; i++) {
+    diff |= x[i] ^ mic[i];
+  }
+  return diff == 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         CCM* authentication and encryption, as used by IEEE 802.15.4
+ */
+
+#ifndef __CCM_STAR_H__
+#define __CCM_STAR_H__
+
+#include "contiki-conf.h"
+
+/* The length of the nonce. The length field is always two bytes. */
+#define CCM_STAR_NONCE_LENGTH 13
+
+/**
+ * \brief      Authenticate and encrypt data
+ * \param nonce A nonce of CCM_STAR_NONCE_LENGTH bytes
+ * \param a    Data that is authenticated but not encrypted
+ * \param a_len The length of a
+ * \param m    Data that is authenticated and encrypted in place
+ * \param m_len The length of m
+ * \param mic  Where the message integrity code is stored
+ * \param mic_len The length of the MIC: 0, 4, 8 or 16 bytes
+ *
+ *             The key is set with AES_128.set_key(). With a mic_len
+ *             of zero, m is only encrypted.
+ */
+void ccm_star_encrypt(const uint8_t *nonce,
+                      const uint8_t *a, uint8_t a_len,
+                      uint8_t *m, uint8_t m_len,
+                      uint8_t *mic, uint8_t mic_len);
+
+/**
+ * \brief      Decrypt and verify data
+ * \return     Non-zero if the MIC matches the data
+ *
+ *             The parameters are the same as for
+ *             ccm_star_encrypt(). m is decrypted in place, also if
+ *             the MIC does not match.
+ */
+int ccm_star_decrypt(const uint8_t *nonce,
+                     const uint8_t *a, uint8_t a_len,
+                     uint8_t *m, uint8_t m_len,
+                     const uint8_t *mic, uint8_t mic_len);
+
+#endif /* __CCM_STAR_H__ */
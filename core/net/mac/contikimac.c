@@ -71,6 +71,36 @@
 #ifndef WITH_FAST_SLEEP
 #define WITH_FAST_SLEEP              1
 #endif
+/* With burst mode, a receiver keeps its radio on after it has
+   received a unicast packet with the frame pending bit set (see
+   CSMA_CONF_FRAME_PENDING), and the sender transmits the following
+   packets to the same receiver back-to-back instead of waiting for
+   the next wake-up of the receiver. */
+#ifdef CONTIKIMAC_CONF_WITH_BURST
+#define WITH_BURST                   CONTIKIMAC_CONF_WITH_BURST
+#else
+#define WITH_BURST                   0
+#endif
+
+/* With an adaptive rate, a node raises its channel check rate up to
+   2^ADAPTIVE_MAX_LEVEL times NETSTACK_RDC_CHANNEL_CHECK_RATE when it
+   receives or queues many packets, and lowers it again when the
+   traffic stops. The current rate is advertised in the ContikiMAC
+   header of every packet we send. */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_RATE
+#define WITH_ADAPTIVE_RATE           CONTIKIMAC_CONF_ADAPTIVE_RATE
+#else
+#define WITH_ADAPTIVE_RATE           0
+#endif
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_MAX_LEVEL
+#define ADAPTIVE_MAX_LEVEL           CONTIKIMAC_CONF_ADAPTIVE_MAX_LEVEL
+#else
+#define ADAPTIVE_MAX_LEVEL           2
+#endif
+
+#if WITH_ADAPTIVE_RATE && !WITH_CONTIKIMAC_HEADER
+#error "CONTIKIMAC_CONF_ADAPTIVE_RATE requires the ContikiMAC header"
+#endif
 
 #if NETSTACK_RDC_CHANNEL_CHECK_RATE >= 64
 #undef WITH_PHASE_OPTIMIZATION
@@ -83,6 +113,9 @@
 struct hdr {
   uint8_t id;
   uint8_t len;
+#if WITH_ADAPTIVE_RATE
+  uint8_t rate;
+#endif /* WITH_ADAPTIVE_RATE */
 };
 #endif /* WITH_CONTIKIMAC_HEADER */
 
@@ -93,6 +126,25 @@ struct hdr {
 #define CYCLE_TIME (RTIMER_ARCH_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
 #endif
 
+#if WITH_ADAPTIVE_RATE
+/* The channel check interval is CYCLE_TIME divided by 2^rate_level. */
+static volatile uint8_t rate_level;
+#define CURRENT_CYCLE_TIME (CYCLE_TIME >> rate_level)
+
+/* ADAPT_WINDOW is the number of CYCLE_TIME periods over which the
+   traffic load is counted before the rate is adjusted. The rate is
+   raised if at least ADAPT_UP_THRESHOLD packets were received or
+   queued during the window, and lowered if at most
+   ADAPT_DOWN_THRESHOLD packets were. */
+#define ADAPT_WINDOW                       8
+#define ADAPT_UP_THRESHOLD                 (ADAPT_WINDOW / 2)
+#define ADAPT_DOWN_THRESHOLD               1
+
+static uint8_t adapt_load, adapt_cycles, adapt_subcycle;
+#else /* WITH_ADAPTIVE_RATE */
+#define CURRENT_CYCLE_TIME CYCLE_TIME
+#endif /* WITH_ADAPTIVE_RATE */
+
 
 /* ContikiMAC performs periodic channel checks. Each channel check
    consists of two or more CCA checks. CCA_COUNT_MAX is the number of
@@ -152,11 +204,15 @@ struct hdr {
 #define MAX_PHASE_STROBE_TIME              RTIMER_ARCH_SECOND / 60
 
 
-/* SHORTEST_PACKET_SIZE is the shortest packet that ContikiMAC
-   allows. Packets have to be a certain size to be able to be detected
-   by two consecutive CCA checks, and here is where we define this
-   shortest size. */
-#define SHORTEST_PACKET_SIZE               43
+/* BURST_LISTEN_TIME is the time that a receiver keeps its radio on
+   after it has received a packet with the frame pending bit set. */
+#define BURST_LISTEN_TIME                  RTIMER_ARCH_SECOND / 40
+
+/* BURST_STROBE_TIME is the time that we transmit repeated packets to
+   a neighbor that keeps its radio on for a burst. */
+#define BURST_STROBE_TIME                  RTIMER_ARCH_SECOND / 100
+
+#define SHORTEST_PACKET_SIZE               CONTIKIMAC_SHORTEST_PACKET_SIZE
 
 
 #define ACK_LEN 3
@@ -211,6 +267,17 @@ static volatile rtimer_clock_t stream_until;
 
 #define DEFAULT_STREAM_TIME (4 * CYCLE_TIME)
 
+#if WITH_BURST
+/* The receiver that we are sending a burst to. */
+static uint8_t is_bursting;
+static rimeaddr_t burst_receiver;
+static rtimer_clock_t burst_until;
+
+/* Set when a sender has told us that more packets follow. */
+static volatile uint8_t is_receiving_burst;
+static volatile rtimer_clock_t receive_burst_until;
+#endif /* WITH_BURST */
+
 #ifndef MIN
 #define MIN(a, b) ((a) < (b)? (a) : (b))
 #endif /* MIN */
@@ -284,6 +351,42 @@ off(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if WITH_ADAPTIVE_RATE
+static void
+count_load(void)
+{
+  if(adapt_load < 0xff) {
+    adapt_load++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+adapt_rate(void)
+{
+  /* The rate is only changed at the start of a CYCLE_TIME period, so
+     that the wake-ups at the lowest rate keep the same phase. Phase
+     locks that neighbors have recorded for us remain valid as long
+     as the rate does not go down. */
+  adapt_subcycle = (adapt_subcycle + 1) & ((1 << rate_level) - 1);
+  if(adapt_subcycle != 0) {
+    return;
+  }
+  if(++adapt_cycles < ADAPT_WINDOW) {
+    return;
+  }
+  adapt_cycles = 0;
+
+  if(adapt_load >= ADAPT_UP_THRESHOLD && rate_level < ADAPTIVE_MAX_LEVEL) {
+    rate_level++;
+    PRINTF("contikimac: raise rate level to %u\n", rate_level);
+  } else if(adapt_load <= ADAPT_DOWN_THRESHOLD && rate_level > 0) {
+    rate_level--;
+    PRINTF("contikimac: lower rate level to %u\n", rate_level);
+  }
+  adapt_load = 0;
+}
+#endif /* WITH_ADAPTIVE_RATE */
+/*---------------------------------------------------------------------------*/
 static volatile rtimer_clock_t cycle_start;
 static char powercycle(struct rtimer *t, void *ptr);
 static void
@@ -322,6 +425,20 @@ schedule_powercycle_fixed(struct rtimer *t, rtimer_clock_t fixed_time)
   }
 }
 /*---------------------------------------------------------------------------*/
+static int
+receiving_burst(void)
+{
+#if WITH_BURST
+  if(is_receiving_burst &&
+     !RTIMER_CLOCK_LT(RTIMER_NOW(), receive_burst_until)) {
+    is_receiving_burst = 0;
+  }
+  return is_receiving_burst;
+#else /* WITH_BURST */
+  return 0;
+#endif /* WITH_BURST */
+}
+/*---------------------------------------------------------------------------*/
 static void
 powercycle_turn_radio_off(void)
 {
@@ -329,7 +446,7 @@ powercycle_turn_radio_off(void)
   uint8_t was_on = radio_is_on;
 #endif /* CONTIKIMAC_CONF_COMPOWER */
   
-  if(we_are_sending == 0) {
+  if(we_are_sending == 0 && !receiving_burst()) {
     off();
 #if CONTIKIMAC_CONF_COMPOWER
     if(was_on && !radio_is_on) {
@@ -359,7 +476,11 @@ powercycle(struct rtimer *t, void *ptr)
     static rtimer_clock_t t0;
     static uint8_t count;
 
-    cycle_start += CYCLE_TIME;
+    cycle_start += CURRENT_CYCLE_TIME;
+
+#if WITH_ADAPTIVE_RATE
+    adapt_rate();
+#endif /* WITH_ADAPTIVE_RATE */
 
     if(WITH_STREAMING && is_streaming) {
       if(!RTIMER_CLOCK_LT(RTIMER_NOW(), stream_until)) {
@@ -450,10 +571,12 @@ powercycle(struct rtimer *t, void *ptr)
         }
       }
     } while((is_snooping || is_streaming) &&
-            RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start, CYCLE_TIME - CHECK_TIME * 8));
+            RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start,
+                            CURRENT_CYCLE_TIME - CHECK_TIME * 8));
 
-    if(RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start, CYCLE_TIME - CHECK_TIME * 4)) {
-      schedule_powercycle_fixed(t, CYCLE_TIME + cycle_start);
+    if(RTIMER_CLOCK_LT(RTIMER_NOW() - cycle_start,
+                       CURRENT_CYCLE_TIME - CHECK_TIME * 4)) {
+      schedule_powercycle_fixed(t, CURRENT_CYCLE_TIME + cycle_start);
       PT_YIELD(&pt);
     }
   }
@@ -493,6 +616,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
   uint8_t is_broadcast = 0;
   uint8_t is_reliable = 0;
   uint8_t is_known_receiver = 0;
+  uint8_t is_in_burst = 0;
   uint8_t collisions;
   int transmit_len;
   int i;
@@ -537,6 +661,17 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
   is_reliable = packetbuf_attr(PACKETBUF_ATTR_RELIABLE) ||
     packetbuf_attr(PACKETBUF_ATTR_ERELIABLE);
 
+#if WITH_BURST
+  /* If the previous packet to this receiver had the frame pending bit
+     set, the receiver is still awake and we send immediately. */
+  if(!is_broadcast && is_bursting &&
+     rimeaddr_cmp(&burst_receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER)) &&
+     RTIMER_CLOCK_LT(RTIMER_NOW(), burst_until)) {
+    is_in_burst = 1;
+  }
+  is_bursting = 0;
+#endif /* WITH_BURST */
+
   if(WITH_STREAMING) {
     if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
        PACKETBUF_ATTR_PACKET_TYPE_STREAM) {
@@ -558,35 +693,50 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
   }
   packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
 
+  if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL)) {
+    /* The frame was created and secured before it was deferred by
+       phase_wait(), and is sent as it is. */
+    hdrlen = 0;
+  } else {
 #if WITH_CONTIKIMAC_HEADER
-  hdrlen = packetbuf_totlen();
-  if(packetbuf_hdralloc(sizeof(struct hdr)) == 0) {
-    /* Failed to allocate space for contikimac header */
-    PRINTF("contikimac: send failed, too large header\n");
-    return MAC_TX_ERR_FATAL;
-  }
-  chdr = packetbuf_hdrptr();
-  chdr->id = CONTIKIMAC_ID;
-  chdr->len = hdrlen;
-  
-  /* Create the MAC header for the data packet. */
-  hdrlen = NETSTACK_FRAMER.create();
-  if(hdrlen == 0) {
-    /* Failed to send */
-    PRINTF("contikimac: send failed, too large header\n");
-    packetbuf_hdr_remove(sizeof(struct hdr));
-    return MAC_TX_ERR_FATAL;
-  }
-  hdrlen += sizeof(struct hdr);
+    hdrlen = packetbuf_totlen();
+    if(packetbuf_hdralloc(sizeof(struct hdr)) == 0) {
+      /* Failed to allocate space for contikimac header */
+      PRINTF("contikimac: send failed, too large header\n");
+      return MAC_TX_ERR_FATAL;
+    }
+    chdr = packetbuf_hdrptr();
+    chdr->id = CONTIKIMAC_ID;
+    chdr->len = hdrlen;
+#if WITH_ADAPTIVE_RATE
+    chdr->rate = rate_level;
+
+    /* A packet that is followed by more packets in the MAC queue counts
+       towards our load. */
+    if(packetbuf_attr(PACKETBUF_ATTR_PENDING)) {
+      count_load();
+    }
+#endif /* WITH_ADAPTIVE_RATE */
+
+    /* Create the MAC header for the data packet. */
+    hdrlen = NETSTACK_FRAMER.create();
+    if(hdrlen == 0) {
+      /* Failed to send */
+      PRINTF("contikimac: send failed, too large header\n");
+      packetbuf_hdr_remove(sizeof(struct hdr));
+      return MAC_TX_ERR_FATAL;
+    }
+    hdrlen += sizeof(struct hdr);
 #else
-  /* Create the MAC header for the data packet. */
-  hdrlen = NETSTACK_FRAMER.create();
-  if(hdrlen == 0) {
-    /* Failed to send */
-    PRINTF("contikimac: send failed, too large header\n");
-    return MAC_TX_ERR_FATAL;
-  }
+    /* Create the MAC header for the data packet. */
+    hdrlen = NETSTACK_FRAMER.create();
+    if(hdrlen == 0) {
+      /* Failed to send */
+      PRINTF("contikimac: send failed, too large header\n");
+      return MAC_TX_ERR_FATAL;
+    }
 #endif
+  }
 
 
   /* Make sure that the packet is longer or equal to the shortest
@@ -595,6 +745,15 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
   if(transmit_len < SHORTEST_PACKET_SIZE) {
     /* Pad with zeroes */
     uint8_t *ptr;
+
+    if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL)) {
+      /* The padding would be taken as part of the MIC; the framer
+         must pad the frame before securing it. */
+      PRINTF("contikimac: secured frame shorter than shortest (%d)\n",
+             packetbuf_totlen());
+      packetbuf_hdr_remove(hdrlen);
+      return MAC_TX_ERR_FATAL;
+    }
     ptr = packetbuf_dataptr();
     memset(ptr + packetbuf_datalen(), 0, SHORTEST_PACKET_SIZE - packetbuf_totlen());
 
@@ -607,10 +766,14 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
 
   NETSTACK_RADIO.prepare(packetbuf_hdrptr(), transmit_len);
 
-  /* Remove the MAC-layer header since it will be recreated next time around. */
-  packetbuf_hdr_remove(hdrlen);
+  /* Remove the MAC-layer header since it will be recreated next time
+     around. A secured frame keeps its header, since its payload is
+     already encrypted. */
+  if(!packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL)) {
+    packetbuf_hdr_remove(hdrlen);
+  }
 
-  if(!is_broadcast && !is_streaming) {
+  if(!is_broadcast && !is_streaming && !is_in_burst) {
 #if WITH_PHASE_OPTIMIZATION
     ret = phase_wait(&phase_list, packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
                      CYCLE_TIME, GUARD_TIME,
@@ -660,7 +823,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
   contikimac_was_on = contikimac_is_on;
   contikimac_is_on = 1;
   
-  if(is_streaming == 0) {
+  if(is_streaming == 0 && is_in_burst == 0) {
     /* Check if there are any transmissions by others. */
     for(i = 0; i < CCA_COUNT_MAX; ++i) {
       t0 = RTIMER_NOW();
@@ -702,6 +865,12 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
       PRINTF("miss to %d\n", packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0]);
       break;
     }
+
+    if(is_in_burst && !RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + BURST_STROBE_TIME)) {
+      PRINTF("contikimac: burst to %d lost\n",
+             packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0]);
+      break;
+    }
     
     len = 0;
 
@@ -793,13 +962,25 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr)
   }
 
   if(!is_broadcast) {
-    if(collisions == 0 && is_streaming == 0) {
+    /* Packets in a burst are not sent at the wake-up phase of the
+       receiver, so they do not update the phase estimate. */
+    if(collisions == 0 && is_streaming == 0 && is_in_burst == 0) {
       phase_update(&phase_list, packetbuf_addr(PACKETBUF_ADDR_RECEIVER), encounter_time,
                    ret);
     }
   }
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+#if WITH_BURST
+  if(got_strobe_ack && packetbuf_attr(PACKETBUF_ATTR_PENDING)) {
+    /* Leave a margin so that the next packet reaches the receiver
+       before it turns its radio off. */
+    is_bursting = 1;
+    rimeaddr_copy(&burst_receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    burst_until = RTIMER_NOW() + BURST_LISTEN_TIME / 2;
+  }
+#endif /* WITH_BURST */
+
   if(WITH_STREAMING) {
     if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
        PACKETBUF_ATTR_PACKET_TYPE_STREAM_END) {
@@ -813,6 +994,9 @@ static void
 qsend_packet(mac_callback_t sent, void *ptr)
 {
   int ret = send_packet(sent, ptr);
+  /* A deferred frame has its own copy. The MAC layer must not copy
+     the mark of a secured frame to its plaintext copy. */
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, 0);
   if(ret != MAC_TX_DEFERRED) {
     mac_call_sent_callback(sent, ptr, ret, 1);
   }
@@ -826,7 +1010,9 @@ input_packet(void)
 
   received +=  packetbuf_datalen();
   
-  off();
+  if(!receiving_burst()) {
+    off();
+  }
 
   /*  printf("cycle_start 0x%02x 0x%02x\n", cycle_start, cycle_start % CYCLE_TIME);*/
   
@@ -842,6 +1028,10 @@ input_packet(void)
     }
     packetbuf_hdrreduce(sizeof(struct hdr));
     packetbuf_set_datalen(chdr->len);
+#if WITH_ADAPTIVE_RATE && WITH_PHASE_OPTIMIZATION
+    phase_set_rate(&phase_list, packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                   chdr->rate);
+#endif /* WITH_ADAPTIVE_RATE && WITH_PHASE_OPTIMIZATION */
 #endif /* WITH_CONTIKIMAC_HEADER */
 
     if(packetbuf_datalen() > 0 &&
@@ -853,14 +1043,33 @@ input_packet(void)
       /* This is a regular packet that is destined to us or to the
          broadcast address. */
 
-#if WITH_PHASE_OPTIMIZATION
+#if WITH_ADAPTIVE_RATE
+      count_load();
+#endif /* WITH_ADAPTIVE_RATE */
+
+#if WITH_BURST
+      /* If the sender has set its pending flag on a packet to us,
+         more packets follow and we keep the radio on for them. The
+         last packet of the burst lets us go back to sleep. */
+      if(rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                      &rimeaddr_node_addr)) {
+        if(packetbuf_attr(PACKETBUF_ATTR_PENDING)) {
+          is_receiving_burst = 1;
+          receive_burst_until = RTIMER_NOW() + BURST_LISTEN_TIME;
+          on();
+        } else if(is_receiving_burst) {
+          is_receiving_burst = 0;
+          off();
+        }
+      }
+#elif WITH_PHASE_OPTIMIZATION
       /* If the sender has set its pending flag, it has its radio
          turned on and we should drop the phase estimation that we
          have from before. */
       if(packetbuf_attr(PACKETBUF_ATTR_PENDING)) {
         phase_remove(&phase_list, packetbuf_addr(PACKETBUF_ADDR_SENDER));
       }
-#endif /* WITH_PHASE_OPTIMIZATION */
+#endif /* WITH_BURST */
 
       /* Check for duplicate packet by comparing the sequence number
          of the incoming packet with the last few ones we saw. */
@@ -959,7 +1168,7 @@ turn_off(int keep_radio_on)
 static unsigned short
 duty_cycle(void)
 {
-  return (1ul * CLOCK_SECOND * CYCLE_TIME) / RTIMER_ARCH_SECOND;
+  return (1ul * CLOCK_SECOND * CURRENT_CYCLE_TIME) / RTIMER_ARCH_SECOND;
 }
 /*---------------------------------------------------------------------------*/
 const struct rdc_driver contikimac_driver = {
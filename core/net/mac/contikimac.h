@@ -45,6 +45,12 @@
 #include "net/mac/rdc.h"
 #include "dev/radio.h"
 
+/* CONTIKIMAC_SHORTEST_PACKET_SIZE is the shortest packet that ContikiMAC
+   allows. Packets have to be a certain size to be able to be detected
+   by two consecutive CCA checks, and here is where we define this
+   shortest size. */
+#define CONTIKIMAC_SHORTEST_PACKET_SIZE 43
+
 extern const struct rdc_driver contikimac_driver;
 
 #endif /* CONTIKIMAC_H */
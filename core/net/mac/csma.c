@@ -75,6 +75,16 @@
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+/* Set the frame pending bit on a unicast packet that is followed in
+   the queue by another packet to the same receiver, and send the next
+   packet as soon as the first has been acknowledged. Radio duty
+   cycling layers use the bit to keep the receiver awake. */
+#ifdef CSMA_CONF_FRAME_PENDING
+#define CSMA_FRAME_PENDING CSMA_CONF_FRAME_PENDING
+#else
+#define CSMA_FRAME_PENDING 0
+#endif /* CSMA_CONF_FRAME_PENDING */
+
 struct queued_packet {
   struct queued_packet *next;
   struct queuebuf *buf;
@@ -113,6 +123,19 @@ default_timebase(void)
   return time;
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_FRAME_PENDING
+static int
+next_has_same_receiver(struct queued_packet *q)
+{
+  struct queued_packet *next;
+
+  next = list_item_next(q);
+  return next != NULL &&
+    rimeaddr_cmp(queuebuf_addr(next->buf, PACKETBUF_ADDR_RECEIVER),
+                 queuebuf_addr(q->buf, PACKETBUF_ADDR_RECEIVER));
+}
+#endif /* CSMA_FRAME_PENDING */
+/*---------------------------------------------------------------------------*/
 static void
 transmit_queued_packet(void *ptr)
 {
@@ -131,6 +154,9 @@ transmit_queued_packet(void *ptr)
 
   if(q != NULL) {
     queuebuf_to_packetbuf(q->buf);
+#if CSMA_FRAME_PENDING
+    packetbuf_set_attr(PACKETBUF_ATTR_PENDING, next_has_same_receiver(q));
+#endif /* CSMA_FRAME_PENDING */
     PRINTF("csma: sending number %d %p, queue len %d\n", q->transmissions, q,
            list_length(queued_packet_list));
     //    printf("s %d\n", packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0]);
@@ -182,6 +208,9 @@ packet_sent(void *ptr, int status, int num_transmissions)
   void *cptr;
   int num_tx;
   int backoff_transmissions;
+#if CSMA_FRAME_PENDING
+  int burst;
+#endif /* CSMA_FRAME_PENDING */
 
   rdc_is_transmitting = 0;
   
@@ -259,7 +288,17 @@ packet_sent(void *ptr, int status, int num_transmissions)
       PRINTF("csma: rexmit failed %d: %d\n", q->transmissions, status);
     }
     /*    queuebuf_to_packetbuf(q->buf);*/
+#if CSMA_FRAME_PENDING
+    burst = status == MAC_TX_OK && next_has_same_receiver(q);
+#endif /* CSMA_FRAME_PENDING */
     free_queued_packet();
+#if CSMA_FRAME_PENDING
+    if(burst) {
+      /* The receiver is still awake, so the next packet is sent
+         without waiting. */
+      ctimer_set(&transmit_timer, 0, transmit_queued_packet, NULL);
+    }
+#endif /* CSMA_FRAME_PENDING */
     mac_call_sent_callback(sent, cptr, status, num_tx);
   }
 }
@@ -123,8 +123,6 @@ field_len(frame802154_t *p, field_length_t *flen)
 
   /* Aux security header */
   if(p->fcf.security_enabled & 1) {
-    /* TODO Aux security header not yet implemented */
-#if 0
     switch(p->aux_hdr.security_control.key_id_mode) {
     case 0:
       flen->aux_sec_len = 5; /* minimum value */
@@ -141,7 +139,6 @@ field_len(frame802154_t *p, field_length_t *flen)
     default:
       break;
     }
-#endif
   }
 }
 /*----------------------------------------------------------------------------*/
@@ -233,8 +230,14 @@ frame802154_create(frame802154_t *p, uint8_t *buf, uint8_t buf_len)
 
   /* Aux header */
   if(flen.aux_sec_len) {
-    /* TODO Aux security header not yet implemented */
-/*     pos += flen.aux_sec_len; */
+    tx_frame_buffer[pos++] = (p->aux_hdr.security_control.security_level & 7) |
+      ((p->aux_hdr.security_control.key_id_mode & 3) << 3);
+    for(c = 0; c < 4; c++) {
+      tx_frame_buffer[pos++] = (p->aux_hdr.frame_counter >> (c * 8)) & 0xff;
+    }
+    /* Key identifier */
+    memcpy(&tx_frame_buffer[pos], p->aux_hdr.key, flen.aux_sec_len - 5);
+    pos += flen.aux_sec_len - 5;
   }
 
   return pos;
@@ -339,8 +342,33 @@ frame802154_parse(uint8_t *data, uint8_t len, frame802154_t *pf)
   }
 
   if(fcf.security_enabled) {
-    /* TODO aux security header, not yet implemented */
-/*     return 0; */
+    /* Aux security header */
+    pf->aux_hdr.security_control.security_level = p[0] & 7;
+    pf->aux_hdr.security_control.key_id_mode = (p[0] >> 3) & 3;
+    pf->aux_hdr.frame_counter = p[1] | ((uint32_t)p[2] << 8) |
+      ((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 24);
+    p += 5;
+
+    /* Key identifier */
+    switch(pf->aux_hdr.security_control.key_id_mode) {
+    case 1:
+      c = 1;
+      break;
+    case 2:
+      c = 5;
+      break;
+    case 3:
+      c = 9;
+      break;
+    default:
+      c = 0;
+      break;
+    }
+    if(p + c - data > len) {
+      return 0;
+    }
+    memcpy(pf->aux_hdr.key, p, c);
+    p += c;
   }
 
   /* header length */
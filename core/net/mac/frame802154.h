@@ -140,7 +140,7 @@ typedef struct {
 typedef struct {
   frame802154_scf_t security_control;  /**< Security control bitfield */
   uint32_t frame_counter;   /**< Frame counter, used for security */
-  uint8_t  key[9];          /**< The key itself, or an index to the key */
+  uint8_t  key[9];          /**< Key identifier: the key source, if any, followed by the key index */
 } frame802154_aux_hdr_t;
 
 /** \brief Parameters used by the frame802154_create() function.  These
@@ -40,6 +40,12 @@
 #include "net/mac/framer-802154.h"
 #include "net/mac/frame802154.h"
 #include "net/packetbuf.h"
+#include "net/netcapture.h"
+#include "net/netstack.h"
+#include "net/mac/contikimac.h"
+#include "cfs/cfs.h"
+#include "net/mac/ccm-star.h"
+#include "lib/aes-128.h"
 #include "lib/random.h"
 #include <string.h>
 
@@ -54,11 +60,100 @@
 #define PRINTADDR(addr)
 #endif
 
+/*
+ * The security level of all frames, as in IEEE 802.15.4-2006: 0 for
+ * no security, 1-3 for a MIC of 4, 8 or 16 bytes, 4 for encryption
+ * only, and 5-7 for encryption with a MIC of 4, 8 or 16 bytes. If
+ * non-zero, frames with another security level are dropped.
+ */
+#ifdef FRAMER_802154_CONF_SECURITY_LEVEL
+#define SECURITY_LEVEL FRAMER_802154_CONF_SECURITY_LEVEL
+#else /* FRAMER_802154_CONF_SECURITY_LEVEL */
+#define SECURITY_LEVEL 0
+#endif /* FRAMER_802154_CONF_SECURITY_LEVEL */
+
+/* IS_CONTIKIMAC(NETSTACK_RDC) is 1 if the RDC is ContikiMAC. */
+#define IS_CONTIKIMAC_contikimac_driver 1
+#define IS_CONTIKIMAC2(rdc) IS_CONTIKIMAC_##rdc
+#define IS_CONTIKIMAC(rdc) IS_CONTIKIMAC2(rdc)
+
+/*
+ * Secured frames are padded to at least this length before the MIC
+ * is added. An RDC that pads short frames itself, such as ContikiMAC,
+ * needs this to be at least as long, since its padding would come
+ * after the MIC.
+ */
+#ifdef FRAMER_802154_CONF_SHORTEST_FRAME
+#define SHORTEST_FRAME FRAMER_802154_CONF_SHORTEST_FRAME
+#elif IS_CONTIKIMAC(NETSTACK_RDC)
+#define SHORTEST_FRAME CONTIKIMAC_SHORTEST_PACKET_SIZE
+#else /* FRAMER_802154_CONF_SHORTEST_FRAME */
+#define SHORTEST_FRAME 0
+#endif /* FRAMER_802154_CONF_SHORTEST_FRAME */
+
+#if IS_CONTIKIMAC(NETSTACK_RDC) && SECURITY_LEVEL && \
+    SHORTEST_FRAME < CONTIKIMAC_SHORTEST_PACKET_SIZE
+#error FRAMER_802154_CONF_SHORTEST_FRAME is shorter than ContikiMAC frames
+#endif
+
+/*
+ * A frame counter must never be used twice with the same key, also
+ * not after a reboot. The counters are reserved this many at a time
+ * by storing the end of the reserved range, so at most this many are
+ * skipped when the node reboots. The two files are written in turn,
+ * so that one is intact if the node resets during a write. If both
+ * are damaged, the counter skips COUNTER_SKIP ahead of what is left
+ * of them.
+ */
+#ifdef FRAMER_802154_CONF_COUNTER_STEP
+#define COUNTER_STEP FRAMER_802154_CONF_COUNTER_STEP
+#else /* FRAMER_802154_CONF_COUNTER_STEP */
+#define COUNTER_STEP 256
+#endif /* FRAMER_802154_CONF_COUNTER_STEP */
+
+#define COUNTER_SKIP ((uint32_t)COUNTER_STEP << 8)
+
+/* The number of neighbors whose frame counters are remembered. */
+#ifdef FRAMER_802154_CONF_NEIGHBORS
+#define NEIGHBORS FRAMER_802154_CONF_NEIGHBORS
+#else /* FRAMER_802154_CONF_NEIGHBORS */
+#define NEIGHBORS 8
+#endif /* FRAMER_802154_CONF_NEIGHBORS */
+
 static uint8_t mac_dsn;
 static uint8_t initialized = 0;
 static const uint16_t mac_dst_pan_id = IEEE802154_PANID;
 static const uint16_t mac_src_pan_id = IEEE802154_PANID;
 
+#if SECURITY_LEVEL
+#define MIC_LEN ((SECURITY_LEVEL & 3) ? (2 << (SECURITY_LEVEL & 3)) : 0)
+#define ENCRYPT (SECURITY_LEVEL & 4)
+
+/*
+ * The highest frame counter received from each neighbor, to drop
+ * replayed frames. The most recently heard neighbor is first, and a
+ * new neighbor replaces the one that was heard from longest ago.
+ */
+struct counter {
+  rimeaddr_t addr;
+  uint32_t frame_counter;
+};
+static struct counter counters[NEIGHBORS];
+static uint8_t num_counters;
+
+static uint32_t frame_counter;
+static uint32_t counter_limit;
+static uint8_t counter_slot;
+static uint8_t key_set;
+
+static const char *counter_files[2] = { "frame-counter0", "frame-counter1" };
+
+struct counter_record {
+  uint32_t limit;
+  uint32_t check;
+};
+#endif /* SECURITY_LEVEL */
+
 /*---------------------------------------------------------------------------*/
 static int
 is_broadcast_addr(uint8_t mode, uint8_t *addr)
@@ -72,6 +167,209 @@ is_broadcast_addr(uint8_t mode, uint8_t *addr)
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+void
+framer_802154_set_key(const uint8_t *key)
+{
+  AES_128.set_key(key);
+#if SECURITY_LEVEL
+  key_set = 1;
+#endif /* SECURITY_LEVEL */
+}
+/*---------------------------------------------------------------------------*/
+#if SECURITY_LEVEL
+static void
+set_nonce(uint8_t *nonce, const uint8_t *addr, uint32_t counter)
+{
+  /* The extended source address, the frame counter and the level. */
+  memset(nonce, 0, 8);
+  memcpy(&nonce[8 - sizeof(rimeaddr_t)], addr, sizeof(rimeaddr_t));
+  nonce[8] = counter >> 24;
+  nonce[9] = counter >> 16;
+  nonce[10] = counter >> 8;
+  nonce[11] = counter;
+  nonce[12] = SECURITY_LEVEL;
+}
+/*---------------------------------------------------------------------------*/
+/* Read the end of the reserved range from a file. Returns 1 if the
+   file is intact, 0 if it does not exist and -1 if it is damaged, in
+   which case limit is what could be read. */
+static int
+read_counter_file(uint8_t slot, uint32_t *limit)
+{
+  struct counter_record r;
+  int fd, n;
+
+  fd = cfs_open(counter_files[slot], CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  memset(&r, 0, sizeof(r));
+  n = cfs_read(fd, &r, sizeof(r));
+  cfs_close(fd);
+  *limit = r.limit;
+  return n == sizeof(r) && r.check == ~r.limit ? 1 : -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Reserve the next COUNTER_STEP frame counters. The first time after
+   boot, continue after the counters that were reserved before. */
+static int
+reserve_counters(void)
+{
+  struct counter_record r;
+  uint32_t limit[2];
+  int8_t status[2];
+  uint8_t i;
+  int fd, n;
+
+  if(counter_limit == 0) {
+    for(i = 0; i < 2; i++) {
+      limit[i] = 0;
+      status[i] = read_counter_file(i, &limit[i]);
+    }
+    if(status[0] == 1 || status[1] == 1) {
+      /* Continue from the newest intact file, and overwrite the
+         other one next. */
+      i = status[1] == 1 && (status[0] != 1 || limit[1] > limit[0]);
+      frame_counter = limit[i];
+      counter_slot = !i;
+    } else if(status[0] < 0 || status[1] < 0) {
+      i = limit[1] > limit[0];
+      PRINTF("15.4: frame counter files damaged\n");
+      if(limit[i] > 0xffffffffUL - COUNTER_SKIP) {
+        return 0;
+      }
+      frame_counter = limit[i] + COUNTER_SKIP;
+    }
+  }
+
+  if(frame_counter > 0xffffffffUL - COUNTER_STEP) {
+    /* The counters are used up; a new key is needed. */
+    return 0;
+  }
+  r.limit = frame_counter + COUNTER_STEP;
+  r.check = ~r.limit;
+
+  fd = cfs_open(counter_files[counter_slot], CFS_WRITE);
+  if(fd < 0) {
+    return 0;
+  }
+  n = cfs_write(fd, &r, sizeof(r));
+  cfs_close(fd);
+  if(n != sizeof(r)) {
+    return 0;
+  }
+  counter_slot = !counter_slot;
+  counter_limit = r.limit;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static struct counter *
+find_counter(const rimeaddr_t *addr)
+{
+  uint8_t i;
+
+  for(i = 0; i < num_counters; i++) {
+    if(rimeaddr_cmp(&counters[i].addr, addr)) {
+      return &counters[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_counter(struct counter *c, const rimeaddr_t *addr, uint32_t counter)
+{
+  struct counter tmp;
+
+  if(c == NULL) {
+    if(num_counters < NEIGHBORS) {
+      num_counters++;
+    }
+    c = &counters[num_counters - 1];
+    rimeaddr_copy(&c->addr, addr);
+  }
+  c->frame_counter = counter;
+
+  /* Move the neighbor first. */
+  tmp = *c;
+  memmove(&counters[1], &counters[0], (c - counters) * sizeof(struct counter));
+  counters[0] = tmp;
+}
+/*---------------------------------------------------------------------------*/
+/* Add the MIC and encrypt the frame, whose header and payload are
+   next to each other in the packetbuf. The payload is everything
+   after the header, also the header of the RDC. */
+static void
+secure(uint32_t counter, uint8_t hdrlen)
+{
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t *hdr;
+  uint8_t datalen;
+
+  hdr = packetbuf_hdrptr();
+  datalen = packetbuf_totlen() - hdrlen;
+  set_nonce(nonce, rimeaddr_node_addr.u8, counter);
+#if ENCRYPT
+  ccm_star_encrypt(nonce, hdr, hdrlen, hdr + hdrlen, datalen,
+                   hdr + hdrlen + datalen, MIC_LEN);
+#else /* ENCRYPT */
+  ccm_star_encrypt(nonce, hdr, hdrlen + datalen, NULL, 0,
+                   hdr + hdrlen + datalen, MIC_LEN);
+#endif /* ENCRYPT */
+  packetbuf_set_datalen(packetbuf_datalen() + MIC_LEN);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, SECURITY_LEVEL);
+}
+#endif /* SECURITY_LEVEL */
+/*---------------------------------------------------------------------------*/
+/* Verify and decrypt an incoming frame of len bytes, and remove its
+   MIC from the end of the packetbuf. */
+static int
+unsecure(frame802154_t *frame, int len)
+{
+#if SECURITY_LEVEL
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t *hdr;
+  uint8_t hdrlen, datalen;
+  struct counter *c;
+  int ok;
+
+  if(!key_set || !frame->fcf.security_enabled ||
+     frame->aux_hdr.security_control.security_level != SECURITY_LEVEL ||
+     frame->payload_len < MIC_LEN) {
+    PRINTF("15.4: frame not secured\n");
+    return 0;
+  }
+
+  c = find_counter((rimeaddr_t *)&frame->src_addr);
+  if(c != NULL && frame->aux_hdr.frame_counter <= c->frame_counter) {
+    PRINTF("15.4: replayed frame %lu\n",
+           (unsigned long)frame->aux_hdr.frame_counter);
+    return 0;
+  }
+
+  hdr = packetbuf_dataptr();
+  hdrlen = len - frame->payload_len;
+  datalen = frame->payload_len - MIC_LEN;
+  set_nonce(nonce, frame->src_addr, frame->aux_hdr.frame_counter);
+#if ENCRYPT
+  ok = ccm_star_decrypt(nonce, hdr, hdrlen, frame->payload, datalen,
+                        frame->payload + datalen, MIC_LEN);
+#else /* ENCRYPT */
+  ok = ccm_star_decrypt(nonce, hdr, hdrlen + datalen, NULL, 0,
+                        frame->payload + datalen, MIC_LEN);
+#endif /* ENCRYPT */
+  if(!ok) {
+    PRINTF("15.4: bad MIC\n");
+    return 0;
+  }
+
+  update_counter(c, (rimeaddr_t *)&frame->src_addr,
+                 frame->aux_hdr.frame_counter);
+  packetbuf_set_datalen(len - MIC_LEN);
+#endif /* SECURITY_LEVEL */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static int
 create(void)
 {
@@ -100,6 +398,26 @@ create(void)
   /* Insert IEEE 802.15.4 (2003) version bit. */
   params.fcf.frame_version = FRAME802154_IEEE802154_2003;
 
+#if SECURITY_LEVEL
+  /* The payload is secured in place, so it must be in the packetbuf
+     right after the header. */
+  packetbuf_compact();
+
+  /* Secured frames need the 2006 version. */
+  if(!key_set) {
+    PRINTF("15.4-OUT: cannot secure frame\n");
+    return 0;
+  }
+  if(frame_counter == counter_limit && !reserve_counters()) {
+    PRINTF("15.4-OUT: cannot reserve frame counters\n");
+    return 0;
+  }
+  params.fcf.security_enabled = 1;
+  params.fcf.frame_version = FRAME802154_IEEE802154_2006;
+  params.aux_hdr.security_control.security_level = SECURITY_LEVEL;
+  params.aux_hdr.frame_counter = ++frame_counter;
+#endif /* SECURITY_LEVEL */
+
   /* Increment and set the data sequence number. */
   if(packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO)) {
     params.seq = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
@@ -155,8 +473,25 @@ create(void)
   params.payload = packetbuf_dataptr();
   params.payload_len = packetbuf_datalen();
   len = frame802154_hdrlen(&params);
+#if SECURITY_LEVEL
+  /* The MIC must fit, and short frames are padded before it. */
+  if(len + packetbuf_totlen() + MIC_LEN > PACKETBUF_SIZE) {
+    PRINTF("15.4-OUT: no room for MIC\n");
+    return 0;
+  }
+  if(len + packetbuf_totlen() + MIC_LEN < SHORTEST_FRAME) {
+    memset(params.payload + params.payload_len, 0,
+           SHORTEST_FRAME - len - MIC_LEN - packetbuf_totlen());
+    params.payload_len += SHORTEST_FRAME - len - MIC_LEN - packetbuf_totlen();
+    packetbuf_set_datalen(params.payload_len);
+  }
+#endif /* SECURITY_LEVEL */
   if(packetbuf_hdralloc(len)) {
     frame802154_create(&params, packetbuf_hdrptr(), len);
+#if SECURITY_LEVEL
+    secure(params.aux_hdr.frame_counter, len);
+#endif /* SECURITY_LEVEL */
+    NETCAPTURE_FRAME(NETCAPTURE_OUT, packetbuf_hdrptr(), packetbuf_totlen());
 
     PRINTF("15.4-OUT: %2X", params.fcf.frame_type);
     PRINTADDR(params.dest_addr.u8);
@@ -175,7 +510,9 @@ parse(void)
   frame802154_t frame;
   int len;
   len = packetbuf_datalen();
+  NETCAPTURE_FRAME(NETCAPTURE_IN, packetbuf_dataptr(), len);
   if(frame802154_parse(packetbuf_dataptr(), len, &frame) &&
+     unsecure(&frame, len) &&
      packetbuf_hdrreduce(len - frame.payload_len)) {
     if(frame.fcf.dest_addr_mode) {
       if(frame.dest_pid != mac_src_pan_id &&
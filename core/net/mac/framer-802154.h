@@ -40,8 +40,31 @@
 #ifndef __FRAMER_802154_H__
 #define __FRAMER_802154_H__
 
+#include "contiki-conf.h"
 #include "net/mac/framer.h"
 
 extern const struct framer framer_802154;
 
+/**
+ * \brief      Set the key for link-layer security
+ * \param key  A 16-byte AES key
+ *
+ *             If FRAMER_802154_CONF_SECURITY_LEVEL is non-zero, all
+ *             frames are authenticated and/or encrypted with CCM*
+ *             using this key, and no frames are sent or received
+ *             before it has been set. The block cipher is selected
+ *             with AES_128_CONF, e.g. cc2420_aes_128_driver.
+ *
+ *             Short frames are padded to
+ *             FRAMER_802154_CONF_SHORTEST_FRAME before the MIC is
+ *             added. It defaults to the shortest ContikiMAC frame
+ *             when ContikiMAC is the RDC.
+ *
+ *             The frame counter is kept in the files "frame-counter0"
+ *             and "frame-counter1", so a CFS with named files, such as
+ *             Coffee, is needed. Frames are not sent while the files
+ *             cannot be written.
+ */
+void framer_802154_set_key(const uint8_t *key);
+
 #endif /* __FRAMER_802154_H__ */
@@ -0,0 +1,639 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A time-slotted, channel-hopping radio duty cycling driver
+ *
+ * Time is divided into slots of SLOT_LENGTH rtimer ticks that are
+ * grouped into slotframes of NUM_SLOTS slots. Slot boundaries follow
+ * the network-wide time of the timesynch module, so all synchronized
+ * nodes agree on the current absolute slot number.
+ *
+ * The schedule is receiver-based: every node has one receive cell,
+ * a slot and a channel offset, derived from a hash of its
+ * address. A node listens in its own receive cell and transmits a
+ * unicast packet in the receive cell of the packet's receiver. With
+ * RPL or collect, each node thus sends to its parent in the parent's
+ * cell and the cells of all parents in the network are known without
+ * any signaling. Parent-child links whose parents share a slot but not
+ * a channel offset transmit simultaneously on different channels.
+ *
+ * The channel of a cell hops with the absolute slot number over the
+ * channels in MCTDMA_CONF_CHANNELS, which spreads the traffic of a
+ * link over all channels. Slot 0 of each slotframe is a shared
+ * broadcast slot on the first channel of the list, in which all nodes
+ * listen. Nodes that are not yet synchronized listen on that channel
+ * continuously, so that they can receive the timesynch messages.
+ *
+ * A node that listens in a cell turns off its radio early if no
+ * transmission has started shortly after the start of the slot, so
+ * the radio duty cycle is low when there is little traffic.
+ */
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "lib/random.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/rime/rimeaddr.h"
+#include "net/rime/timesynch.h"
+#include "net/mac/mctdma.h"
+#include "sys/rtimer.h"
+
+#include <string.h>
+
+#if TIMESYNCH_CONF_ENABLED
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* The slot length, the number of slots in a slotframe and the number
+   of channels must be powers of two, so that the absolute slot
+   number stays consistent when the rtimer clock wraps. */
+#ifdef MCTDMA_CONF_SLOT_LENGTH
+#define SLOT_LENGTH MCTDMA_CONF_SLOT_LENGTH
+#else /* MCTDMA_CONF_SLOT_LENGTH */
+#define SLOT_LENGTH (RTIMER_ARCH_SECOND / 64)
+#endif /* MCTDMA_CONF_SLOT_LENGTH */
+
+#if SLOT_LENGTH & (SLOT_LENGTH - 1)
+#error MCTDMA_CONF_SLOT_LENGTH must be a power of two
+#endif
+
+#ifdef MCTDMA_CONF_SLOTFRAME_LENGTH
+#define NUM_SLOTS MCTDMA_CONF_SLOTFRAME_LENGTH
+#else /* MCTDMA_CONF_SLOTFRAME_LENGTH */
+#define NUM_SLOTS 16
+#endif /* MCTDMA_CONF_SLOTFRAME_LENGTH */
+
+#if NUM_SLOTS & (NUM_SLOTS - 1) || NUM_SLOTS < 2
+#error MCTDMA_CONF_SLOTFRAME_LENGTH must be a power of two, at least 2
+#endif
+
+/* The channel hopping sequence. The first channel is also used for
+   the broadcast slot. MCTDMA_CONF_NUM_CHANNELS must be set to the
+   number of channels in MCTDMA_CONF_CHANNELS. */
+#ifdef MCTDMA_CONF_CHANNELS
+#ifndef MCTDMA_CONF_NUM_CHANNELS
+#error MCTDMA_CONF_CHANNELS requires MCTDMA_CONF_NUM_CHANNELS
+#endif
+#define NUM_CHANNELS MCTDMA_CONF_NUM_CHANNELS
+static const uint8_t channels[NUM_CHANNELS] = MCTDMA_CONF_CHANNELS;
+#else /* MCTDMA_CONF_CHANNELS */
+#define NUM_CHANNELS 4
+static const uint8_t channels[NUM_CHANNELS] = { 26, 15, 20, 25 };
+#endif /* MCTDMA_CONF_CHANNELS */
+
+#if NUM_CHANNELS & (NUM_CHANNELS - 1)
+#error MCTDMA_CONF_NUM_CHANNELS must be a power of two
+#endif
+
+#ifdef MCTDMA_CONF_SET_CHANNEL
+#define SET_CHANNEL(c) MCTDMA_CONF_SET_CHANNEL(c)
+#else /* MCTDMA_CONF_SET_CHANNEL */
+#include "dev/cc2420.h"
+#define SET_CHANNEL(c) cc2420_set_channel(c)
+#endif /* MCTDMA_CONF_SET_CHANNEL */
+
+/* Transmissions start TX_OFFSET into the slot, after a random backoff
+   of up to MAX_BACKOFF ticks between senders that share a cell. A
+   transmission that cannot start before TX_DEADLINE is postponed to
+   the next slotframe. Listeners turn off their radio at RX_WAIT if
+   the channel is still idle. */
+#define TX_OFFSET   (SLOT_LENGTH / 8)
+#define MAX_BACKOFF (SLOT_LENGTH / 16)
+#define TX_DEADLINE (SLOT_LENGTH / 2)
+#define RX_WAIT     (TX_OFFSET + MAX_BACKOFF + SLOT_LENGTH / 16)
+
+#define BROADCAST_SLOT 0
+
+#define ACK_WAIT_TIME                      RTIMER_SECOND / 2500
+#define AFTER_ACK_DETECTED_WAIT_TIME       RTIMER_SECOND / 1500
+#define ACK_LEN 3
+
+#ifdef QUEUEBUF_CONF_NUM
+#define MAX_QUEUED_PACKETS QUEUEBUF_CONF_NUM / 2
+#else /* QUEUEBUF_CONF_NUM */
+#define MAX_QUEUED_PACKETS 4
+#endif /* QUEUEBUF_CONF_NUM */
+
+struct cell {
+  uint8_t slot;
+  uint8_t channel_offset;
+};
+
+struct queued_packet {
+  struct queued_packet *next;
+  struct queuebuf *buf;
+  mac_callback_t sent;
+  void *ptr;
+  struct cell cell;
+};
+
+LIST(queued_packets_list);
+MEMB(queued_packets_memb, struct queued_packet, MAX_QUEUED_PACKETS);
+
+/* The number of queued packets for each slot. This is the only packet
+   state read from the rtimer interrupt. */
+static volatile uint8_t tx_pending[NUM_SLOTS];
+static volatile uint8_t we_are_sending;
+static volatile uint8_t radio_is_on;
+
+/* The radio driver does not lock out interrupts while it talks to the
+   radio, so the rtimer interrupt never touches the radio. It leaves a
+   request for mctdma_process instead, for the slot req_asn that
+   starts at req_slot_start. A request that has not been carried out
+   when the next one is made is dropped. */
+enum {
+  REQUEST_NONE,
+  REQUEST_TRANSMIT,    /* Send the first packet queued for the slot. */
+  REQUEST_LISTEN,      /* Listen on req_channel. */
+  REQUEST_OFF,         /* Turn off the radio. */
+  REQUEST_IDLE_CHECK   /* Turn off the radio unless someone sends. */
+};
+static volatile uint8_t request;
+static volatile uint8_t req_channel;
+static volatile rtimer_clock_t req_asn, req_slot_start;
+
+static struct rtimer rt;
+static rtimer_clock_t slot_start;
+static uint8_t mctdma_is_on;
+
+struct seqno {
+  rimeaddr_t sender;
+  uint8_t seqno;
+};
+
+#ifdef NETSTACK_CONF_MAC_SEQNO_HISTORY
+#define MAX_SEQNOS NETSTACK_CONF_MAC_SEQNO_HISTORY
+#else /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
+#define MAX_SEQNOS 8
+#endif /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
+static struct seqno received_seqnos[MAX_SEQNOS];
+
+PROCESS(mctdma_process, "Slotted MAC");
+
+static void slot_operation(struct rtimer *t, void *ptr);
+/*---------------------------------------------------------------------------*/
+/**
+ * Compute the receive cell of the node with address addr.
+ */
+static void
+receive_cell(const rimeaddr_t *addr, struct cell *c)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(rimeaddr_t); ++i) {
+    h = h * 31 + addr->u8[i];
+  }
+  c->slot = 1 + h % (NUM_SLOTS - 1);
+  c->channel_offset = (h / (NUM_SLOTS - 1)) % NUM_CHANNELS;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+cell_channel(const struct cell *c, rtimer_clock_t asn)
+{
+  if(c->slot == BROADCAST_SLOT) {
+    return channels[0];
+  }
+  return channels[(asn + c->channel_offset) % NUM_CHANNELS];
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule(rtimer_clock_t time, rtimer_callback_t f)
+{
+  if(RTIMER_CLOCK_LT(time, RTIMER_NOW() + 2)) {
+    time = RTIMER_NOW() + 2;
+  }
+  if(rtimer_set(&rt, time, 1, f, NULL) != RTIMER_OK) {
+    PRINTF("mctdma: could not set rtimer\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_is_busy(void)
+{
+  return NETSTACK_RADIO.receiving_packet() ||
+    NETSTACK_RADIO.pending_packet();
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_on(void)
+{
+  radio_is_on = 1;
+  NETSTACK_RADIO.on();
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_off(void)
+{
+  radio_is_on = 0;
+  NETSTACK_RADIO.off();
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_request(uint8_t r, rtimer_clock_t asn, uint8_t channel)
+{
+  req_asn = asn;
+  req_slot_start = slot_start;
+  req_channel = channel;
+  request = r;
+  process_poll(&mctdma_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+idle_check(struct rtimer *t, void *ptr)
+{
+  /* Ask mctdma_process to stop listening if nobody has started to
+     transmit in the cell. */
+  if(mctdma_is_on && !we_are_sending && timesynch_is_synchronized()) {
+    make_request(REQUEST_IDLE_CHECK, req_asn, 0);
+  }
+  schedule(slot_start + SLOT_LENGTH, slot_operation);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Called by the rtimer at the start of every slot. Asks
+ * mctdma_process to turn on the radio on the right channel for cells
+ * we listen in, to turn it off in other slots, and hands
+ * transmissions over to it. Runs in interrupt context and must not
+ * access the radio.
+ */
+static void
+slot_operation(struct rtimer *t, void *ptr)
+{
+  rtimer_clock_t asn;
+  struct cell my_cell;
+  uint8_t slot;
+
+  /* Round to the nearest slot in case the rtimer fired slightly
+     early. */
+  asn = (rtimer_clock_t)(timesynch_time() + SLOT_LENGTH / 8) / SLOT_LENGTH;
+  slot = asn % NUM_SLOTS;
+  slot_start = timesynch_time_to_rtimer(asn * SLOT_LENGTH);
+
+  if(!mctdma_is_on || we_are_sending) {
+    schedule(slot_start + SLOT_LENGTH, slot_operation);
+    return;
+  }
+
+  if(tx_pending[slot] > 0) {
+    make_request(REQUEST_TRANSMIT, asn, 0);
+    schedule(slot_start + SLOT_LENGTH, slot_operation);
+    return;
+  }
+
+  receive_cell(&rimeaddr_node_addr, &my_cell);
+  if(slot == BROADCAST_SLOT || !timesynch_is_synchronized()) {
+    make_request(REQUEST_LISTEN, asn, channels[0]);
+  } else if(slot == my_cell.slot) {
+    make_request(REQUEST_LISTEN, asn, cell_channel(&my_cell, asn));
+  } else {
+    if(radio_is_on) {
+      make_request(REQUEST_OFF, asn, 0);
+    }
+    schedule(slot_start + SLOT_LENGTH, slot_operation);
+    return;
+  }
+  schedule(slot_start + RX_WAIT, idle_check);
+}
+/*---------------------------------------------------------------------------*/
+static void
+listen(uint8_t channel, rtimer_clock_t start)
+{
+  /* If we were polled too late, idle_check() has already decided
+     that nobody sends in this slot. */
+  if(!RTIMER_CLOCK_LT(RTIMER_NOW(), start + RX_WAIT)) {
+    return;
+  }
+  SET_CHANNEL(channel);
+  radio_on();
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_packet(struct queued_packet *p, int status)
+{
+  mac_callback_t sent;
+  void *ptr;
+
+  tx_pending[p->cell.slot]--;
+  list_remove(queued_packets_list, p);
+  queuebuf_to_packetbuf(p->buf);
+  queuebuf_free(p->buf);
+  sent = p->sent;
+  ptr = p->ptr;
+  memb_free(&queued_packets_memb, p);
+  mac_call_sent_callback(sent, ptr, status, 1);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Transmit the first queued packet for the cell in slot asn, which
+ * starts at start. The radio hardware acknowledges unicast packets.
+ */
+static void
+transmit(rtimer_clock_t asn, rtimer_clock_t start)
+{
+  struct queued_packet *p;
+  rtimer_clock_t wt;
+  uint8_t slot;
+  uint8_t *frame;
+  int len, status;
+
+  slot = asn % NUM_SLOTS;
+
+  for(p = list_head(queued_packets_list); p != NULL; p = list_item_next(p)) {
+    if(p->cell.slot == slot) {
+      break;
+    }
+  }
+  if(p == NULL ||
+     !RTIMER_CLOCK_LT(RTIMER_NOW(), start + TX_DEADLINE)) {
+    /* We were scheduled too late and will try in the next
+       slotframe. */
+    return;
+  }
+
+  we_are_sending = 1;
+  SET_CHANNEL(cell_channel(&p->cell, asn));
+  radio_on();
+
+  frame = queuebuf_dataptr(p->buf);
+  len = queuebuf_datalen(p->buf);
+  NETSTACK_RADIO.prepare(frame, len);
+
+  wt = start + TX_OFFSET + random_rand() % (MAX_BACKOFF + 1);
+  while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt));
+
+  if(radio_is_busy() || NETSTACK_RADIO.channel_clear() == 0) {
+    /* Another node that shares the cell is already sending. */
+    status = MAC_TX_COLLISION;
+  } else {
+    switch(NETSTACK_RADIO.transmit(len)) {
+    case RADIO_TX_OK:
+      if(slot == BROADCAST_SLOT) {
+        status = MAC_TX_OK;
+      } else {
+        /* Check for ack */
+        wt = RTIMER_NOW();
+        while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + ACK_WAIT_TIME));
+
+        status = MAC_TX_NOACK;
+        if(radio_is_busy() || NETSTACK_RADIO.channel_clear() == 0) {
+          uint8_t ackbuf[ACK_LEN];
+
+          wt = RTIMER_NOW();
+          while(RTIMER_CLOCK_LT(RTIMER_NOW(),
+                                wt + AFTER_ACK_DETECTED_WAIT_TIME));
+
+          if(NETSTACK_RADIO.pending_packet()) {
+            if(NETSTACK_RADIO.read(ackbuf, ACK_LEN) == ACK_LEN &&
+               ackbuf[2] == frame[2]) {
+              status = MAC_TX_OK;
+            } else {
+              status = MAC_TX_COLLISION;
+            }
+          }
+        }
+      }
+      break;
+    case RADIO_TX_COLLISION:
+      status = MAC_TX_COLLISION;
+      break;
+    default:
+      status = MAC_TX_ERR;
+      break;
+    }
+  }
+
+  we_are_sending = 0;
+  if(slot != BROADCAST_SLOT && timesynch_is_synchronized()) {
+    radio_off();
+  }
+
+  PRINTF("mctdma: sent in slot %u channel %u, status %d\n",
+         slot, cell_channel(&p->cell, asn), status);
+  remove_packet(p, status);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Carry out the latest request of the rtimer interrupt.
+ */
+static void
+handle_request(void)
+{
+  uint8_t r, channel;
+  rtimer_clock_t asn, start;
+
+  r = request;
+  request = REQUEST_NONE;
+  asn = req_asn;
+  start = req_slot_start;
+  channel = req_channel;
+
+  /* Do not switch channels under an ongoing transmission or
+     reception. */
+  if(r == REQUEST_NONE || !mctdma_is_on || radio_is_busy()) {
+    return;
+  }
+
+  switch(r) {
+  case REQUEST_TRANSMIT:
+    transmit(asn, start);
+    break;
+  case REQUEST_LISTEN:
+    listen(channel, start);
+    break;
+  case REQUEST_OFF:
+    radio_off();
+    break;
+  case REQUEST_IDLE_CHECK:
+    if(NETSTACK_RADIO.channel_clear()) {
+      radio_off();
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mctdma_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    handle_request();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_packet(mac_callback_t sent, void *ptr)
+{
+  struct queued_packet *p;
+  const rimeaddr_t *receiver;
+
+  receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &rimeaddr_node_addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
+  if(NETSTACK_FRAMER.create() == 0) {
+    /* Failed to allocate space for headers */
+    PRINTF("mctdma: send failed, too large header\n");
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 0);
+    return;
+  }
+
+  p = memb_alloc(&queued_packets_memb);
+  if(p == NULL) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 0);
+    return;
+  }
+  p->buf = queuebuf_new_from_packetbuf();
+  if(p->buf == NULL) {
+    memb_free(&queued_packets_memb, p);
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 0);
+    return;
+  }
+  p->sent = sent;
+  p->ptr = ptr;
+  if(rimeaddr_cmp(receiver, &rimeaddr_null)) {
+    p->cell.slot = BROADCAST_SLOT;
+    p->cell.channel_offset = 0;
+  } else {
+    receive_cell(receiver, &p->cell);
+  }
+  list_add(queued_packets_list, p);
+  tx_pending[p->cell.slot]++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_packet(void)
+{
+  int i;
+
+  if(packetbuf_datalen() == ACK_LEN) {
+    /* Ignore ack packets */
+    return;
+  }
+  if(NETSTACK_FRAMER.parse() == 0) {
+    PRINTF("mctdma: failed to parse %u\n", packetbuf_datalen());
+    return;
+  }
+  if(!rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                   &rimeaddr_node_addr) &&
+     !rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                   &rimeaddr_null)) {
+    return;
+  }
+
+  /* Check for duplicate packet by comparing the sequence number of
+     the incoming packet with the last few ones we saw. */
+  for(i = 0; i < MAX_SEQNOS; ++i) {
+    if(packetbuf_attr(PACKETBUF_ATTR_PACKET_ID) == received_seqnos[i].seqno &&
+       rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                    &received_seqnos[i].sender)) {
+      /* Drop the packet. */
+      return;
+    }
+  }
+  for(i = MAX_SEQNOS - 1; i > 0; --i) {
+    memcpy(&received_seqnos[i], &received_seqnos[i - 1],
+           sizeof(struct seqno));
+  }
+  received_seqnos[0].seqno = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
+  rimeaddr_copy(&received_seqnos[0].sender,
+                packetbuf_addr(PACKETBUF_ADDR_SENDER));
+
+  NETSTACK_MAC.input();
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  mctdma_is_on = 1;
+  radio_is_on = 1;
+  return NETSTACK_RADIO.on();
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(int keep_radio_on)
+{
+  mctdma_is_on = 0;
+  radio_is_on = keep_radio_on;
+  if(keep_radio_on) {
+    return NETSTACK_RADIO.on();
+  } else {
+    return NETSTACK_RADIO.off();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+channel_check_interval(void)
+{
+  return (1ul * CLOCK_SECOND * SLOT_LENGTH * NUM_SLOTS) / RTIMER_ARCH_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  memb_init(&queued_packets_memb);
+  list_init(queued_packets_list);
+  memset((void *)tx_pending, 0, sizeof(tx_pending));
+
+  process_start(&mctdma_process, NULL);
+
+  mctdma_is_on = 1;
+  radio_on();
+  schedule(RTIMER_NOW() + SLOT_LENGTH, slot_operation);
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver mctdma_driver = {
+  "MCTDMA",
+  init,
+  send_packet,
+  input_packet,
+  on,
+  off,
+  channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+#endif /* TIMESYNCH_CONF_ENABLED */
@@ -47,6 +47,8 @@
 #include "dev/watchdog.h"
 #include "dev/leds.h"
 
+#include <string.h>
+
 struct phase_queueitem {
   struct ctimer timer;
   mac_callback_t mac_callback;
@@ -61,6 +63,22 @@ struct phase_queueitem {
 
 #define MAX_NOACKS_TIME       CLOCK_SECOND * 30
 
+#if PHASE_DRIFT_COMPENSATION
+/* The drift is expressed in rtimer ticks per PHASE_DRIFT_SCALE clock
+   ticks. */
+#define PHASE_DRIFT_SHIFT     12
+#define PHASE_DRIFT_SCALE     (1L << PHASE_DRIFT_SHIFT)
+
+/* Two observations must be at least this far apart for the drift to
+   be estimated from them, so that the jitter of a single observation
+   does not dominate the estimate. */
+#define MIN_DRIFT_INTERVAL    CLOCK_SECOND * 60
+
+/* Larger estimates are caused by missed or misattributed wake-ups
+   rather than by clock drift, and are ignored. */
+#define MAX_DRIFT             (PHASE_DRIFT_SCALE / 16)
+#endif /* PHASE_DRIFT_COMPENSATION */
+
 MEMB(queued_packets_memb, struct phase_queueitem, PHASE_QUEUESIZE);
 
 #define DEBUG 0
@@ -73,11 +91,37 @@ MEMB(queued_packets_memb, struct phase_queueitem, PHASE_QUEUESIZE);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+static struct phase **
+hash_bucket(const struct phase_list *list, const rimeaddr_t *addr)
+{
+  uint8_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h ^= addr->u8[i];
+  }
+  return &list->hash[h & (PHASE_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(const struct phase_list *list, struct phase *e)
+{
+  struct phase **p;
+
+  for(p = hash_bucket(list, &e->neighbor); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == e) {
+      *p = e->hash_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 struct phase *
 find_neighbor(const struct phase_list *list, const rimeaddr_t *addr)
 {
   struct phase *e;
-  for(e = list_head(*list->list); e != NULL; e = list_item_next(e)) {
+  for(e = *hash_bucket(list, addr); e != NULL; e = e->hash_next) {
     if(rimeaddr_cmp(addr, &e->neighbor)) {
       return e;
     }
@@ -85,17 +129,65 @@ find_neighbor(const struct phase_list *list, const rimeaddr_t *addr)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static void
+drop(const struct phase_list *list, struct phase *e)
+{
+  hash_remove(list, e);
+  list_remove(*list->list, e);
+  memb_free(list->memb, e);
+}
+/*---------------------------------------------------------------------------*/
 void
 phase_remove(const struct phase_list *list, const rimeaddr_t *neighbor)
 {
   struct phase *e;
   e = find_neighbor(list, neighbor);
   if(e != NULL) {
-    list_remove(*list->list, e);
-    memb_free(list->memb, e);
+    drop(list, e);
   }
 }
 /*---------------------------------------------------------------------------*/
+#if PHASE_DRIFT_COMPENSATION
+static void
+update_drift(struct phase *e, rtimer_clock_t time)
+{
+  clock_time_t now, elapsed;
+  rtimer_clock_t half;
+  long diff, drift;
+
+  now = clock_time();
+  e->updated = now;
+  elapsed = now - e->anchor;
+  if(e->cycle_time == 0) {
+    /* We have not yet sent a phase-locked packet to the neighbor. */
+    e->anchor = now;
+    e->anchor_time = time;
+    return;
+  }
+  if(elapsed < MIN_DRIFT_INTERVAL) {
+    return;
+  }
+
+  /* The phase difference between the two observations, modulo the
+     cycle time, is the drift over the elapsed time. */
+  half = e->cycle_time / 2;
+  diff = (rtimer_clock_t)((time - e->anchor_time) & (e->cycle_time - 1));
+  if(diff >= half) {
+    diff -= e->cycle_time;
+  }
+  drift = (diff * PHASE_DRIFT_SCALE) / (long)elapsed;
+
+  if(drift > -MAX_DRIFT && drift < MAX_DRIFT) {
+    /* Average with the previous estimate to smooth the jitter. */
+    e->drift = (int16_t)((e->drift + drift) / 2);
+    PRINTF("phase drift %d to %d.%d\n", e->drift,
+           e->neighbor.u8[0], e->neighbor.u8[1]);
+  }
+  e->anchor = now;
+  e->anchor_time = time;
+}
+#endif /* PHASE_DRIFT_COMPENSATION */
+/*---------------------------------------------------------------------------*/
 void
 phase_update(const struct phase_list *list,
              const rimeaddr_t *neighbor, rtimer_clock_t time,
@@ -107,6 +199,9 @@ phase_update(const struct phase_list *list,
   e = find_neighbor(list, neighbor);
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
+#if PHASE_DRIFT_COMPENSATION
+      update_drift(e, time);
+#endif /* PHASE_DRIFT_COMPENSATION */
       e->time = time;
     }
     /* If the neighbor didn't reply to us, it may have switched
@@ -120,8 +215,7 @@ phase_update(const struct phase_list *list,
       }
       if(e->noacks >= MAX_NOACKS || timer_expired(&e->noacks_timer)) {
         PRINTF("drop %d\n", neighbor->u8[0]);
-        list_remove(*list->list, e);
-        memb_free(list->memb, e);
+        drop(list, e);
         return;
       }
     } else if(mac_status == MAC_TX_OK) {
@@ -136,11 +230,40 @@ phase_update(const struct phase_list *list,
         /* We could not allocate memory for this phase, so we drop
            the last item on the list and reuse it for our phase. */
         e = list_chop(*list->list);
+        hash_remove(list, e);
       }
       rimeaddr_copy(&e->neighbor, neighbor);
       e->time = time;
       e->noacks = 0;
+      e->rate = 0;
+#if PHASE_DRIFT_COMPENSATION
+      e->cycle_time = 0;
+      e->drift = 0;
+      update_drift(e, time);
+#endif /* PHASE_DRIFT_COMPENSATION */
       list_push(*list->list, e);
+      e->hash_next = *hash_bucket(list, neighbor);
+      *hash_bucket(list, neighbor) = e;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+phase_set_rate(const struct phase_list *list, const rimeaddr_t *neighbor,
+               uint8_t rate)
+{
+  struct phase *e;
+
+  /* The neighbor checks the channel 2^rate times per cycle. If it
+     has lowered its rate, the wake-up that we have recorded may no
+     longer happen, so we forget the phase. */
+  e = find_neighbor(list, neighbor);
+  if(e != NULL) {
+    if(rate < e->rate) {
+      PRINTF("phase rate %d -> %d, drop %d\n", e->rate, rate, neighbor->u8[0]);
+      drop(list, e);
+    } else {
+      e->rate = rate;
     }
   }
 }
@@ -170,7 +293,7 @@ phase_wait(struct phase_list *list,
      the radio just before the phase. */
   e = find_neighbor(list, neighbor);
   if(e != NULL) {
-    rtimer_clock_t wait, now, expected;
+    rtimer_clock_t wait, now, expected, phase;
     clock_time_t ctimewait;
     
     /* We expect phases to happen every CYCLE_TIME time
@@ -187,8 +310,22 @@ phase_wait(struct phase_list *list,
             printf("additional wait %d\n", additional_wait);
             }*/
     
+    /* A neighbor that has advertised a higher channel check rate
+       wakes up more often. */
+    cycle_time >>= e->rate;
+
+    phase = e->time;
+#if PHASE_DRIFT_COMPENSATION
+    /* Move the observed phase by the drift accumulated since it was
+       observed. */
+    e->cycle_time = cycle_time;
+    phase += (rtimer_clock_t)(((long)e->drift *
+                               (clock_time_t)(clock_time() - e->updated)) >>
+                              PHASE_DRIFT_SHIFT);
+#endif /* PHASE_DRIFT_COMPENSATION */
+
     now = RTIMER_NOW();
-    wait = (rtimer_clock_t)((e->time - now) &
+    wait = (rtimer_clock_t)((phase - now) &
                             (cycle_time - 1));
     if(wait < guard_time) {
       wait += cycle_time;
@@ -228,6 +365,7 @@ phase_init(struct phase_list *list)
 {
   list_init(*list->list);
   memb_init(list->memb);
+  memset(list->hash, 0, PHASE_HASH_SIZE * sizeof(struct phase *));
   memb_init(&queued_packets_memb);
 }
 /*---------------------------------------------------------------------------*/
@@ -48,17 +48,48 @@
 #include "lib/memb.h"
 #include "net/netstack.h"
 
+/* The number of hash buckets used to look up neighbors. Must be a
+   power of two. */
+#ifdef PHASE_CONF_HASH_SIZE
+#define PHASE_HASH_SIZE PHASE_CONF_HASH_SIZE
+#else
+#define PHASE_HASH_SIZE 8
+#endif
+
+/* Estimate the clock drift between us and each neighbor from
+   successive phase observations, and compensate for it when
+   predicting the next wake-up of the neighbor. */
+#ifdef PHASE_CONF_DRIFT_COMPENSATION
+#define PHASE_DRIFT_COMPENSATION PHASE_CONF_DRIFT_COMPENSATION
+#else
+#define PHASE_DRIFT_COMPENSATION 0
+#endif
+
 struct phase {
   struct phase *next;
+  struct phase *hash_next;
   rimeaddr_t neighbor;
   rtimer_clock_t time;
   uint8_t noacks;
+  uint8_t rate;
   struct timer noacks_timer;
+#if PHASE_DRIFT_COMPENSATION
+  /* The clock time at which the phase was observed. */
+  clock_time_t updated;
+  /* The earlier observation that the drift is estimated from. */
+  rtimer_clock_t anchor_time;
+  clock_time_t anchor;
+  /* The cycle time used for the neighbor, needed to compare phases. */
+  rtimer_clock_t cycle_time;
+  /* The phase drift in rtimer ticks per PHASE_DRIFT_SCALE clock ticks. */
+  int16_t drift;
+#endif /* PHASE_DRIFT_COMPENSATION */
 };
 
 struct phase_list {
   list_t *list;
   struct memb *memb;
+  struct phase **hash;
 };
 
 typedef enum {
@@ -70,7 +101,9 @@ typedef enum {
 
 #define PHASE_LIST(name, num) LIST(phase_list_list);                              \
                               MEMB(phase_list_memb, struct phase, num);           \
-                              struct phase_list name = { &phase_list_list, &phase_list_memb }
+                              static struct phase *phase_list_hash[PHASE_HASH_SIZE]; \
+                              struct phase_list name = { &phase_list_list, &phase_list_memb, \
+                                                         phase_list_hash }
 
 void phase_init(struct phase_list *list);
 phase_status_t phase_wait(struct phase_list *list,  const rimeaddr_t *neighbor,
@@ -81,4 +114,7 @@ void phase_update(const struct phase_list *list, const rimeaddr_t *neighbor,
 
 void phase_remove(const struct phase_list *list, const rimeaddr_t *neighbor);
 
+void phase_set_rate(const struct phase_list *list, const rimeaddr_t *neighbor,
+                    uint8_t rate);
+
 #endif /* PHASE_H */
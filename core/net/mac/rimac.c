@@ -0,0 +1,793 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Receiver-initiated radio duty cycling (Y. Sun, O. Gurewitz,
+ *         D. B. Johnson. RI-MAC: A Receiver-Initiated Asynchronous
+ *         Duty Cycle MAC Protocol for Dynamic Traffic Loads in
+ *         Wireless Sensor Networks, SenSys 2008)
+ *
+ * In RI-MAC, the receiver rather than the sender initiates every
+ * transmission. Each node wakes up once per cycle, broadcasts a short
+ * beacon and listens for a brief dwell time. A node that wants to
+ * send a packet turns on its radio and waits silently until it hears
+ * a beacon from the receiver, and then transmits its packet
+ * immediately. The receiver acknowledges the packet with another
+ * beacon, which also invites the next packet from the same or any
+ * other sender. Because senders never occupy the channel with
+ * strobes or long preambles, the channel stays free for the
+ * receiver's neighbors, which is particularly useful for
+ * convergecast traffic towards a single sink.
+ *
+ * Each beacon carries a backoff window. Senders that hear the beacon
+ * wait a random time within the window before transmitting. If the
+ * receiver detects activity on the channel but no packet was
+ * received, it assumes that two senders collided and sends a new
+ * beacon with a larger window.
+ *
+ * Broadcast packets are transmitted after every beacon heard during
+ * one full cycle, which reaches all neighbors.
+ */
+
+#include "dev/leds.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "lib/random.h"
+#include "net/rime.h"
+#include "net/netstack.h"
+#include "net/mac/mac.h"
+#include "net/mac/phase.h"
+#include "net/mac/rimac.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "sys/compower.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Use the phase of the receiver's beacons to wake up just before the
+   receiver is expected to send its next beacon. */
+#ifdef RIMAC_CONF_WITH_PHASE_OPTIMIZATION
+#define WITH_PHASE_OPTIMIZATION RIMAC_CONF_WITH_PHASE_OPTIMIZATION
+#else /* RIMAC_CONF_WITH_PHASE_OPTIMIZATION */
+#define WITH_PHASE_OPTIMIZATION 1
+#endif /* RIMAC_CONF_WITH_PHASE_OPTIMIZATION */
+
+/* The time the receiver listens for a packet after sending a beacon. */
+#ifdef RIMAC_CONF_DWELL_TIME
+#define DWELL_TIME RIMAC_CONF_DWELL_TIME
+#else /* RIMAC_CONF_DWELL_TIME */
+#define DWELL_TIME (CLOCK_SECOND / 64)
+#endif /* RIMAC_CONF_DWELL_TIME */
+
+#define CYCLE_TIME (CLOCK_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+#define CYCLE_TIME_RTIMER (RTIMER_ARCH_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+
+/* If CLOCK_SECOND is small, the dwell time may round down to zero
+   ticks. */
+#if DWELL_TIME < 1
+#undef DWELL_TIME
+#define DWELL_TIME 1
+#endif
+
+/* How long before the expected beacon of a known receiver we turn on
+   the radio. The beacons are scheduled with a ctimer, so this must
+   cover a clock tick of jitter. */
+#define GUARD_TIME (2 * RTIMER_ARCH_SECOND / CLOCK_SECOND)
+
+#define UNICAST_TIMEOUT   (2 * CYCLE_TIME + CYCLE_TIME / 2)
+#define BROADCAST_TIMEOUT (CYCLE_TIME + DWELL_TIME)
+
+/* The backoff window is expressed in units of BACKOFF_UNIT, roughly
+   one millisecond or the air time of a short packet. */
+#define BACKOFF_UNIT       (RTIMER_ARCH_SECOND >= 1024 ? \
+                            RTIMER_ARCH_SECOND / 1024 : 1)
+#define MIN_BACKOFF_WINDOW 1
+#define MAX_BACKOFF_WINDOW 16
+
+/* A sender must start its transmission while the receiver still
+   listens, so the backoff never exceeds half the dwell time. */
+#define MAX_BACKOFF_TIME   ((rtimer_clock_t)((unsigned long)DWELL_TIME * \
+                                             RTIMER_ARCH_SECOND / \
+                                             CLOCK_SECOND / 2))
+
+/* The number of extra beacons a receiver sends after suspected
+   collisions during one wake-up. */
+#define MAX_BEACON_RETRIES 2
+
+#ifdef QUEUEBUF_CONF_NUM
+#define MAX_QUEUED_PACKETS QUEUEBUF_CONF_NUM / 2
+#else /* QUEUEBUF_CONF_NUM */
+#define MAX_QUEUED_PACKETS 4
+#endif /* QUEUEBUF_CONF_NUM */
+
+#ifdef RIMAC_CONF_MAX_PHASE_NEIGHBORS
+#define MAX_PHASE_NEIGHBORS RIMAC_CONF_MAX_PHASE_NEIGHBORS
+#else /* RIMAC_CONF_MAX_PHASE_NEIGHBORS */
+#define MAX_PHASE_NEIGHBORS 8
+#endif /* RIMAC_CONF_MAX_PHASE_NEIGHBORS */
+
+#define TYPE_BEACON 1
+#define TYPE_DATA   2
+
+struct rimac_hdr {
+  uint8_t type;
+};
+
+struct rimac_beacon {
+  struct rimac_hdr hdr;
+  /* The backoff window senders should use, in BACKOFF_UNITs. */
+  uint8_t backoff;
+  /* The sender and sequence number of the packet acknowledged by
+     this beacon, or the null address for a plain beacon. */
+  uint8_t seqno;
+  rimeaddr_t acked;
+};
+
+struct queue_list_item {
+  struct queue_list_item *next;
+  struct queuebuf *packet;
+  struct ctimer removal_timer;
+  struct compower_activity compower;
+  mac_callback_t sent_callback;
+  void *sent_callback_ptr;
+  rimeaddr_t receiver;
+  uint8_t seqno;
+  uint8_t num_transmissions;
+  /* Set when the packet is to be sent once the backoff has passed. */
+  uint8_t pending;
+};
+
+LIST(queued_packets_list);
+MEMB(queued_packets_memb, struct queue_list_item, MAX_QUEUED_PACKETS);
+
+#if WITH_PHASE_OPTIMIZATION
+PHASE_LIST(rimac_phase_list, MAX_PHASE_NEIGHBORS);
+#endif /* WITH_PHASE_OPTIMIZATION */
+
+/* A beacon is built with the framer only when our address changes and
+   is then patched and sent directly from this buffer, so that we can
+   acknowledge a packet without clobbering it in the packetbuf. */
+static uint8_t beacon_buf[PACKETBUF_HDR_SIZE + sizeof(struct rimac_beacon)];
+static uint8_t beacon_len;
+static rimeaddr_t beacon_addr;
+
+static uint8_t rimac_is_on;
+static uint8_t is_listening;
+static uint8_t received_data;
+static uint8_t backoff_window = MIN_BACKOFF_WINDOW;
+
+/* Senders back off with an rtimer, which polls rimac_process to send
+   the pending packets. */
+PROCESS(rimac_process, "RI-MAC");
+static struct rtimer backoff_timer;
+static uint8_t backoff_scheduled;
+
+static struct pt dutycycle_pt;
+static struct ctimer timer;
+static clock_time_t cycle_start;
+
+static struct compower_activity current_packet;
+
+struct seqno {
+  rimeaddr_t sender;
+  uint8_t seqno;
+};
+
+#ifdef NETSTACK_CONF_MAC_SEQNO_HISTORY
+#define MAX_SEQNOS NETSTACK_CONF_MAC_SEQNO_HISTORY
+#else /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
+#define MAX_SEQNOS 8
+#endif /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
+static struct seqno received_seqnos[MAX_SEQNOS];
+
+/*---------------------------------------------------------------------------*/
+static void
+turn_radio_on(void)
+{
+  NETSTACK_RADIO.on();
+}
+/*---------------------------------------------------------------------------*/
+static void
+turn_radio_off(void)
+{
+  /* The radio stays on while we listen after a beacon and while we
+     wait for beacons from the receivers of our queued packets. */
+  if(rimac_is_on && is_listening == 0 &&
+     list_length(queued_packets_list) == 0 &&
+     !NETSTACK_RADIO.receiving_packet()) {
+    NETSTACK_RADIO.off();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_beacon(void)
+{
+  struct rimac_beacon *b;
+  struct queuebuf *packet;
+
+  /* This is called from a ctimer, so the packet that the upper
+     layers may have in the packetbuf is saved and restored. */
+  packet = queuebuf_new_from_packetbuf();
+  if(packet == NULL) {
+    PRINTF("rimac: no queuebuf to build beacon\n");
+    beacon_len = 0;
+    return;
+  }
+
+  packetbuf_clear();
+  packetbuf_set_datalen(sizeof(struct rimac_beacon));
+  b = packetbuf_dataptr();
+  memset(b, 0, sizeof(struct rimac_beacon));
+  b->hdr.type = TYPE_BEACON;
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &rimeaddr_node_addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &rimeaddr_null);
+  if(NETSTACK_FRAMER.create() == 0 ||
+     packetbuf_totlen() > sizeof(beacon_buf)) {
+    PRINTF("rimac: failed to create beacon\n");
+    beacon_len = 0;
+  } else {
+    memcpy(beacon_buf, packetbuf_hdrptr(), packetbuf_totlen());
+    beacon_len = packetbuf_totlen();
+    rimeaddr_copy(&beacon_addr, &rimeaddr_node_addr);
+  }
+
+  queuebuf_to_packetbuf(packet);
+  queuebuf_free(packet);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Send a beacon that acknowledges the packet with sequence number
+ * seqno from the node acked. A plain beacon is sent with acked set to
+ * the null address.
+ */
+static void
+send_beacon(const rimeaddr_t *acked, uint8_t seqno)
+{
+  struct rimac_beacon *b;
+
+  if(beacon_len == 0) {
+    return;
+  }
+
+  b = (struct rimac_beacon *)&beacon_buf[beacon_len -
+                                         sizeof(struct rimac_beacon)];
+  b->backoff = backoff_window;
+  b->seqno = seqno;
+  rimeaddr_copy(&b->acked, acked);
+
+  NETSTACK_RADIO.send(beacon_buf, beacon_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_is_busy(void)
+{
+  return NETSTACK_RADIO.receiving_packet() ||
+    NETSTACK_RADIO.pending_packet() ||
+    NETSTACK_RADIO.channel_clear() == 0;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Duty cycle the radio and send beacons. This function is called
+ * repeatedly by a ctimer, once per cycle and once per dwell time
+ * while we listen after a beacon.
+ */
+static int
+dutycycle(void *ptr)
+{
+  struct ctimer *t = ptr;
+  static uint8_t beacons;
+  clock_time_t now;
+
+  PT_BEGIN(&dutycycle_pt);
+
+  cycle_start = clock_time();
+
+  while(1) {
+    if(rimac_is_on) {
+      if(!rimeaddr_cmp(&beacon_addr, &rimeaddr_node_addr) ||
+         beacon_len == 0) {
+        build_beacon();
+      }
+
+      is_listening = 1;
+      turn_radio_on();
+
+      /* Do not disturb an ongoing transmission with our beacon. We
+         still listen for the dwell time, as a sender that has been
+         waiting for us may send when it hears our next beacon. */
+      received_data = 0;
+      backoff_window = MIN_BACKOFF_WINDOW;
+      if(!channel_is_busy()) {
+        send_beacon(&rimeaddr_null, 0);
+      }
+      compower_accumulate(&compower_idle_activity);
+
+      beacons = 0;
+      while(1) {
+        ctimer_set(t, DWELL_TIME, (void (*)(void *))dutycycle, t);
+        PT_YIELD(&dutycycle_pt);
+
+        if(received_data) {
+          /* Our acknowledgement beacon invited another packet, so we
+             keep listening. */
+          received_data = 0;
+          continue;
+        }
+        if(NETSTACK_RADIO.receiving_packet() ||
+           NETSTACK_RADIO.pending_packet()) {
+          continue;
+        }
+        if(beacons < MAX_BEACON_RETRIES &&
+           NETSTACK_RADIO.channel_clear() == 0) {
+          /* There was activity on the channel but no packet: assume
+             that senders collided and give them a wider window. */
+          if(backoff_window < MAX_BACKOFF_WINDOW) {
+            backoff_window <<= 1;
+          }
+          ++beacons;
+          send_beacon(&rimeaddr_null, 0);
+          continue;
+        }
+        break;
+      }
+
+      is_listening = 0;
+      turn_radio_off();
+    }
+
+    /* Schedule the next beacon one cycle after the previous, so that
+       neighbors can predict our beacons. If we listened for longer
+       than a cycle, we restart the cycle from now. */
+    cycle_start += CYCLE_TIME;
+    now = clock_time();
+    if((clock_time_t)(cycle_start - now) > CYCLE_TIME) {
+      cycle_start = now;
+    }
+    ctimer_set(t, cycle_start - now, (void (*)(void *))dutycycle, t);
+    PT_YIELD(&dutycycle_pt);
+  }
+
+  PT_END(&dutycycle_pt);
+}
+/*---------------------------------------------------------------------------*/
+static void
+restart_dutycycle(clock_time_t initial_wait)
+{
+  PT_INIT(&dutycycle_pt);
+  ctimer_set(&timer, initial_wait, (void (*)(void *))dutycycle, &timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_queued_packet(struct queue_list_item *i, int status)
+{
+  mac_callback_t sent;
+  void *ptr;
+  int num_transmissions;
+
+  queuebuf_to_packetbuf(i->packet);
+
+  ctimer_stop(&i->removal_timer);
+  queuebuf_free(i->packet);
+  list_remove(queued_packets_list, i);
+
+  turn_radio_off();
+  compower_accumulate(&i->compower);
+
+  sent = i->sent_callback;
+  ptr = i->sent_callback_ptr;
+  num_transmissions = i->num_transmissions;
+  memb_free(&queued_packets_memb, i);
+  mac_call_sent_callback(sent, ptr, status, num_transmissions);
+}
+/*---------------------------------------------------------------------------*/
+static void
+unicast_timeout(void *item)
+{
+  struct queue_list_item *i = item;
+
+#if WITH_PHASE_OPTIMIZATION
+  phase_update(&rimac_phase_list, &i->receiver, 0, MAC_TX_NOACK);
+#endif /* WITH_PHASE_OPTIMIZATION */
+  remove_queued_packet(i, MAC_TX_NOACK);
+}
+/*---------------------------------------------------------------------------*/
+static void
+broadcast_timeout(void *item)
+{
+  struct queue_list_item *i = item;
+
+  remove_queued_packet(i, i->num_transmissions > 0 ? MAC_TX_OK :
+                       MAC_TX_NOACK);
+}
+/*---------------------------------------------------------------------------*/
+static void
+backoff_expired(struct rtimer *t, void *ptr)
+{
+  process_poll(&rimac_process);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Schedule a queued packet for transmission in response to a beacon,
+ * after a random backoff within the window announced by the
+ * receiver. A sender whose earlier transmissions were not
+ * acknowledged widens the window, so that senders that collided are
+ * unlikely to collide again. All packets invited by one beacon are
+ * sent after the same backoff.
+ */
+static void
+schedule_transmission(struct queue_list_item *i, uint8_t window)
+{
+  rtimer_clock_t backoff;
+
+  i->pending = 1;
+  if(backoff_scheduled) {
+    return;
+  }
+
+  if(window < MIN_BACKOFF_WINDOW) {
+    window = MIN_BACKOFF_WINDOW;
+  }
+  backoff = (rtimer_clock_t)((unsigned)window <<
+                             (i->num_transmissions < 3 ?
+                              i->num_transmissions : 3)) * BACKOFF_UNIT;
+  if(backoff > MAX_BACKOFF_TIME) {
+    backoff = MAX_BACKOFF_TIME;
+  }
+  if(backoff < 1) {
+    backoff = 1;
+  }
+
+  backoff_scheduled = 1;
+  rtimer_set(&backoff_timer, RTIMER_NOW() + 1 + random_rand() % backoff, 1,
+             backoff_expired, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+transmit_pending(void)
+{
+  struct queue_list_item *i;
+  uint8_t busy;
+
+  /* If another sender was faster, we wait for the receiver's next
+     beacon instead. */
+  busy = channel_is_busy();
+  if(busy) {
+    PRINTF("rimac: channel busy, not sending\n");
+  }
+
+  for(i = list_head(queued_packets_list); i != NULL; i = list_item_next(i)) {
+    if(!i->pending) {
+      continue;
+    }
+    i->pending = 0;
+    if(busy) {
+      continue;
+    }
+
+    NETSTACK_RADIO.send(queuebuf_dataptr(i->packet),
+                        queuebuf_datalen(i->packet));
+    i->num_transmissions++;
+
+    /* Attribute the energy spent waiting for the beacon to this
+       packet. */
+    compower_accumulate(&i->compower);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * A beacon from the node from was received. If it acknowledges our
+ * packet, the packet is done. Otherwise, we send the first queued
+ * packet for that node and any broadcast packets.
+ */
+static void
+beacon_received(const rimeaddr_t *from, const struct rimac_beacon *b,
+                rtimer_clock_t beacon_time)
+{
+  struct queue_list_item *i, *next, *acked;
+  uint8_t sent_unicast;
+
+  acked = NULL;
+  sent_unicast = 0;
+
+  for(i = list_head(queued_packets_list); i != NULL; i = next) {
+    next = list_item_next(i);
+
+    if(rimeaddr_cmp(&i->receiver, &rimeaddr_null)) {
+      schedule_transmission(i, b->backoff);
+      continue;
+    }
+
+    if(!rimeaddr_cmp(&i->receiver, from)) {
+      continue;
+    }
+
+    if(acked == NULL && i->num_transmissions > 0 &&
+       b->seqno == i->seqno &&
+       rimeaddr_cmp(&b->acked, &rimeaddr_node_addr)) {
+      list_remove(queued_packets_list, i);
+      acked = i;
+      continue;
+    }
+
+#if WITH_PHASE_OPTIMIZATION
+    /* Only plain beacons follow the receiver's cycle. */
+    if(rimeaddr_cmp(&b->acked, &rimeaddr_null)) {
+      phase_update(&rimac_phase_list, from, beacon_time, MAC_TX_OK);
+    }
+#endif /* WITH_PHASE_OPTIMIZATION */
+
+    /* The beacon also invites the next packet for the same
+       receiver, so that packet trains need only one wake-up. */
+    if(!sent_unicast) {
+      schedule_transmission(i, b->backoff);
+      sent_unicast = 1;
+    }
+  }
+
+  /* The sent callback may queue a new packet, so it is called after
+     we are done with the list. */
+  if(acked != NULL) {
+    list_add(queued_packets_list, acked);
+    remove_queued_packet(acked, MAC_TX_OK);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Queue a packet and wait for a beacon from its receiver. The packet
+ * is transmitted by beacon_received() when the beacon arrives.
+ */
+static void
+send_packet(mac_callback_t sent, void *ptr)
+{
+  struct rimac_hdr *hdr;
+  struct queue_list_item *i;
+  rimeaddr_t receiver;
+  uint8_t is_broadcast;
+
+  rimeaddr_copy(&receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  is_broadcast = rimeaddr_cmp(&receiver, &rimeaddr_null);
+
+#if WITH_PHASE_OPTIMIZATION
+  if(!is_broadcast) {
+    /* If we know when the receiver sends its beacons, we wait until
+       just before the next one before turning on the radio. */
+    if(phase_wait(&rimac_phase_list, &receiver, CYCLE_TIME_RTIMER,
+                  GUARD_TIME, sent, ptr) == PHASE_DEFERRED) {
+      return;
+    }
+  }
+#endif /* WITH_PHASE_OPTIMIZATION */
+
+  if(packetbuf_hdralloc(sizeof(struct rimac_hdr)) == 0) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 0);
+    return;
+  }
+  hdr = packetbuf_hdrptr();
+  hdr->type = TYPE_DATA;
+  packetbuf_compact();
+
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &rimeaddr_node_addr);
+  if(NETSTACK_FRAMER.create() == 0) {
+    /* Failed to send */
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 0);
+    return;
+  }
+
+  i = memb_alloc(&queued_packets_memb);
+  if(i == NULL) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 0);
+    return;
+  }
+  i->packet = queuebuf_new_from_packetbuf();
+  if(i->packet == NULL) {
+    memb_free(&queued_packets_memb, i);
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 0);
+    return;
+  }
+  i->sent_callback = sent;
+  i->sent_callback_ptr = ptr;
+  i->num_transmissions = 0;
+  i->pending = 0;
+  i->seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+  rimeaddr_copy(&i->receiver, &receiver);
+  compower_clear(&i->compower);
+
+  if(is_broadcast) {
+    ctimer_set(&i->removal_timer, BROADCAST_TIMEOUT, broadcast_timeout, i);
+  } else {
+    ctimer_set(&i->removal_timer, UNICAST_TIMEOUT, unicast_timeout, i);
+  }
+  list_add(queued_packets_list, i);
+
+  PRINTF("rimac: queued packet for %d.%d\n",
+         receiver.u8[0], receiver.u8[1]);
+
+  /* Wait for a beacon. */
+  turn_radio_on();
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_packet(void)
+{
+  struct rimac_hdr hdr;
+  rtimer_clock_t reception_time;
+
+  reception_time = RTIMER_NOW();
+
+  if(!NETSTACK_FRAMER.parse() ||
+     packetbuf_datalen() < sizeof(struct rimac_hdr)) {
+    PRINTF("rimac: failed to parse %u\n", packetbuf_datalen());
+    turn_radio_off();
+    return;
+  }
+
+  memcpy(&hdr, packetbuf_dataptr(), sizeof(struct rimac_hdr));
+
+  if(hdr.type == TYPE_BEACON) {
+    struct rimac_beacon b;
+    rimeaddr_t from;
+
+    if(packetbuf_datalen() >= sizeof(struct rimac_beacon)) {
+      memcpy(&b, packetbuf_dataptr(), sizeof(struct rimac_beacon));
+      rimeaddr_copy(&from, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      beacon_received(&from, &b, reception_time);
+    }
+    turn_radio_off();
+
+  } else if(hdr.type == TYPE_DATA) {
+    const rimeaddr_t *receiver;
+    int i;
+
+    packetbuf_hdrreduce(sizeof(struct rimac_hdr));
+
+    receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+    if(!rimeaddr_cmp(receiver, &rimeaddr_null)) {
+      if(!rimeaddr_cmp(receiver, &rimeaddr_node_addr)) {
+        /* Not for us */
+        turn_radio_off();
+        return;
+      }
+      /* Acknowledge the packet. The same beacon invites the next
+         packet, so we keep listening. */
+      send_beacon(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                  packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
+    }
+    received_data = 1;
+
+    /* Acknowledgements may be lost, so the sender may send a packet
+       that we already have. */
+    for(i = 0; i < MAX_SEQNOS; ++i) {
+      if(packetbuf_attr(PACKETBUF_ATTR_PACKET_ID) == received_seqnos[i].seqno &&
+         rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                      &received_seqnos[i].sender)) {
+        /* Drop the packet. */
+        turn_radio_off();
+        return;
+      }
+    }
+    for(i = MAX_SEQNOS - 1; i > 0; --i) {
+      memcpy(&received_seqnos[i], &received_seqnos[i - 1],
+             sizeof(struct seqno));
+    }
+    received_seqnos[0].seqno = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
+    rimeaddr_copy(&received_seqnos[0].sender,
+                  packetbuf_addr(PACKETBUF_ADDR_SENDER));
+
+    /* Accumulate the power consumption for the packet reception. */
+    compower_accumulate(&current_packet);
+    /* Convert the accumulated power consumption for the received
+       packet to packet attributes so that the higher levels can
+       keep track of the amount of energy spent on receiving the
+       packet. */
+    compower_attrconv(&current_packet);
+    /* Clear the accumulated power consumption so that it is ready
+       for the next packet. */
+    compower_clear(&current_packet);
+
+    NETSTACK_MAC.input();
+    turn_radio_off();
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rimac_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    backoff_scheduled = 0;
+    transmit_pending();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  rimac_is_on = 1;
+  turn_radio_on();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(int keep_radio_on)
+{
+  rimac_is_on = 0;
+  if(keep_radio_on) {
+    turn_radio_on();
+  } else {
+    NETSTACK_RADIO.off();
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+channel_check_interval(void)
+{
+  return CYCLE_TIME;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  rimac_is_on = 1;
+
+  memb_init(&queued_packets_memb);
+  list_init(queued_packets_list);
+#if WITH_PHASE_OPTIMIZATION
+  phase_init(&rimac_phase_list);
+#endif /* WITH_PHASE_OPTIMIZATION */
+
+  process_start(&rimac_process, NULL);
+  restart_dutycycle(random_rand() % CYCLE_TIME);
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver rimac_driver = {
+  "RI-MAC",
+  init,
+  send_packet,
+  input_packet,
+  on,
+  off,
+  channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
@@ -35,6 +35,7 @@
 
 #include "lib/memb.h"
 #include "lib/list.h"
+#include "lib/addrmap.h"
 #include <stddef.h>
 #include <string.h>
 
@@ -54,11 +55,34 @@ MEMB(neighbor_addr_mem, struct neighbor_addr, NEIGHBOR_ATTR_MAX_NEIGHBORS);
 
 LIST(neighbor_addrs);
 LIST(neighbor_attrs);
+
+#if ADDRMAP_HASHED_LOOKUPS
+/* The number of address map slots, which must be a power of two and
+   larger than the number of neighbors. */
+#ifdef NEIGHBOR_ATTR_CONF_HASH_SLOTS
+#define HASH_SLOTS NEIGHBOR_ATTR_CONF_HASH_SLOTS
+#else /* NEIGHBOR_ATTR_CONF_HASH_SLOTS */
+#define HASH_SLOTS 32
+#endif /* NEIGHBOR_ATTR_CONF_HASH_SLOTS */
+
+#if (HASH_SLOTS & (HASH_SLOTS - 1)) || HASH_SLOTS > 128
+#error NEIGHBOR_ATTR_CONF_HASH_SLOTS must be a power of two, not larger than 128
+#endif
+#if HASH_SLOTS <= NEIGHBOR_ATTR_MAX_NEIGHBORS
+#error NEIGHBOR_ATTR_CONF_HASH_SLOTS must be larger than the number of neighbors
+#endif
+
+static void *neighbor_hash_slots[HASH_SLOTS];
+static struct addrmap neighbor_hash;
+static uint8_t neighbor_hash_initialized;
+#endif /* ADDRMAP_HASHED_LOOKUPS */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_addr *
 neighbor_addr_get(const rimeaddr_t *addr)
 {
+#if !ADDRMAP_HASHED_LOOKUPS
   struct neighbor_addr *item;
+#endif /* !ADDRMAP_HASHED_LOOKUPS */
 
   /* check if addr is derived from table, inside memb */
   if(memb_inmemb(&neighbor_addr_mem, (char *)addr)) {
@@ -66,6 +90,12 @@ neighbor_addr_get(const rimeaddr_t *addr)
         (((char *)addr) - offsetof(struct neighbor_addr, addr));
   }
 
+#if ADDRMAP_HASHED_LOOKUPS
+  if(!neighbor_hash_initialized) {
+    return NULL;
+  }
+  return addrmap_get(&neighbor_hash, addr);
+#else /* ADDRMAP_HASHED_LOOKUPS */
   item = list_head(neighbor_addrs);
   while(item != NULL) {
     if(rimeaddr_cmp(addr, &item->addr)) {
@@ -74,6 +104,7 @@ neighbor_addr_get(const rimeaddr_t *addr)
     item = item->next;
   }
   return NULL;
+#endif /* ADDRMAP_HASHED_LOOKUPS */
 }
 /*---------------------------------------------------------------------------*/
 struct neighbor_addr *
@@ -136,6 +167,20 @@ neighbor_attr_add_neighbor(const rimeaddr_t *addr)
   item->time = 0;
   rimeaddr_copy(&item->addr, addr);
 
+#if ADDRMAP_HASHED_LOOKUPS
+  if(!neighbor_hash_initialized) {
+    ADDRMAP_INIT(&neighbor_hash, neighbor_hash_slots,
+                 struct neighbor_addr, addr);
+    neighbor_hash_initialized = 1;
+  }
+  if(!addrmap_add(&neighbor_hash, item)) {
+    /* A neighbor that is not in the map could not be found. */
+    list_remove(neighbor_addrs, item);
+    memb_free(&neighbor_addr_mem, item);
+    return -1;
+  }
+#endif /* ADDRMAP_HASHED_LOOKUPS */
+
   /* look up index and set default values */
   ptr = neighbor_addr_mem.mem;
   for(i = 0; i < neighbor_addr_mem.num; ++i) {
@@ -159,6 +204,9 @@ neighbor_attr_remove_neighbor(const rimeaddr_t *addr)
   struct neighbor_addr *item = neighbor_addr_get(addr);
 
   if(item != NULL) {
+#if ADDRMAP_HASHED_LOOKUPS
+    addrmap_remove(&neighbor_hash, item);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
     list_remove(neighbor_addrs, item);
     memb_free(&neighbor_addr_mem, item);
     return 0;
@@ -226,6 +274,9 @@ timeout_check(void *ptr)
       if(item->time >= timeout) {
         struct neighbor_addr *next_item = item->next;
 
+#if ADDRMAP_HASHED_LOOKUPS
+        addrmap_remove(&neighbor_hash, item);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
         list_remove(neighbor_addrs, item);
         memb_free(&neighbor_addr_mem, item);
         item = next_item;
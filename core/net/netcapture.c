@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         A packet capture ring
+ */
+
+#include <string.h>
+
+#include "net/netcapture.h"
+#include "net/uip.h"
+
+#if (NETCAPTURE_RECORDS & (NETCAPTURE_RECORDS - 1)) || NETCAPTURE_RECORDS > 256
+#error NETCAPTURE_CONF_RECORDS must be a power of two, not larger than 256
+#endif
+
+static struct netcapture_record records[NETCAPTURE_RECORDS];
+
+/* The head is only written when adding records, and the tail only
+   when removing them. */
+static volatile uint8_t head, tail;
+static unsigned long dropped;
+static struct process *consumer;
+
+/*---------------------------------------------------------------------------*/
+void
+netcapture_add(uint8_t iface, uint8_t dir, const void *data, uint16_t len)
+{
+  struct netcapture_record *r;
+  uint8_t next;
+
+  next = (head + 1) & (NETCAPTURE_RECORDS - 1);
+  if(next == tail) {
+    ++dropped;
+    return;
+  }
+
+  r = &records[head];
+  r->time = clock_time();
+  r->origlen = len;
+  r->len = len < NETCAPTURE_SNAPLEN ? len : NETCAPTURE_SNAPLEN;
+  r->iface = iface;
+  r->dir = dir;
+  memcpy(r->data, data, r->len);
+  head = next;
+
+  if(consumer != NULL) {
+    process_poll(consumer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+netcapture_add_ip(uint8_t dir)
+{
+  const uint8_t *ip;
+  uint16_t len;
+
+  /* The length is taken from the IP header, since uip_len may or may
+     not include the link layer header. */
+  ip = &uip_buf[UIP_LLH_LEN];
+  if((ip[0] >> 4) == 6) {
+    len = ((ip[4] << 8) | ip[5]) + 40;
+  } else {
+    len = (ip[2] << 8) | ip[3];
+  }
+  if(len > UIP_BUFSIZE - UIP_LLH_LEN) {
+    len = UIP_BUFSIZE - UIP_LLH_LEN;
+  }
+  netcapture_add(NETCAPTURE_IFACE_IP, dir, ip, len);
+}
+/*---------------------------------------------------------------------------*/
+void
+netcapture_set_consumer(struct process *p)
+{
+  consumer = p;
+}
+/*---------------------------------------------------------------------------*/
+struct netcapture_record *
+netcapture_peek(void)
+{
+  if(tail == head) {
+    return NULL;
+  }
+  return &records[tail];
+}
+/*---------------------------------------------------------------------------*/
+void
+netcapture_remove(void)
+{
+  if(tail != head) {
+    tail = (tail + 1) & (NETCAPTURE_RECORDS - 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+netcapture_dropped(void)
+{
+  return dropped;
+}
+/*---------------------------------------------------------------------------*/
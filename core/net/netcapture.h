@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \defgroup netcapture Packet capture ring
+ * @{
+ *
+ * The netcapture module copies packets into an in-memory ring as they
+ * pass tcpip_input(), tcpip_output() and the 802.15.4 framer. A
+ * consumer process, such as the pcapng writer of the native
+ * platforms, is polled when records are added and takes them out of
+ * the ring at its own pace.
+ *
+ * Adding a record never blocks and never waits for the consumer: if
+ * the ring is full, the packet is counted as dropped and the caller
+ * goes on. The ring has a single producer side and a single consumer
+ * side, and the head and tail indices are each written by one side
+ * only, so no locking is needed as long as packets are captured from
+ * one execution context.
+ *
+ * Capture is compiled in when NETCAPTURE_CONF_ENABLED is set.
+ */
+
+/**
+ * \file
+ *         Header file for the packet capture ring
+ */
+
+#ifndef __NETCAPTURE_H__
+#define __NETCAPTURE_H__
+
+#include "contiki.h"
+
+#ifdef NETCAPTURE_CONF_ENABLED
+#define NETCAPTURE_ENABLED NETCAPTURE_CONF_ENABLED
+#else /* NETCAPTURE_CONF_ENABLED */
+#define NETCAPTURE_ENABLED 0
+#endif /* NETCAPTURE_CONF_ENABLED */
+
+/* The number of records in the ring. Must be a power of two, not
+   larger than 256. */
+#ifdef NETCAPTURE_CONF_RECORDS
+#define NETCAPTURE_RECORDS NETCAPTURE_CONF_RECORDS
+#else /* NETCAPTURE_CONF_RECORDS */
+#define NETCAPTURE_RECORDS 16
+#endif /* NETCAPTURE_CONF_RECORDS */
+
+/* The maximum number of bytes captured from each packet. */
+#ifdef NETCAPTURE_CONF_SNAPLEN
+#define NETCAPTURE_SNAPLEN NETCAPTURE_CONF_SNAPLEN
+#else /* NETCAPTURE_CONF_SNAPLEN */
+#define NETCAPTURE_SNAPLEN 128
+#endif /* NETCAPTURE_CONF_SNAPLEN */
+
+/* The interfaces at which packets are captured. */
+#define NETCAPTURE_IFACE_IP     0
+#define NETCAPTURE_IFACE_802154 1
+
+/* The direction of a captured packet. */
+#define NETCAPTURE_IN  1
+#define NETCAPTURE_OUT 2
+
+struct netcapture_record {
+  clock_time_t time;
+  uint16_t origlen;
+  uint16_t len;
+  uint8_t iface;
+  uint8_t dir;
+  uint8_t data[NETCAPTURE_SNAPLEN];
+};
+
+#if NETCAPTURE_ENABLED
+#define NETCAPTURE_IP(dir) netcapture_add_ip(dir)
+#define NETCAPTURE_FRAME(dir, data, len)                        \
+  netcapture_add(NETCAPTURE_IFACE_802154, (dir), (data), (len))
+#else /* NETCAPTURE_ENABLED */
+#define NETCAPTURE_IP(dir)
+#define NETCAPTURE_FRAME(dir, data, len)
+#endif /* NETCAPTURE_ENABLED */
+
+/**
+ * \brief      Capture a packet
+ * \param iface The interface, NETCAPTURE_IFACE_IP or NETCAPTURE_IFACE_802154.
+ * \param dir  The direction, NETCAPTURE_IN or NETCAPTURE_OUT.
+ * \param data A pointer to the packet.
+ * \param len  The length of the packet.
+ */
+void netcapture_add(uint8_t iface, uint8_t dir, const void *data,
+                    uint16_t len);
+
+/**
+ * \brief      Capture the IP packet in uip_buf
+ * \param dir  The direction, NETCAPTURE_IN or NETCAPTURE_OUT.
+ */
+void netcapture_add_ip(uint8_t dir);
+
+/**
+ * \brief      Set the process that is polled when records are added
+ * \param p    The consumer process, or NULL.
+ */
+void netcapture_set_consumer(struct process *p);
+
+/**
+ * \brief      Get the oldest record in the ring
+ * \return     The record, or NULL if the ring is empty.
+ *
+ *             The record stays in the ring until netcapture_remove()
+ *             is called.
+ */
+struct netcapture_record *netcapture_peek(void);
+
+/**
+ * \brief      Remove the oldest record from the ring
+ */
+void netcapture_remove(void);
+
+/**
+ * \brief      Get the number of packets that did not fit in the ring
+ */
+unsigned long netcapture_dropped(void);
+
+#endif /* __NETCAPTURE_H__ */
+
+/** @} */
+/** @} */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Sending parts of CFS files over protosockets
+ */
+
+#include <string.h>
+
+#include "net/psock-sendfile.h"
+
+#if PSOCK_SENDFILE_CACHE
+static struct {
+  int fd;
+  cfs_offset_t offset;
+  u16_t len;
+  u8_t data[UIP_TCP_MSS];
+} cache = { -1 };
+#endif /* PSOCK_SENDFILE_CACHE */
+
+/*---------------------------------------------------------------------------*/
+cfs_offset_t
+psock_sendfile_init(struct psock_sendfile *sf, int fd,
+                    cfs_offset_t offset, cfs_offset_t len)
+{
+  cfs_offset_t size;
+
+  sf->psock = NULL;
+  sf->fd = fd;
+  sf->offset = offset;
+  sf->len = 0;
+
+  size = cfs_seek(fd, 0, CFS_SEEK_END);
+  if(size < 0 || offset >= size) {
+    sf->left = 0;
+  } else if(len < 0 || len > size - offset) {
+    sf->left = size - offset;
+  } else {
+    sf->left = len;
+  }
+
+#if PSOCK_SENDFILE_CACHE
+  /* The file descriptor may have been used for another file. */
+  if(cache.fd == fd) {
+    cache.fd = -1;
+  }
+#endif /* PSOCK_SENDFILE_CACHE */
+
+  return sf->left;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+psock_sendfile_generate(void *arg)
+{
+  struct psock_sendfile *sf = arg;
+  u16_t len;
+
+  len = uip_mss();
+#if PSOCK_OUTPUT_QUEUE
+  /* Leave room for the data queued on the protosocket, so that it
+     goes out in the same segment. */
+  len -= sf->psock->queuelen;
+#endif /* PSOCK_OUTPUT_QUEUE */
+  if(sf->left < len) {
+    len = sf->left;
+  }
+  sf->len = len;
+
+#if PSOCK_SENDFILE_CACHE
+  /* A retransmission is served from the cache. */
+  if(cache.fd == sf->fd && cache.offset == sf->offset && cache.len >= len) {
+    memcpy(uip_appdata, cache.data, len);
+    return len;
+  }
+#endif /* PSOCK_SENDFILE_CACHE */
+
+  if(cfs_seek(sf->fd, sf->offset, CFS_SEEK_SET) != sf->offset ||
+     cfs_read(sf->fd, uip_appdata, len) != len) {
+    /* The data cannot be regenerated, so the transfer cannot go on. */
+    sf->left = 0;
+    sf->len = 0;
+    uip_abort();
+    return 0;
+  }
+
+#if PSOCK_SENDFILE_CACHE
+  cache.fd = sf->fd;
+  cache.offset = sf->offset;
+  cache.len = len;
+  memcpy(cache.data, uip_appdata, len);
+#endif /* PSOCK_SENDFILE_CACHE */
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+void
+psock_sendfile_acked(struct psock_sendfile *sf)
+{
+  sf->offset += sf->len;
+  sf->left -= sf->len;
+  sf->len = 0;
+}
+/*---------------------------------------------------------------------------*/
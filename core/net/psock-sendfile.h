@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \addtogroup psock
+ * @{
+ */
+
+/**
+ * \defgroup psocksendfile Sending files over protosockets
+ * @{
+ *
+ * This module sends a part of a CFS file over a protosocket. The file
+ * is read with cfs_read() directly into the uip_appdata buffer, one
+ * segment at a time, so no application buffer is needed. The most
+ * recently sent segment is kept in a cache, so that a retransmission
+ * does not have to read the file again.
+ *
+ * The module works with every CFS implementation, such as Coffee and
+ * cfs-posix, that supports cfs_seek().
+ *
+ * Typical usage:
+ \code
+ static struct psock_sendfile sf;
+
+ PT_THREAD(send_file(struct psock *s, int fd))
+ {
+   PSOCK_BEGIN(s);
+
+   psock_sendfile_init(&sf, fd, 0, -1);
+   PSOCK_SENDFILE(s, &sf);
+
+   PSOCK_END(s);
+ }
+ \endcode
+ */
+
+/**
+ * \file
+ *         Header file for sending files over protosockets
+ */
+
+#ifndef __PSOCK_SENDFILE_H__
+#define __PSOCK_SENDFILE_H__
+
+#include "net/psock.h"
+#include "cfs/cfs.h"
+
+/* Determines if the most recently sent segment is cached for
+   retransmissions. The cache takes UIP_TCP_MSS bytes of RAM. */
+#ifdef PSOCK_SENDFILE_CONF_CACHE
+#define PSOCK_SENDFILE_CACHE PSOCK_SENDFILE_CONF_CACHE
+#else /* PSOCK_SENDFILE_CONF_CACHE */
+#define PSOCK_SENDFILE_CACHE 1
+#endif /* PSOCK_SENDFILE_CONF_CACHE */
+
+/**
+ * The state of a file transfer. The structure has no user-visible
+ * elements.
+ */
+struct psock_sendfile {
+  struct psock *psock;
+  int fd;
+  cfs_offset_t offset;
+  cfs_offset_t left;
+  u16_t len;
+};
+
+/**
+ * \brief      Prepare a file transfer
+ * \param sf   A pointer to the state of the transfer.
+ * \param fd   A file descriptor of a file opened with CFS_READ.
+ * \param offset The offset of the first byte to be sent.
+ * \param len  The number of bytes to send, or -1 to send the rest of
+ *             the file.
+ * \return     The number of bytes that will be sent.
+ *
+ *             The length is limited to the size of the file. The
+ *             file must not be written to while it is being sent.
+ */
+cfs_offset_t psock_sendfile_init(struct psock_sendfile *sf, int fd,
+                                 cfs_offset_t offset, cfs_offset_t len);
+
+/**
+ * \brief      Send a file over a protosocket
+ * \param psock A pointer to the protosocket.
+ * \param sf   A pointer to a transfer prepared with psock_sendfile_init().
+ *
+ *             This macro sends the file and blocks until all of it
+ *             has been received by the remote end of the TCP
+ *             connection. If the file cannot be read, the connection
+ *             is aborted.
+ *
+ *             The file is sent with PSOCK_GENERATOR_SEND(), so data
+ *             queued with PSOCK_QUEUE() is sent in the same segment
+ *             as the beginning of the file when there is room.
+ * \hideinitializer
+ */
+#define PSOCK_SENDFILE(psock, sf)                                  \
+  while((sf)->left > 0) {                                          \
+    (sf)->psock = (psock);                                         \
+    PSOCK_GENERATOR_SEND(psock, psock_sendfile_generate, sf);      \
+    psock_sendfile_acked(sf);                                      \
+  }
+
+unsigned short psock_sendfile_generate(void *sf);
+void psock_sendfile_acked(struct psock_sendfile *sf);
+
+#endif /* __PSOCK_SENDFILE_H__ */
+
+/** @} */
+/** @} */
@@ -166,6 +166,125 @@ data_is_sent_and_acked(CC_REGISTER_ARG struct psock *s)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if PSOCK_OUTPUT_QUEUE
+static void
+queue_add(struct psock *s, const u8_t *buf, u16_t len)
+{
+  s->pieces[s->npieces].ptr = buf;
+  s->pieces[s->npieces].len = len;
+  ++s->npieces;
+  s->queuelen += len;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Copy up to len bytes from the start of the output queue to dest,
+ * and return the number of bytes copied.
+ */
+static u16_t
+queue_gather(struct psock *s, u8_t *dest, u16_t len)
+{
+  struct psock_piece *p;
+  u16_t copied, n;
+
+  copied = 0;
+  for(p = &s->pieces[0]; p < &s->pieces[s->npieces] && copied < len; ++p) {
+    n = p->len;
+    if(n > len - copied) {
+      n = len - copied;
+    }
+    memcpy(dest + copied, p->ptr, n);
+    copied += n;
+  }
+  return copied;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Remove len bytes from the start of the output queue.
+ */
+static void
+queue_consume(struct psock *s, u16_t len)
+{
+  u8_t i;
+
+  s->queuelen -= len;
+  for(i = 0; i < s->npieces && len >= s->pieces[i].len; ++i) {
+    len -= s->pieces[i].len;
+  }
+  if(i > 0) {
+    s->npieces -= i;
+    memmove(&s->pieces[0], &s->pieces[i],
+            s->npieces * sizeof(struct psock_piece));
+  }
+  if(s->npieces > 0) {
+    s->pieces[0].ptr += len;
+    s->pieces[0].len -= len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static char
+queue_is_sent_and_acked(CC_REGISTER_ARG struct psock *s)
+{
+  /* This works as data_is_sent_and_acked(), but the segment is
+     gathered from the pieces in the output queue. */
+  if(s->state != STATE_DATA_SENT || uip_rexmit()) {
+    s->sendlen = queue_gather(s, uip_appdata, uip_mss());
+    uip_send(uip_appdata, s->sendlen);
+    s->state = STATE_DATA_SENT;
+    return 0;
+  } else if(s->state == STATE_DATA_SENT && uip_acked()) {
+    queue_consume(s, s->sendlen);
+    s->state = STATE_ACKED;
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+PT_THREAD(psock_queue(CC_REGISTER_ARG struct psock *s, const uint8_t *buf,
+                      unsigned int len))
+{
+  PT_BEGIN(&s->psockpt);
+
+  if(len == 0) {
+    PT_EXIT(&s->psockpt);
+  }
+
+  s->state = STATE_NONE;
+
+  /* If there is no room for another piece, send what is queued. */
+  if(s->npieces == PSOCK_QUEUE_PIECES) {
+    while(s->queuelen > 0) {
+      PT_WAIT_UNTIL(&s->psockpt, queue_is_sent_and_acked(s));
+    }
+  }
+
+  queue_add(s, buf, len);
+
+  /* Send all full segments. */
+  while(s->queuelen >= uip_mss()) {
+    PT_WAIT_UNTIL(&s->psockpt, queue_is_sent_and_acked(s));
+  }
+
+  s->state = STATE_NONE;
+
+  PT_END(&s->psockpt);
+}
+/*---------------------------------------------------------------------------*/
+PT_THREAD(psock_flush(CC_REGISTER_ARG struct psock *s))
+{
+  PT_BEGIN(&s->psockpt);
+
+  s->state = STATE_NONE;
+
+  while(s->queuelen > 0) {
+    PT_WAIT_UNTIL(&s->psockpt, queue_is_sent_and_acked(s));
+  }
+
+  s->state = STATE_NONE;
+
+  PT_END(&s->psockpt);
+}
+#endif /* PSOCK_OUTPUT_QUEUE */
+/*---------------------------------------------------------------------------*/
 PT_THREAD(psock_send(CC_REGISTER_ARG struct psock *s, const uint8_t *buf,
 		     unsigned int len))
 {
@@ -176,6 +295,25 @@ PT_THREAD(psock_send(CC_REGISTER_ARG struct psock *s, const uint8_t *buf,
     PT_EXIT(&s->psockpt);
   }
 
+#if PSOCK_OUTPUT_QUEUE
+  /* If there is queued data, the data is added to the queue and
+     sent in the same segments as the queued data. */
+  if(s->queuelen > 0) {
+    s->state = STATE_NONE;
+    if(s->npieces == PSOCK_QUEUE_PIECES) {
+      while(s->queuelen > 0) {
+        PT_WAIT_UNTIL(&s->psockpt, queue_is_sent_and_acked(s));
+      }
+    }
+    queue_add(s, buf, len);
+    while(s->queuelen > 0) {
+      PT_WAIT_UNTIL(&s->psockpt, queue_is_sent_and_acked(s));
+    }
+    s->state = STATE_NONE;
+    PT_EXIT(&s->psockpt);
+  }
+#endif /* PSOCK_OUTPUT_QUEUE */
+
   /* Save the length of and a pointer to the data that is to be
      sent. */
   s->sendptr = buf;
@@ -209,6 +347,40 @@ PT_THREAD(psock_generator_send(CC_REGISTER_ARG struct psock *s,
     PT_EXIT(&s->psockpt);
   }
 
+#if PSOCK_OUTPUT_QUEUE
+  if(s->queuelen > 0) {
+    s->state = STATE_NONE;
+    do {
+      /* Put the generated data after the queued data, if the two fit
+         in one segment. */
+      s->sendlen = generate(arg);
+      if(s->queuelen + s->sendlen > uip_mss()) {
+        s->state = STATE_NONE;
+        break;
+      }
+      memmove((u8_t *)uip_appdata + s->queuelen, uip_appdata, s->sendlen);
+      queue_gather(s, uip_appdata, s->queuelen);
+      uip_send(uip_appdata, s->queuelen + s->sendlen);
+      s->state = STATE_DATA_SENT;
+
+      PT_YIELD_UNTIL(&s->psockpt, uip_acked() || uip_rexmit());
+    } while(!uip_acked());
+
+    if(s->state == STATE_DATA_SENT) {
+      s->npieces = 0;
+      s->queuelen = 0;
+      s->state = STATE_NONE;
+      PT_EXIT(&s->psockpt);
+    }
+
+    /* The generated data did not fit, so we send the queued data
+       first. The generator is called again below. */
+    while(s->queuelen > 0) {
+      PT_WAIT_UNTIL(&s->psockpt, queue_is_sent_and_acked(s));
+    }
+  }
+#endif /* PSOCK_OUTPUT_QUEUE */
+
   s->state = STATE_NONE;
   do {
     /* Call the generator function to generate the data in the
@@ -323,6 +495,10 @@ psock_init(CC_REGISTER_ARG struct psock *psock,
   psock->readlen = 0;
   psock->bufptr = buffer;
   psock->bufsize = buffersize;
+#if PSOCK_OUTPUT_QUEUE
+  psock->npieces = 0;
+  psock->queuelen = 0;
+#endif /* PSOCK_OUTPUT_QUEUE */
   buf_setup(&psock->buf, buffer, buffersize);
   PT_INIT(&psock->pt);
   PT_INIT(&psock->psockpt);
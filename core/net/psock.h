@@ -74,6 +74,15 @@
  * in which the protosocket is used. Similarly, the protosocket protothread can
  * be terminated by a call to PSOCK_EXIT().
  *
+ * When PSOCK_CONF_OUTPUT_QUEUE is set, data can be queued for sending
+ * with PSOCK_QUEUE(). Queued data is only sent when a full segment
+ * has been queued, when PSOCK_FLUSH() is called, or together with the
+ * data of the next PSOCK_SEND() or PSOCK_GENERATOR_SEND(). This lets
+ * a protosocket send e.g. an HTTP header and the beginning of the
+ * body in one segment instead of waiting for one acknowledgement per
+ * piece of data. The queue holds pointers to the data, which is
+ * copied directly into the outgoing packet.
+ *
  */
 
 /**
@@ -104,6 +113,27 @@ struct psock_buf {
   unsigned short left;
 };
 
+#ifdef PSOCK_CONF_OUTPUT_QUEUE
+#define PSOCK_OUTPUT_QUEUE PSOCK_CONF_OUTPUT_QUEUE
+#else /* PSOCK_CONF_OUTPUT_QUEUE */
+#define PSOCK_OUTPUT_QUEUE 0
+#endif /* PSOCK_CONF_OUTPUT_QUEUE */
+
+/* The number of pieces of data that can be queued on a protosocket. */
+#ifdef PSOCK_CONF_QUEUE_PIECES
+#define PSOCK_QUEUE_PIECES PSOCK_CONF_QUEUE_PIECES
+#else /* PSOCK_CONF_QUEUE_PIECES */
+#define PSOCK_QUEUE_PIECES 4
+#endif /* PSOCK_CONF_QUEUE_PIECES */
+
+/*
+ * A piece of data in the output queue of a protosocket.
+ */
+struct psock_piece {
+  const u8_t *ptr;
+  u16_t len;
+};
+
 /**
  * The representation of a protosocket.
  *
@@ -128,6 +158,12 @@ struct psock {
   unsigned int bufsize;  /* The size of the input buffer. */
   
   unsigned char state;   /* The state of the protosocket. */
+
+#if PSOCK_OUTPUT_QUEUE
+  struct psock_piece pieces[PSOCK_QUEUE_PIECES]; /* The output queue. */
+  u8_t npieces;          /* The number of pieces in the output queue. */
+  u16_t queuelen;        /* The number of bytes in the output queue. */
+#endif /* PSOCK_OUTPUT_QUEUE */
 };
 
 void psock_init(struct psock *psock, uint8_t *buffer, unsigned int buffersize);
@@ -180,6 +216,9 @@ PT_THREAD(psock_send(struct psock *psock, const uint8_t *buf, unsigned int len))
  * \param datalen (unsigned int) The length of the data that is to be
  * sent.
  *
+ * If data has been queued with PSOCK_QUEUE(), the queued data is sent
+ * first, in the same segments as the data.
+ *
  * \hideinitializer
  */
 #define PSOCK_SEND(psock, data, datalen)		\
@@ -221,12 +260,65 @@ PT_THREAD(psock_generator_send(struct psock *psock,
  *             called by the protosocket layer when the data first is
  *             sent, and once for every retransmission that is needed.
  *
+ *             If data has been queued with PSOCK_QUEUE(), and the
+ *             queued data and the generated data fit in one segment,
+ *             they are sent together. Otherwise the queued data is
+ *             sent first.
+ *
  * \hideinitializer
  */
 #define PSOCK_GENERATOR_SEND(psock, generator, arg)     \
     PT_WAIT_THREAD(&((psock)->pt),					\
 		   psock_generator_send(psock, generator, arg))
 
+#if PSOCK_OUTPUT_QUEUE
+PT_THREAD(psock_queue(struct psock *psock, const uint8_t *buf,
+                      unsigned int len));
+/**
+ * \brief      Queue data for sending
+ * \param psock Pointer to the protosocket.
+ * \param data Pointer to the data.
+ * \param datalen The length of the data.
+ *
+ *             This macro puts data in the output queue of the
+ *             protosocket. The protosocket protothread only blocks
+ *             if the queue holds a full segment, which is then sent,
+ *             or if the queue has no room for another piece of data.
+ *
+ *             The data is not copied. It must not be changed until
+ *             it has been sent, i.e., until the next PSOCK_SEND(),
+ *             PSOCK_GENERATOR_SEND() or PSOCK_FLUSH() has returned.
+ *
+ * \hideinitializer
+ */
+#define PSOCK_QUEUE(psock, data, datalen)               \
+  PT_WAIT_THREAD(&((psock)->pt), psock_queue(psock, data, datalen))
+
+/**
+ * \brief      Queue a null-terminated string for sending
+ * \param psock Pointer to the protosocket.
+ * \param str  The string to be queued.
+ * \hideinitializer
+ */
+#define PSOCK_QUEUE_STR(psock, str)                     \
+  PT_WAIT_THREAD(&((psock)->pt), psock_queue(psock, (uint8_t *)str, strlen(str)))
+
+PT_THREAD(psock_flush(struct psock *psock));
+/**
+ * \brief      Send all queued data
+ * \param psock Pointer to the protosocket.
+ *
+ *             This macro sends the data in the output queue of the
+ *             protosocket, and blocks until it has been received by
+ *             the remote end of the TCP connection. Queued data must
+ *             be flushed before the protosocket is closed.
+ *
+ * \hideinitializer
+ */
+#define PSOCK_FLUSH(psock)                              \
+  PT_WAIT_THREAD(&((psock)->pt), psock_flush(psock))
+#endif /* PSOCK_OUTPUT_QUEUE */
+
 
 /**
  * Close a protosocket.
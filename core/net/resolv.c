@@ -17,6 +17,11 @@
  * resolved. It is up to the receiving process to determine if the
  * correct hostname has been found by calling the resolv_lookup()
  * function with the hostname.
+ *
+ * Answers are cached for the time to live of their records, and
+ * names that do not exist are cached for
+ * UIP_CONF_RESOLV_NEGATIVE_TTL seconds. IPv6 builds ask for AAAA
+ * records, and IPv4 builds for A records.
  */
 
 /**
@@ -65,6 +70,8 @@
 #include "net/resolv.h"
 #if UIP_UDP
 
+#include "lib/random.h"
+
 #include <string.h>
 
 #ifndef NULL
@@ -72,29 +79,12 @@
 #endif /* NULL */
 
 #if UIP_CONF_IPV6
-
-/* Currently this implementation only supports IPv4 DNS lookups.
-   Until support for IPv6 is added, dummy functions are used to
-   enable compilation with IPv6.
-*/
-
-process_event_t resolv_event_found;
-
-PROCESS(resolv_process, "DNS resolver");
-
-void resolv_conf(const uip_ipaddr_t *dnsserver) { }
-uip_ipaddr_t *resolv_getserver(void) { return NULL; }
-uip_ipaddr_t *resolv_lookup(const char *name) { return NULL; }
-void resolv_query(const char *name) { }
-
-PROCESS_THREAD(resolv_process, ev, data)
-{
-  PROCESS_BEGIN();
-  resolv_event_found = process_alloc_event();
-  PROCESS_END();
-}
-
+/* IPv6 builds ask for AAAA records, IPv4 builds for A records. */
+#define DNS_TYPE_ADDR 28
 #else /* UIP_CONF_IPV6 */
+#define DNS_TYPE_ADDR 1
+#endif /* UIP_CONF_IPV6 */
+#define DNS_CLASS_IN  1
 
 /** \internal The maximum number of retries when asking for a name. */
 #define MAX_RETRIES 8
@@ -128,7 +118,7 @@ struct dns_answer {
   u16_t class;
   u16_t ttl[2];
   u16_t len;
-  u8_t ipaddr[4];
+  u8_t ipaddr[sizeof(uip_ipaddr_t)];
 };
 
 struct namemap {
@@ -142,6 +132,8 @@ struct namemap {
   u8_t retries;
   u8_t seqno;
   u8_t err;
+  u16_t id;
+  unsigned long expiration;
   char name[32];
   uip_ipaddr_t ipaddr;
 };
@@ -152,6 +144,22 @@ struct namemap {
 #define RESOLV_ENTRIES UIP_CONF_RESOLV_ENTRIES
 #endif /* UIP_CONF_RESOLV_ENTRIES */
 
+/* Addresses are cached for the TTL of their record, but for at most
+   this many seconds. */
+#ifndef UIP_CONF_RESOLV_MAX_TTL
+#define RESOLV_MAX_TTL (24 * 60 * 60UL)
+#else /* UIP_CONF_RESOLV_MAX_TTL */
+#define RESOLV_MAX_TTL UIP_CONF_RESOLV_MAX_TTL
+#endif /* UIP_CONF_RESOLV_MAX_TTL */
+
+/* Names that do not exist, or have no address, are remembered for
+   this many seconds before they are asked for again. */
+#ifndef UIP_CONF_RESOLV_NEGATIVE_TTL
+#define RESOLV_NEGATIVE_TTL 60
+#else /* UIP_CONF_RESOLV_NEGATIVE_TTL */
+#define RESOLV_NEGATIVE_TTL UIP_CONF_RESOLV_NEGATIVE_TTL
+#endif /* UIP_CONF_RESOLV_NEGATIVE_TTL */
+
 
 static struct namemap names[RESOLV_ENTRIES];
 
@@ -198,72 +206,158 @@ parse_name(unsigned char *query)
 }
 /*-----------------------------------------------------------------------------------*/
 /** \internal
- * Runs through the list of names to see if there are any that have
- * not yet been queried and, if so, sends out a query.
+ * Sets the time at which a cached answer becomes stale.
  */
 /*-----------------------------------------------------------------------------------*/
 static void
-check_entries(void)
+set_expiration(struct namemap *namemapptr, unsigned long ttl)
+{
+  if(ttl > RESOLV_MAX_TTL) {
+    ttl = RESOLV_MAX_TTL;
+  }
+  namemapptr->expiration = clock_seconds() + ttl;
+}
+/*-----------------------------------------------------------------------------------*/
+static int
+is_expired(struct namemap *namemapptr)
+{
+  return clock_seconds() >= namemapptr->expiration;
+}
+/*-----------------------------------------------------------------------------------*/
+static int
+is_pending(struct namemap *namemapptr)
+{
+  return namemapptr->state == STATE_NEW || namemapptr->state == STATE_ASKING;
+}
+/*-----------------------------------------------------------------------------------*/
+/** \internal
+ * Finds the entry of a hostname, in any state.
+ */
+/*-----------------------------------------------------------------------------------*/
+static struct namemap *
+find_name(const char *name)
+{
+  static u8_t i;
+  register struct namemap *namemapptr;
+
+  for(i = 0; i < RESOLV_ENTRIES; ++i) {
+    namemapptr = &names[i];
+    if(namemapptr->state != STATE_UNUSED &&
+       strcmp(name, namemapptr->name) == 0) {
+      return namemapptr;
+    }
+  }
+  return NULL;
+}
+/*-----------------------------------------------------------------------------------*/
+/** \internal
+ * Sends a query for a name.
+ */
+/*-----------------------------------------------------------------------------------*/
+static void
+send_query(struct namemap *namemapptr)
 {
   register struct dns_hdr *hdr;
   char *query, *nptr, *nameptr;
-  uint8_t i;
   uint8_t n;
+
+  /* A new ID is used for every query, so that an answer to an
+     earlier query for the entry is not taken for an answer to this
+     one. */
+  namemapptr->id = random_rand();
+
+  hdr = (struct dns_hdr *)uip_appdata;
+  memset(hdr, 0, sizeof(struct dns_hdr));
+  hdr->id = namemapptr->id;
+  hdr->flags1 = DNS_FLAG1_RD;
+  hdr->numquestions = UIP_HTONS(1);
+  query = (char *)uip_appdata + 12;
+  nameptr = namemapptr->name;
+  --nameptr;
+  /* Convert hostname into suitable query format. */
+  do {
+    ++nameptr;
+    nptr = query;
+    ++query;
+    for(n = 0; *nameptr != '.' && *nameptr != 0; ++nameptr) {
+      *query = *nameptr;
+      ++query;
+      ++n;
+    }
+    *nptr = n;
+  } while(*nameptr != 0);
+  {
+    static unsigned char endquery[] =
+      {0,0,DNS_TYPE_ADDR,0,DNS_CLASS_IN};
+    memcpy(query, endquery, 5);
+  }
+  uip_udp_send((unsigned char)(query + 5 - (char *)uip_appdata));
+}
+/*-----------------------------------------------------------------------------------*/
+/** \internal
+ * Sends a query for the first name that needs one. Only one packet
+ * can be sent per poll, so the connection is polled again if more
+ * names are waiting. The queries are all in flight at the same time.
+ */
+/*-----------------------------------------------------------------------------------*/
+static void
+check_entries(void)
+{
+  uint8_t i;
+  u8_t sent;
   register struct namemap *namemapptr;
-  
+
+  sent = 0;
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     namemapptr = &names[i];
-    if(namemapptr->state == STATE_NEW ||
-       namemapptr->state == STATE_ASKING) {
-      etimer_set(&retry, CLOCK_SECOND);
-      if(namemapptr->state == STATE_ASKING) {
-	if(--namemapptr->tmr == 0) {
-	  if(++namemapptr->retries == MAX_RETRIES) {
-	    namemapptr->state = STATE_ERROR;
-	    resolv_found(namemapptr->name, NULL);
-	    continue;
-	  }
-	  namemapptr->tmr = namemapptr->retries;
-	} else {
-	  /*	  printf("Timer %d\n", namemapptr->tmr);*/
-	  /* Its timer has not run out, so we move on to next
-	     entry. */
-	  continue;
-	}
-      } else {
-	namemapptr->state = STATE_ASKING;
-	namemapptr->tmr = 1;
-	namemapptr->retries = 0;
+    if(namemapptr->state == STATE_NEW) {
+      if(sent) {
+        tcpip_poll_udp(resolv_conn);
+        return;
       }
-      hdr = (struct dns_hdr *)uip_appdata;
-      memset(hdr, 0, sizeof(struct dns_hdr));
-      hdr->id = uip_htons(i);
-      hdr->flags1 = DNS_FLAG1_RD;
-      hdr->numquestions = UIP_HTONS(1);
-      query = (char *)uip_appdata + 12;
-      nameptr = namemapptr->name;
-      --nameptr;
-      /* Convert hostname into suitable query format. */
-      do {
-	++nameptr;
-	nptr = query;
-	++query;
-	for(n = 0; *nameptr != '.' && *nameptr != 0; ++nameptr) {
-	  *query = *nameptr;
-	  ++query;
-	  ++n;
-	}
-	*nptr = n;
-      } while(*nameptr != 0);
-      {
-	static unsigned char endquery[] =
-	  {0,0,1,0,1};
-	memcpy(query, endquery, 5);
+      send_query(namemapptr);
+      namemapptr->state = STATE_ASKING;
+      namemapptr->tmr = namemapptr->retries > 0 ? namemapptr->retries : 1;
+      sent = 1;
+    }
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+/** \internal
+ * Runs once a second while there are unanswered queries, and marks
+ * the names whose answers are overdue to be asked for again.
+ */
+/*-----------------------------------------------------------------------------------*/
+static void
+check_timeouts(void)
+{
+  uint8_t i;
+  u8_t pending;
+  register struct namemap *namemapptr;
+
+  pending = 0;
+  for(i = 0; i < RESOLV_ENTRIES; ++i) {
+    namemapptr = &names[i];
+    if(namemapptr->state == STATE_ASKING && --namemapptr->tmr == 0) {
+      if(++namemapptr->retries == MAX_RETRIES) {
+        /* The server does not answer. This is not cached, so that
+           the next query for the name tries again. */
+        namemapptr->state = STATE_ERROR;
+        namemapptr->expiration = clock_seconds();
+        resolv_found(namemapptr->name, NULL);
+        continue;
       }
-      uip_udp_send((unsigned char)(query + 5 - (char *)uip_appdata));
-      break;
+      namemapptr->state = STATE_NEW;
+    }
+    if(is_pending(namemapptr)) {
+      pending = 1;
     }
   }
+
+  if(pending) {
+    etimer_reset(&retry);
+    tcpip_poll_udp(resolv_conn);
+  }
 }
 /*-----------------------------------------------------------------------------------*/
 /** \internal
@@ -276,7 +370,7 @@ newdata(void)
   unsigned char *nameptr;
   struct dns_answer *ans;
   struct dns_hdr *hdr;
-  static u8_t nquestions, nanswers;
+  static u8_t nanswers;
   static u8_t i;
   register struct namemap *namemapptr;
   
@@ -291,75 +385,83 @@ newdata(void)
 	 uip_htons(hdr->numextrarr));
   */
 
-  /* The ID in the DNS header should be our entry into the name
-     table. */
-  i = (u8_t)uip_htons(hdr->id);
-  namemapptr = &names[i];
-  if(i < RESOLV_ENTRIES &&
-     namemapptr->state == STATE_ASKING) {
-
-    /* This entry is now finished. */
-    namemapptr->state = STATE_DONE;
-    namemapptr->err = hdr->flags2 & DNS_FLAG2_ERR_MASK;
-
-    /* Check for error. If so, call callback to inform. */
-    if(namemapptr->err != 0) {
-      namemapptr->state = STATE_ERROR;
-      resolv_found(namemapptr->name, NULL);
-      return;
+  /* Find the outstanding query with the ID of the answer. */
+  for(i = 0; i < RESOLV_ENTRIES; ++i) {
+    namemapptr = &names[i];
+    if(namemapptr->state == STATE_ASKING &&
+       namemapptr->id == hdr->id) {
+      break;
     }
+  }
+  if(i == RESOLV_ENTRIES) {
+    return;
+  }
 
-    /* We only care about the question(s) and the answers. The authrr
-       and the extrarr are simply discarded. */
-    nquestions = (u8_t)uip_htons(hdr->numquestions);
-    nanswers = (u8_t)uip_htons(hdr->numanswers);
-
-    /* Skip the name in the question. XXX: This should really be
-       checked agains the name in the question, to be sure that they
-       match. */
-    nameptr = parse_name((uint8_t *)uip_appdata + 12) + 4;
-
-    while(nanswers > 0) {
-      /* The first byte in the answer resource record determines if it
-	 is a compressed record or a normal one. */
-      if(*nameptr & 0xc0) {
-	/* Compressed name. */
-	nameptr +=2;
-	/*	printf("Compressed anwser\n");*/
-      } else {
-	/* Not compressed name. */
-	nameptr = parse_name((uint8_t *)nameptr);
-      }
+  namemapptr->err = hdr->flags2 & DNS_FLAG2_ERR_MASK;
 
-      ans = (struct dns_answer *)nameptr;
-      /*      printf("Answer: type %x, class %x, ttl %x, length %x\n",
-	     uip_htons(ans->type), uip_htons(ans->class), (uip_htons(ans->ttl[0])
-	     << 16) | uip_htons(ans->ttl[1]), uip_htons(ans->len));*/
-
-      /* Check for IP address type and Internet class. Others are
-	 discarded. */
-      if(ans->type == UIP_HTONS(1) &&
-	 ans->class == UIP_HTONS(1) &&
-	 ans->len == UIP_HTONS(4)) {
-	/*	printf("IP address %d.%d.%d.%d\n",
-	       ans->ipaddr[0],
-	       ans->ipaddr[1],
-	       ans->ipaddr[2],
-	       ans->ipaddr[3]);*/
-	/* XXX: we should really check that this IP address is the one
-	   we want. */
-        for(i = 0; i < 4; i++) {
-          namemapptr->ipaddr.u8[i] = ans->ipaddr[i];
-        }
-	
-	resolv_found(namemapptr->name, &namemapptr->ipaddr);
-	return;
-      } else {
-	nameptr = nameptr + 10 + uip_htons(ans->len);
-      }
-      --nanswers;
+  /* Check for error. If so, call callback to inform. Only names that
+     do not exist are cached; other errors are not the name's fault. */
+  if(namemapptr->err != 0) {
+    namemapptr->state = STATE_ERROR;
+    if(namemapptr->err == DNS_FLAG2_ERR_NAME) {
+      set_expiration(namemapptr, RESOLV_NEGATIVE_TTL);
+    } else {
+      namemapptr->expiration = clock_seconds();
+    }
+    resolv_found(namemapptr->name, NULL);
+    return;
+  }
+
+  /* We only care about the question(s) and the answers. The authrr
+     and the extrarr are simply discarded. */
+  nanswers = (u8_t)uip_htons(hdr->numanswers);
+
+  /* Skip the name in the question. XXX: This should really be
+     checked agains the name in the question, to be sure that they
+     match. */
+  nameptr = parse_name((uint8_t *)uip_appdata + 12) + 4;
+
+  while(nanswers > 0) {
+    /* The first byte in the answer resource record determines if it
+       is a compressed record or a normal one. */
+    if(*nameptr & 0xc0) {
+      /* Compressed name. */
+      nameptr +=2;
+      /*	printf("Compressed anwser\n");*/
+    } else {
+      /* Not compressed name. */
+      nameptr = parse_name((uint8_t *)nameptr);
+    }
+
+    ans = (struct dns_answer *)nameptr;
+    /*      printf("Answer: type %x, class %x, ttl %x, length %x\n",
+	   uip_htons(ans->type), uip_htons(ans->class), (uip_htons(ans->ttl[0])
+	   << 16) | uip_htons(ans->ttl[1]), uip_htons(ans->len));*/
+
+    /* Check for IP address type and Internet class. Others, such as
+       CNAME records, are skipped. */
+    if(ans->type == UIP_HTONS(DNS_TYPE_ADDR) &&
+       ans->class == UIP_HTONS(DNS_CLASS_IN) &&
+       ans->len == UIP_HTONS(sizeof(uip_ipaddr_t))) {
+      /* XXX: we should really check that this IP address is the one
+	 we want. */
+      memcpy(&namemapptr->ipaddr, ans->ipaddr, sizeof(uip_ipaddr_t));
+      namemapptr->state = STATE_DONE;
+      set_expiration(namemapptr,
+                     ((unsigned long)uip_htons(ans->ttl[0]) << 16) |
+                     uip_htons(ans->ttl[1]));
+      resolv_found(namemapptr->name, &namemapptr->ipaddr);
+      return;
+    } else {
+      nameptr = nameptr + 10 + uip_htons(ans->len);
     }
+    --nanswers;
   }
+
+  /* The name exists, but has no address. */
+  namemapptr->state = STATE_ERROR;
+  set_expiration(namemapptr, RESOLV_NEGATIVE_TTL);
+  resolv_found(namemapptr->name, NULL);
 }
 /*-----------------------------------------------------------------------------------*/
 /** \internal
@@ -384,7 +486,7 @@ PROCESS_THREAD(resolv_process, ev, data)
     
     if(ev == PROCESS_EVENT_TIMER) {
       if(resolv_conn != NULL) {
-        tcpip_poll_udp(resolv_conn);
+        check_timeouts();
       }
 
     } else if(ev == EVENT_NEW_SERVER) {
@@ -397,6 +499,9 @@ PROCESS_THREAD(resolv_process, ev, data)
       if(uip_udp_conn->rport == UIP_HTONS(53)) {
 	if(uip_poll()) {
 	  check_entries();
+	  if(etimer_expired(&retry)) {
+	    etimer_set(&retry, CLOCK_SECOND);
+	  }
 	}
 	if(uip_newdata()) {
 	  newdata();
@@ -411,6 +516,10 @@ PROCESS_THREAD(resolv_process, ev, data)
 /**
  * Queues a name so that a question for the name will be sent out.
  *
+ * If the name is already being asked for, no new question is
+ * sent. If the name is in the cache, the resolv_event_found event is
+ * posted at once.
+ *
  * \param name The hostname that is to be queried.
  */
 /*-----------------------------------------------------------------------------------*/
@@ -418,30 +527,53 @@ void
 resolv_query(const char *name)
 {
   static u8_t i;
-  static u8_t lseq, lseqi;
+  static u8_t lseq, lseqi, pseq, pseqi;
   register struct namemap *nameptr;
-      
-  lseq = lseqi = 0;
-  nameptr = 0;                //compiler warning if not initialized
-  
-  for(i = 0; i < RESOLV_ENTRIES; ++i) {
-    nameptr = &names[i];
-    if(nameptr->state == STATE_UNUSED) {
-      break;
+
+  nameptr = find_name(name);
+  if(nameptr != NULL) {
+    if(is_pending(nameptr)) {
+      return;
     }
-    if(seqno - nameptr->seqno > lseq) {
-      lseq = seqno - nameptr->seqno;
-      lseqi = i;
+    if(!is_expired(nameptr)) {
+      nameptr->seqno = seqno++;
+      resolv_found(nameptr->name, nameptr->state == STATE_DONE ?
+                   &nameptr->ipaddr : NULL);
+      return;
+    }
+  } else {
+    /* Use an unused or stale entry if there is one. Otherwise replace
+       the least recently used answer, or, if all entries are waiting
+       for answers, the oldest query. */
+    lseq = lseqi = pseq = pseqi = 0;
+    nameptr = NULL;
+    for(i = 0; i < RESOLV_ENTRIES; ++i) {
+      if(names[i].state == STATE_UNUSED ||
+         (!is_pending(&names[i]) && is_expired(&names[i]))) {
+        nameptr = &names[i];
+        break;
+      }
+      if(is_pending(&names[i])) {
+        if(seqno - names[i].seqno > pseq) {
+          pseq = seqno - names[i].seqno;
+          pseqi = i;
+        }
+      } else if(seqno - names[i].seqno >= lseq) {
+        lseq = seqno - names[i].seqno;
+        lseqi = i + 1;
+      }
     }
-  }
 
-  if(i == RESOLV_ENTRIES) {
-    i = lseqi;
-    nameptr = &names[i];
+    if(nameptr == NULL) {
+      nameptr = lseqi > 0 ? &names[lseqi - 1] : &names[pseqi];
+    }
+
+    strncpy(nameptr->name, name, sizeof(nameptr->name) - 1);
+    nameptr->name[sizeof(nameptr->name) - 1] = 0;
   }
 
-  strncpy(nameptr->name, name, sizeof(nameptr->name));
   nameptr->state = STATE_NEW;
+  nameptr->retries = 0;
   nameptr->seqno = seqno;
   ++seqno;
 
@@ -458,25 +590,22 @@ resolv_query(const char *name)
  * was found. The function resolv_query() can be used to send a query
  * for a hostname.
  *
- * \return A pointer to a 4-byte representation of the hostname's IP
+ * \return A pointer to a representation of the hostname's IP
  * address, or NULL if the hostname was not found in the array of
- * hostnames.
+ * hostnames, or if the time to live of its address has run out.
  */
 /*-----------------------------------------------------------------------------------*/
 uip_ipaddr_t *
 resolv_lookup(const char *name)
 {
-  static u8_t i;
   struct namemap *nameptr;
   
-  /* Walk through the list to see if the name is in there. If it is
-     not, we return NULL. */
-  for(i = 0; i < RESOLV_ENTRIES; ++i) {
-    nameptr = &names[i];
-    if(nameptr->state == STATE_DONE &&
-       strcmp(name, nameptr->name) == 0) {
-      return &nameptr->ipaddr;
-    }
+  nameptr = find_name(name);
+  if(nameptr != NULL &&
+     nameptr->state == STATE_DONE &&
+     !is_expired(nameptr)) {
+    nameptr->seqno = seqno++;
+    return &nameptr->ipaddr;
   }
   return NULL;
 }
@@ -530,7 +659,6 @@ resolv_found(char *name, uip_ipaddr_t *ipaddr)
   process_post(PROCESS_BROADCAST, resolv_event_found, name);
 }
 /*-----------------------------------------------------------------------------------*/
-#endif /* UIP_CONF_IPV6 */
 #endif /* UIP_UDP */
 
 /** @} */
@@ -63,6 +63,7 @@
 #include "net/rime/route-discovery.h"
 #include "net/rime/route.h"
 #include "net/rime/rucb.h"
+#include "net/rime/wrucb.h"
 #include "net/rime/runicast.h"
 #include "net/rime/timesynch.h"
 #include "net/rime/trickle.h"
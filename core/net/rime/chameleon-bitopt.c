@@ -55,6 +55,35 @@
 #define CHAMELEON_WITH_MAC_LINK_ADDRESSES 0
 #endif /* !CHAMELEON_CONF_WITH_MAC_LINK_ADDRESSES */
 
+/* This option enables the compiled header mode. When a channel is
+   opened, its attribute list is compiled into a sequence of
+   precomputed shift/mask operations, one per header byte touched by
+   each attribute, so that packing and unpacking a header does not
+   have to walk the attribute bits one field at a time. The wire
+   format is identical to that of the non-compiled mode. Attribute
+   lists that cannot be compiled (attributes of zero length or lengths
+   above eight bits that are not a multiple of eight) and lists that
+   do not fit in the program table fall back to the generic code. */
+#ifdef CHAMELEON_BITOPT_CONF_COMPILED
+#define CHAMELEON_BITOPT_COMPILED CHAMELEON_BITOPT_CONF_COMPILED
+#else /* CHAMELEON_BITOPT_CONF_COMPILED */
+#define CHAMELEON_BITOPT_COMPILED 0
+#endif /* CHAMELEON_BITOPT_CONF_COMPILED */
+
+/* The number of distinct attribute lists that can be compiled. */
+#ifdef CHAMELEON_BITOPT_CONF_PROGRAMS
+#define CHAMELEON_BITOPT_PROGRAMS CHAMELEON_BITOPT_CONF_PROGRAMS
+#else /* CHAMELEON_BITOPT_CONF_PROGRAMS */
+#define CHAMELEON_BITOPT_PROGRAMS 12
+#endif /* CHAMELEON_BITOPT_CONF_PROGRAMS */
+
+/* The total number of operations shared by all compiled programs. */
+#ifdef CHAMELEON_BITOPT_CONF_OPS
+#define CHAMELEON_BITOPT_OPS CHAMELEON_BITOPT_CONF_OPS
+#else /* CHAMELEON_BITOPT_CONF_OPS */
+#define CHAMELEON_BITOPT_OPS 64
+#endif /* CHAMELEON_BITOPT_CONF_OPS */
+
 struct bitopt_hdr {
   uint8_t channel[2];
 };
@@ -70,6 +99,32 @@ static const uint8_t bitmask[9] = { 0x00, 0x80, 0xc0, 0xe0, 0xf0,
 #define PRINTF(...)
 #endif
 
+#if CHAMELEON_BITOPT_COMPILED
+/* One operation moves one byte of an attribute value into or out of
+   the header. The value byte is shifted left by 'shift' into a 16-bit
+   word that is aligned with header bytes 'hdrbyte' and 'hdrbyte + 1'. A
+   'valbyte' of zero marks the first operation of an attribute. */
+struct bitopt_op {
+  uint8_t type;
+  uint8_t hdrbyte;
+  uint8_t valbyte;
+  uint8_t shift;
+  uint8_t mask;
+};
+
+struct bitopt_program {
+  const struct packetbuf_attrlist *attrlist;
+  uint8_t first_op;
+  uint8_t num_ops;
+};
+
+static struct bitopt_op ops[CHAMELEON_BITOPT_OPS];
+static uint8_t num_ops;
+static struct bitopt_program programs[CHAMELEON_BITOPT_PROGRAMS];
+static uint8_t num_programs;
+static struct bitopt_program *last_program;
+#endif /* CHAMELEON_BITOPT_COMPILED */
+
 /*---------------------------------------------------------------------------*/
 uint8_t CC_INLINE
 get_bits_in_byte(uint8_t *from, int bitpos, int vallen)
@@ -120,11 +175,153 @@ get_bits(uint8_t *to, uint8_t *from, int bitpos, int vallen)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if CHAMELEON_BITOPT_COMPILED
+static struct bitopt_program *
+lookup_program(const struct packetbuf_attrlist *attrlist)
+{
+  int i;
+
+  if(last_program != NULL && last_program->attrlist == attrlist) {
+    return last_program;
+  }
+  for(i = 0; i < num_programs; ++i) {
+    if(programs[i].attrlist == attrlist) {
+      last_program = &programs[i];
+      return last_program;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+compile_program(const struct packetbuf_attrlist *attrlist)
+{
+  const struct packetbuf_attrlist *a;
+  struct bitopt_op *op;
+  int first, bitptr, bitpos, len, maxlen, i;
+
+  if(lookup_program(attrlist) != NULL ||
+     num_programs == CHAMELEON_BITOPT_PROGRAMS) {
+    return;
+  }
+
+  first = num_ops;
+  bitptr = 0;
+  for(a = attrlist; a->type != PACKETBUF_ATTR_NONE; ++a) {
+#if CHAMELEON_WITH_MAC_LINK_ADDRESSES
+    if(a->type == PACKETBUF_ADDR_SENDER ||
+       a->type == PACKETBUF_ADDR_RECEIVER) {
+      continue;
+    }
+#endif /* CHAMELEON_WITH_MAC_LINK_ADDRESSES */
+    len = a->len;
+    maxlen = 8 * (PACKETBUF_IS_ADDR(a->type) ? sizeof(rimeaddr_t) :
+                  sizeof(packetbuf_attr_t));
+    if(len == 0 || len > maxlen || (len > 8 && (len & 7) != 0) ||
+       num_ops + (len < 8 ? 1 : len / 8) > CHAMELEON_BITOPT_OPS ||
+       (bitptr + len) / 8 > 0xff) {
+      PRINTF("chameleon-bitopt: cannot compile attribute list %p\n",
+             attrlist);
+      num_ops = first;
+      return;
+    }
+    bitpos = bitptr & 7;
+    if(len < 8) {
+      op = &ops[num_ops++];
+      op->type = a->type;
+      op->hdrbyte = bitptr / 8;
+      op->valbyte = 0;
+      op->shift = 16 - bitpos - len;
+      op->mask = (1 << len) - 1;
+    } else {
+      for(i = 0; i < len / 8; ++i) {
+        op = &ops[num_ops++];
+        op->type = a->type;
+        op->hdrbyte = bitptr / 8 + i;
+        op->valbyte = i;
+        op->shift = 8 - bitpos;
+        op->mask = 0xff;
+      }
+    }
+    bitptr += len;
+  }
+
+  programs[num_programs].attrlist = attrlist;
+  programs[num_programs].first_op = first;
+  programs[num_programs].num_ops = num_ops - first;
+  ++num_programs;
+}
+/*---------------------------------------------------------------------------*/
+static void
+pack_compiled(const struct bitopt_program *p, uint8_t *hdrptr)
+{
+  const struct bitopt_op *op, *end;
+  const uint8_t *val;
+  packetbuf_attr_t attr;
+  uint16_t w;
+
+  attr = 0;
+  val = (const uint8_t *)&attr;
+  end = &ops[p->first_op + p->num_ops];
+  for(op = &ops[p->first_op]; op < end; ++op) {
+    if(op->valbyte == 0) {
+      if(PACKETBUF_IS_ADDR(op->type)) {
+        val = (const uint8_t *)packetbuf_addr(op->type);
+      } else {
+        attr = packetbuf_attr(op->type);
+        val = (const uint8_t *)&attr;
+      }
+    }
+    w = (uint16_t)(val[op->valbyte] << op->shift);
+    hdrptr[op->hdrbyte] |= w >> 8;
+    if(op->shift < 8) {
+      hdrptr[op->hdrbyte + 1] |= w & 0xff;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+unpack_compiled(const struct bitopt_program *p, const uint8_t *hdrptr)
+{
+  const struct bitopt_op *op, *end;
+  union {
+    rimeaddr_t addr;
+    packetbuf_attr_t attr;
+  } val;
+  uint16_t w;
+
+  end = &ops[p->first_op + p->num_ops];
+  for(op = &ops[p->first_op]; op < end; ++op) {
+    if(op->valbyte == 0) {
+      memset(&val, 0, sizeof(val));
+    }
+    w = hdrptr[op->hdrbyte] << 8;
+    if(op->shift < 8) {
+      w |= hdrptr[op->hdrbyte + 1];
+    }
+    ((uint8_t *)&val)[op->valbyte] = (w >> op->shift) & op->mask;
+    if(op + 1 == end || op[1].valbyte == 0) {
+      if(PACKETBUF_IS_ADDR(op->type)) {
+        packetbuf_set_addr(op->type, &val.addr);
+      } else {
+        packetbuf_set_attr(op->type, val.attr);
+      }
+    }
+  }
+}
+#endif /* CHAMELEON_BITOPT_COMPILED */
+/*---------------------------------------------------------------------------*/
 static int
 header_size(const struct packetbuf_attrlist *a)
 {
   int size, len;
   
+#if CHAMELEON_BITOPT_COMPILED
+  /* This is called when the attributes of a channel are set, so this
+     is where the attribute list gets compiled. */
+  compile_program(a);
+#endif /* CHAMELEON_BITOPT_COMPILED */
+
   /* Compute the total size of the final header by summing the size of
      all attributes that are used on this channel. */
   
@@ -257,6 +454,17 @@ pack_header(struct channel *c)
 
   hdrptr = ((uint8_t *)packetbuf_hdrptr()) + sizeof(struct bitopt_hdr);
   memset(hdrptr, 0, hdrbytesize);
+
+#if CHAMELEON_BITOPT_COMPILED
+  {
+    const struct bitopt_program *p;
+    p = lookup_program(c->attrlist);
+    if(p != NULL) {
+      pack_compiled(p, hdrptr);
+      return 1; /* Send out packet */
+    }
+  }
+#endif /* CHAMELEON_BITOPT_COMPILED */
   
   byteptr = bitptr = 0;
   
@@ -330,6 +538,18 @@ unpack_header(void)
     PRINTF("chameleon-bitopt: too short packet\n");
     return NULL;
   }
+
+#if CHAMELEON_BITOPT_COMPILED
+  {
+    const struct bitopt_program *p;
+    p = lookup_program(c->attrlist);
+    if(p != NULL) {
+      unpack_compiled(p, hdrptr);
+      return c;
+    }
+  }
+#endif /* CHAMELEON_BITOPT_COMPILED */
+
   byteptr = bitptr = 0;
   for(a = c->attrlist; a->type != PACKETBUF_ATTR_NONE; ++a) {
 #if CHAMELEON_WITH_MAC_LINK_ADDRESSES
@@ -59,6 +59,16 @@
 #define MAX_COLLECT_NEIGHBORS 8
 #endif /* COLLECT_NEIGHBOR_CONF_MAX_COLLECT_NEIGHBORS */
 
+#if ADDRMAP_HASHED_LOOKUPS
+#if (COLLECT_NEIGHBOR_HASH_SLOTS & (COLLECT_NEIGHBOR_HASH_SLOTS - 1)) || \
+    COLLECT_NEIGHBOR_HASH_SLOTS > 128
+#error COLLECT_NEIGHBOR_CONF_HASH_SLOTS must be a power of two, not larger than 128
+#endif
+#if COLLECT_NEIGHBOR_HASH_SLOTS <= MAX_COLLECT_NEIGHBORS
+#error COLLECT_NEIGHBOR_CONF_HASH_SLOTS must be larger than the number of neighbors
+#endif
+#endif /* ADDRMAP_HASHED_LOOKUPS */
+
 #define RTMETRIC_MAX COLLECT_MAX_DEPTH
 
 MEMB(collect_neighbors_mem, struct collect_neighbor, MAX_COLLECT_NEIGHBORS);
@@ -98,6 +108,9 @@ periodic(void *ptr)
       n->le_age = 0;
     }
     if(n->age == MAX_AGE) {
+#if ADDRMAP_HASHED_LOOKUPS
+      addrmap_remove(&neighbor_list->hash, n);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
       memb_free(&collect_neighbors_mem, n);
       list_remove(neighbor_list->list, n);
       n = list_head(neighbor_list->list);
@@ -122,6 +135,10 @@ collect_neighbor_list_new(struct collect_neighbor_list *neighbors_list)
 {
   LIST_STRUCT_INIT(neighbors_list, list);
   list_init(neighbors_list->list);
+#if ADDRMAP_HASHED_LOOKUPS
+  ADDRMAP_INIT(&neighbors_list->hash, neighbors_list->hash_slots,
+               struct collect_neighbor, addr);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
   ctimer_set(&neighbors_list->periodic, CLOCK_SECOND, periodic, neighbors_list);
 }
 /*---------------------------------------------------------------------------*/
@@ -129,6 +146,9 @@ struct collect_neighbor *
 collect_neighbor_list_find(struct collect_neighbor_list *neighbors_list,
                            const rimeaddr_t *addr)
 {
+#if ADDRMAP_HASHED_LOOKUPS
+  return addrmap_get(&neighbors_list->hash, addr);
+#else /* ADDRMAP_HASHED_LOOKUPS */
   struct collect_neighbor *n;
   for(n = list_head(neighbors_list->list); n != NULL; n = list_item_next(n)) {
     if(rimeaddr_cmp(&n->addr, addr)) {
@@ -136,6 +156,7 @@ collect_neighbor_list_find(struct collect_neighbor_list *neighbors_list,
     }
   }
   return NULL;
+#endif /* ADDRMAP_HASHED_LOOKUPS */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -152,12 +173,10 @@ collect_neighbor_list_add(struct collect_neighbor_list *neighbors_list,
   PRINTF("collect_neighbor_add: adding %d.%d\n", addr->u8[0], addr->u8[1]);
 
   /* Check if the collect_neighbor is already on the list. */
-  for(n = list_head(neighbors_list->list); n != NULL; n = list_item_next(n)) {
-    if(rimeaddr_cmp(&n->addr, addr)) {
-      PRINTF("collect_neighbor_add: already on list %d.%d\n",
-             addr->u8[0], addr->u8[1]);
-      break;
-    }
+  n = collect_neighbor_list_find(neighbors_list, addr);
+  if(n != NULL) {
+    PRINTF("collect_neighbor_add: already on list %d.%d\n",
+           addr->u8[0], addr->u8[1]);
   }
 
   /* If the collect_neighbor was not on the list, we try to allocate memory
@@ -208,8 +227,22 @@ collect_neighbor_list_add(struct collect_neighbor_list *neighbors_list,
 
   if(n != NULL) {
     n->age = 0;
+#if ADDRMAP_HASHED_LOOKUPS
+    /* A recycled neighbor changes its address, so it must be moved
+       in the address map. */
+    addrmap_remove(&neighbors_list->hash, n);
+    rimeaddr_copy(&n->addr, addr);
+    if(!addrmap_add(&neighbors_list->hash, n)) {
+      /* A neighbor that is not in the map could not be found. */
+      list_remove(neighbors_list->list, n);
+      memb_free(&collect_neighbors_mem, n);
+      return 0;
+    }
+#else /* ADDRMAP_HASHED_LOOKUPS */
     rimeaddr_copy(&n->addr, addr);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
     n->rtmetric = nrtmetric;
+    n->queue_len = 0;
     collect_link_estimate_new(&n->le);
     n->le_age = 0;
     return 1;
@@ -230,6 +263,9 @@ collect_neighbor_list_remove(struct collect_neighbor_list *neighbors_list,
   struct collect_neighbor *n = collect_neighbor_list_find(neighbors_list, addr);
 
   if(n != NULL) {
+#if ADDRMAP_HASHED_LOOKUPS
+    addrmap_remove(&neighbors_list->hash, n);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
     list_remove(neighbors_list->list, n);
     memb_free(&collect_neighbors_mem, n);
   }
@@ -295,6 +331,9 @@ collect_neighbor_list_get(struct collect_neighbor_list *neighbors_list, int num)
 void
 collect_neighbor_list_purge(struct collect_neighbor_list *neighbors_list)
 {
+#if ADDRMAP_HASHED_LOOKUPS
+  addrmap_clear(&neighbors_list->hash);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
   while(list_head(neighbors_list->list) != NULL) {
     memb_free(&collect_neighbors_mem, list_pop(neighbors_list->list));
   }
@@ -55,10 +55,23 @@
 #include "net/rime/rimeaddr.h"
 #include "net/rime/collect-link-estimate.h"
 #include "lib/list.h"
+#include "lib/addrmap.h"
+
+/* The number of address map slots of a neighbor list, which must be
+   a power of two and larger than the maximum number of neighbors. */
+#ifdef COLLECT_NEIGHBOR_CONF_HASH_SLOTS
+#define COLLECT_NEIGHBOR_HASH_SLOTS COLLECT_NEIGHBOR_CONF_HASH_SLOTS
+#else /* COLLECT_NEIGHBOR_CONF_HASH_SLOTS */
+#define COLLECT_NEIGHBOR_HASH_SLOTS 16
+#endif /* COLLECT_NEIGHBOR_CONF_HASH_SLOTS */
 
 struct collect_neighbor_list {
   LIST_STRUCT(list);
   struct ctimer periodic;
+#if ADDRMAP_HASHED_LOOKUPS
+  void *hash_slots[COLLECT_NEIGHBOR_HASH_SLOTS];
+  struct addrmap hash;
+#endif /* ADDRMAP_HASHED_LOOKUPS */
 };
 
 struct collect_neighbor {
@@ -67,6 +80,7 @@ struct collect_neighbor {
   uint16_t rtmetric;
   uint16_t age;
   uint16_t le_age;
+  uint8_t queue_len;
   struct collect_link_estimate le;
   struct timer congested_timer;
 };
@@ -55,6 +55,7 @@
 #include "dev/radio-sensor.h"
 
 #include "lib/random.h"
+#include "lib/addrmap.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -73,15 +74,25 @@ static const struct packetbuf_attrlist attributes[] =
    packets. */
 #define NUM_RECENT_PACKETS 16
 
+/* The originator and the sequence number must be adjacent, since
+   they form the key of the recent_packet_hash address map. */
 struct recent_packet {
-  struct collect_conn *conn;
   rimeaddr_t originator;
   uint8_t eseqno;
+  struct collect_conn *conn;
 };
 
 static struct recent_packet recent_packets[NUM_RECENT_PACKETS];
 static uint8_t recent_packet_ptr;
 
+#if ADDRMAP_HASHED_LOOKUPS
+/* The number of address map slots for the recent packets, which must
+   be a power of two and larger than NUM_RECENT_PACKETS. */
+#define RECENT_PACKET_HASH_SLOTS 32
+static void *recent_packet_hash_slots[RECENT_PACKET_HASH_SLOTS];
+static struct addrmap recent_packet_hash;
+#endif /* ADDRMAP_HASHED_LOOKUPS */
+
 
 /* This is the header of data packets. The header comtains the routing
    metric of the last hop sender. This is used to avoid routing loops:
@@ -101,9 +112,10 @@ struct data_msg_hdr {
    (ACK_FLAGS_RTMETRIC_NEEDS_UPDATE). The flags can contain any
    combination of the flags. The ACK header also contains the routing
    metric of the node that sends tha ACK. This is used to keep an
-   up-to-date routing state in the network. */
+   up-to-date routing state in the network. With load balancing, the
+   ACK also carries the length of the send queue of the node. */
 struct ack_msg {
-  uint8_t flags, dummy;
+  uint8_t flags, queue_len;
   uint16_t rtmetric;
 };
 
@@ -153,6 +165,26 @@ MEMB(send_queue_memb, struct packetqueue_item, MAX_SENDING_QUEUE);
    dropped. */
 #define MAX_HOPLIM                 15
 
+/* Load balancing: instead of sending every data packet to the parent,
+   a node spreads its data packets over all neighbors that are closer
+   to a sink than the node itself and whose rtmetric plus link
+   estimate is within LOAD_BALANCING_THRESHOLD of that of the
+   parent. The neighbors are picked at random, weighted by how empty
+   their send queues were in their latest ACK. Congested neighbors
+   are not picked. With several sinks, this spreads the traffic over
+   the paths to all sinks that are about as good as the best one. */
+#ifdef COLLECT_CONF_LOAD_BALANCING
+#define LOAD_BALANCING COLLECT_CONF_LOAD_BALANCING
+#else /* COLLECT_CONF_LOAD_BALANCING */
+#define LOAD_BALANCING 0
+#endif /* COLLECT_CONF_LOAD_BALANCING */
+
+#ifdef COLLECT_CONF_LOAD_BALANCING_THRESHOLD
+#define LOAD_BALANCING_THRESHOLD COLLECT_CONF_LOAD_BALANCING_THRESHOLD
+#else /* COLLECT_CONF_LOAD_BALANCING_THRESHOLD */
+#define LOAD_BALANCING_THRESHOLD COLLECT_LINK_ESTIMATE_UNIT
+#endif /* COLLECT_CONF_LOAD_BALANCING_THRESHOLD */
+
 
 /* Proactive probing: when there are no packets in the send
    queue, the system periodically sends a dummy packet to potential
@@ -493,6 +525,70 @@ send_packet(struct collect_conn *c, struct collect_neighbor *n)
   unicast_send(&c->unicast_conn, &n->addr);
 }
 /*---------------------------------------------------------------------------*/
+#if LOAD_BALANCING
+/**
+ * This function returns the weight with which a neighbor is picked
+ * as the next hop of a data packet, or zero if the neighbor should
+ * not be used.
+ *
+ */
+static uint16_t
+forwarder_weight(struct collect_conn *c, struct collect_neighbor *n,
+                 uint16_t threshold)
+{
+  /* Only neighbors that are closer to a sink than we are can be used,
+     since anything else could create a routing loop. */
+  if(n->rtmetric >= c->rtmetric ||
+     collect_neighbor_rtmetric_link_estimate(n) > threshold ||
+     collect_neighbor_is_congested(n)) {
+    return 0;
+  }
+  if(n->queue_len >= MAX_SENDING_QUEUE) {
+    return 1;
+  }
+  return 1 + MAX_SENDING_QUEUE - n->queue_len;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function picks the neighbor to which the next data packet is
+ * sent, among the neighbors that are about as good as the parent.
+ *
+ */
+static struct collect_neighbor *
+select_forwarder(struct collect_conn *c)
+{
+  struct collect_neighbor *parent, *n;
+  uint16_t threshold, total, w, r;
+
+  parent = collect_neighbor_list_find(&c->neighbor_list, &c->parent);
+  if(parent == NULL) {
+    return NULL;
+  }
+  threshold = collect_neighbor_rtmetric_link_estimate(parent) +
+    LOAD_BALANCING_THRESHOLD;
+
+  total = 0;
+  for(n = list_head(collect_neighbor_list(&c->neighbor_list));
+      n != NULL; n = list_item_next(n)) {
+    total += forwarder_weight(c, n, threshold);
+  }
+  if(total == 0) {
+    return parent;
+  }
+
+  r = random_rand() % total;
+  for(n = list_head(collect_neighbor_list(&c->neighbor_list));
+      n != NULL; n = list_item_next(n)) {
+    w = forwarder_weight(c, n, threshold);
+    if(r < w) {
+      return n;
+    }
+    r -= w;
+  }
+  return parent;
+}
+#endif /* LOAD_BALANCING */
+/*---------------------------------------------------------------------------*/
 static void
 proactive_probing_callback(void *ptr)
 {
@@ -584,7 +680,17 @@ send_queued_packet(struct collect_conn *c)
 
     /* Pick the neighbor to which to send the packet. We use the
        parent in the n->parent. */
+#if LOAD_BALANCING
+    /* Keepalives and probes are meant for the parent, but data
+       packets may be sent to any neighbor that is about as good. */
+    if(packetbuf_datalen() > sizeof(struct data_msg_hdr)) {
+      n = select_forwarder(c);
+    } else {
+      n = collect_neighbor_list_find(&c->neighbor_list, &c->parent);
+    }
+#else /* LOAD_BALANCING */
     n = collect_neighbor_list_find(&c->neighbor_list, &c->parent);
+#endif /* LOAD_BALANCING */
 
     if(n != NULL) {
 
@@ -601,7 +707,7 @@ send_queued_packet(struct collect_conn *c)
       c->sending = 1;
 
       /* Remember the parent that we sent this packet to. */
-      rimeaddr_copy(&c->current_parent, &c->parent);
+      rimeaddr_copy(&c->current_parent, &n->addr);
 
       /* This is the first time we transmit this packet, so set
          transmissions to zero. */
@@ -686,8 +792,18 @@ retransmit_current_packet(struct collect_conn *c)
     /* Pick the neighbor to which to send the packet. If we have found
        a better parent while we were transmitting this packet, we
        chose that neighbor instead. If so, we need to attribute the
-       transmissions we made for the parent to that neighbor. */
+       transmissions we made for the parent to that neighbor.
+
+       With load balancing, the packet may have been sent to a
+       neighbor other than the parent. We keep using that neighbor as
+       long as it is closer to a sink than we are. */
+#if LOAD_BALANCING
+    n = collect_neighbor_list_find(&c->neighbor_list, &c->current_parent);
+    if(!rimeaddr_cmp(&c->current_parent, &c->parent) &&
+       (n == NULL || n->rtmetric >= c->rtmetric)) {
+#else /* LOAD_BALANCING */
     if(!rimeaddr_cmp(&c->current_parent, &c->parent)) {
+#endif /* LOAD_BALANCING */
       /*      struct collect_neighbor *current_neighbor;
       current_neighbor = collect_neighbor_list_find(&c->neighbor_list,
                                                     &c->current_parent);
@@ -797,6 +913,9 @@ handle_ack(struct collect_conn *tc)
                                    packetbuf_addr(PACKETBUF_ADDR_SENDER));
 
     if(n != NULL) {
+#if LOAD_BALANCING
+      n->queue_len = msg->queue_len;
+#endif /* LOAD_BALANCING */
       collect_neighbor_tx(n, tc->transmissions);
       collect_neighbor_update_rtmetric(n, rtmetric);
       update_rtmetric(tc);
@@ -867,6 +986,9 @@ send_ack(struct collect_conn *tc, const rimeaddr_t *to, int flags)
   memset(ack, 0, sizeof(struct ack_msg));
   ack->rtmetric = tc->rtmetric;
   ack->flags = flags;
+#if LOAD_BALANCING
+  ack->queue_len = packetqueue_len(&tc->send_queue);
+#endif /* LOAD_BALANCING */
 
   packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, to);
   packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE, PACKETBUF_ATTR_PACKET_TYPE_ACK);
@@ -893,21 +1015,55 @@ add_packet_to_recent_packets(struct collect_conn *tc)
      zero are keepalive or proactive link estimate probes, so we do
      not record them in our history. */
   if(packetbuf_datalen() > sizeof(struct data_msg_hdr)) {
+#if ADDRMAP_HASHED_LOOKUPS
+    addrmap_remove(&recent_packet_hash, &recent_packets[recent_packet_ptr]);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
     recent_packets[recent_packet_ptr].eseqno =
       packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID);
     rimeaddr_copy(&recent_packets[recent_packet_ptr].originator,
                   packetbuf_addr(PACKETBUF_ADDR_ESENDER));
     recent_packets[recent_packet_ptr].conn = tc;
+#if ADDRMAP_HASHED_LOOKUPS
+    addrmap_add(&recent_packet_hash, &recent_packets[recent_packet_ptr]);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
     recent_packet_ptr = (recent_packet_ptr + 1) % NUM_RECENT_PACKETS;
   }
 }
 /*---------------------------------------------------------------------------*/
+static struct recent_packet *
+find_recent_packet(struct collect_conn *tc)
+{
+#if ADDRMAP_HASHED_LOOKUPS
+  struct recent_packet key, *r;
+
+  rimeaddr_copy(&key.originator, packetbuf_addr(PACKETBUF_ADDR_ESENDER));
+  key.eseqno = packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID);
+  for(r = addrmap_get(&recent_packet_hash, &key.originator); r != NULL;
+      r = addrmap_get_next(&recent_packet_hash, r)) {
+    if(r->conn == tc) {
+      return r;
+    }
+  }
+#else /* ADDRMAP_HASHED_LOOKUPS */
+  int i;
+
+  for(i = 0; i < NUM_RECENT_PACKETS; i++) {
+    if(recent_packets[i].conn == tc &&
+       recent_packets[i].eseqno == packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID) &&
+       rimeaddr_cmp(&recent_packets[i].originator,
+                    packetbuf_addr(PACKETBUF_ADDR_ESENDER))) {
+      return &recent_packets[i];
+    }
+  }
+#endif /* ADDRMAP_HASHED_LOOKUPS */
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 static void
 node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
 {
   struct collect_conn *tc = (struct collect_conn *)
     ((char *)c - offsetof(struct collect_conn, unicast_conn));
-  int i;
   struct data_msg_hdr hdr;
   uint8_t ackflags = 0;
   struct collect_neighbor *n;
@@ -950,23 +1106,19 @@ node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
       ackflags |= ACK_FLAGS_CONGESTED;
     }
 
-    for(i = 0; i < NUM_RECENT_PACKETS; i++) {
-      if(recent_packets[i].conn == tc &&
-         recent_packets[i].eseqno == packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID) &&
-         rimeaddr_cmp(&recent_packets[i].originator,
-                      packetbuf_addr(PACKETBUF_ADDR_ESENDER))) {
-        /* This is a duplicate of a packet we recently received, so we
-           just send an ACK. */
-        PRINTF("%d.%d: found duplicate packet from %d.%d with seqno %d, via %d.%d\n",
-               rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
-               recent_packets[i].originator.u8[0], recent_packets[i].originator.u8[1],
-               packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
-               packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
-               packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1]);
-        send_ack(tc, &ack_to, ackflags);
-        stats.duprecv++;
-        return;
-      }
+    if(find_recent_packet(tc) != NULL) {
+      /* This is a duplicate of a packet we recently received, so we
+         just send an ACK. */
+      PRINTF("%d.%d: found duplicate packet from %d.%d with seqno %d, via %d.%d\n",
+             rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+             packetbuf_addr(PACKETBUF_ADDR_ESENDER)->u8[0],
+             packetbuf_addr(PACKETBUF_ADDR_ESENDER)->u8[1],
+             packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
+             packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
+             packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1]);
+      send_ack(tc, &ack_to, ackflags);
+      stats.duprecv++;
+      return;
     }
 
     /* If we are the sink, the packet has reached its final
@@ -1287,6 +1439,18 @@ collect_open(struct collect_conn *tc, uint16_t channels,
   tc->send_queue.list = &(tc->send_queue_list);
   tc->send_queue.memb = &send_queue_memb;
   collect_neighbor_init();
+#if ADDRMAP_HASHED_LOOKUPS
+  {
+    static uint8_t initialized = 0;
+    if(initialized == 0) {
+      initialized = 1;
+      addrmap_init(&recent_packet_hash, recent_packet_hash_slots,
+                   RECENT_PACKET_HASH_SLOTS,
+                   offsetof(struct recent_packet, originator),
+                   sizeof(rimeaddr_t) + sizeof(uint8_t));
+    }
+  }
+#endif /* ADDRMAP_HASHED_LOOKUPS */
 
 #if !COLLECT_ANNOUNCEMENTS
   neighbor_discovery_open(&tc->neighbor_discovery_conn, channels,
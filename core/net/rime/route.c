@@ -47,6 +47,7 @@
 
 #include "lib/list.h"
 #include "lib/memb.h"
+#include "lib/addrmap.h"
 #include "sys/ctimer.h"
 #include "net/rime/route.h"
 #include "contiki-conf.h"
@@ -69,12 +70,37 @@
 #define DEFAULT_LIFETIME 60
 #endif /* ROUTE_CONF_DEFAULT_LIFETIME */
 
+/* The number of address map slots, which must be a power of two and
+   larger than the number of route entries. */
+#ifdef ROUTE_CONF_HASH_SLOTS
+#define HASH_SLOTS ROUTE_CONF_HASH_SLOTS
+#else /* ROUTE_CONF_HASH_SLOTS */
+#define HASH_SLOTS 16
+#endif /* ROUTE_CONF_HASH_SLOTS */
+
+#if ADDRMAP_HASHED_LOOKUPS
+#if (HASH_SLOTS & (HASH_SLOTS - 1)) || HASH_SLOTS > 128
+#error ROUTE_CONF_HASH_SLOTS must be a power of two, not larger than 128
+#endif
+#if HASH_SLOTS <= NUM_RT_ENTRIES
+#error ROUTE_CONF_HASH_SLOTS must be larger than the number of route entries
+#endif
+#endif /* ADDRMAP_HASHED_LOOKUPS */
+
 /*
  * List of route entries.
  */
 LIST(route_table);
 MEMB(route_mem, struct route_entry, NUM_RT_ENTRIES);
 
+#if ADDRMAP_HASHED_LOOKUPS
+/*
+ * Route entries indexed by destination.
+ */
+static void *route_hash_slots[HASH_SLOTS];
+static struct addrmap route_hash;
+#endif /* ADDRMAP_HASHED_LOOKUPS */
+
 static struct ctimer t;
 
 static int max_time = DEFAULT_LIFETIME;
@@ -101,8 +127,7 @@ periodic(void *ptr)
 	     e->dest.u8[0], e->dest.u8[1],
 	     e->nexthop.u8[0], e->nexthop.u8[1],
 	     e->cost);
-      list_remove(route_table, e);
-      memb_free(&route_mem, e);
+      route_remove(e);
     }
   }
 
@@ -114,6 +139,9 @@ route_init(void)
 {
   list_init(route_table);
   memb_init(&route_mem);
+#if ADDRMAP_HASHED_LOOKUPS
+  ADDRMAP_INIT(&route_hash, route_hash_slots, struct route_entry, dest);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
 
   ctimer_set(&t, CLOCK_SECOND, periodic, NULL);
 }
@@ -141,7 +169,19 @@ route_add(const rimeaddr_t *dest, const rimeaddr_t *nexthop,
     }
   }
 
+#if ADDRMAP_HASHED_LOOKUPS
+  /* A reused entry may change its destination, so it must be moved in
+     the address map. */
+  addrmap_remove(&route_hash, e);
+  rimeaddr_copy(&e->dest, dest);
+  if(!addrmap_add(&route_hash, e)) {
+    /* An entry that is not in the map could not be found. */
+    memb_free(&route_mem, e);
+    return -1;
+  }
+#else /* ADDRMAP_HASHED_LOOKUPS */
   rimeaddr_copy(&e->dest, dest);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
   rimeaddr_copy(&e->nexthop, nexthop);
   e->cost = cost;
   e->seqno = seqno;
@@ -170,6 +210,15 @@ route_lookup(const rimeaddr_t *dest)
   best_entry = NULL;
   
   /* Find the route with the lowest cost. */
+#if ADDRMAP_HASHED_LOOKUPS
+  for(e = addrmap_get(&route_hash, dest); e != NULL;
+      e = addrmap_get_next(&route_hash, e)) {
+    if(e->cost < lowest_cost) {
+      best_entry = e;
+      lowest_cost = e->cost;
+    }
+  }
+#else /* ADDRMAP_HASHED_LOOKUPS */
   for(e = list_head(route_table); e != NULL; e = list_item_next(e)) {
     /*    printf("route_lookup: comparing %d.%d.%d.%d with %d.%d.%d.%d\n",
 	   uip_ipaddr_to_quad(dest), uip_ipaddr_to_quad(&e->dest));*/
@@ -181,6 +230,7 @@ route_lookup(const rimeaddr_t *dest)
       }
     }
   }
+#endif /* ADDRMAP_HASHED_LOOKUPS */
   return best_entry;
 }
 /*---------------------------------------------------------------------------*/
@@ -232,6 +282,9 @@ route_decay(struct route_entry *e)
 void
 route_remove(struct route_entry *e)
 {
+#if ADDRMAP_HASHED_LOOKUPS
+  addrmap_remove(&route_hash, e);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
   list_remove(route_table, e);
   memb_free(&route_mem, e);
 }
@@ -241,6 +294,9 @@ route_flush_all(void)
 {
   struct route_entry *e;
 
+#if ADDRMAP_HASHED_LOOKUPS
+  addrmap_clear(&route_hash);
+#endif /* ADDRMAP_HASHED_LOOKUPS */
   while(1) {
     e = list_pop(route_table);
     if(e != NULL) {
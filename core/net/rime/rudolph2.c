@@ -62,6 +62,25 @@
 #define RESEND_INTERVAL SEND_INTERVAL * 4
 #define NACK_TIMEOUT CLOCK_SECOND / 4
 
+/* In pipelined mode, a node starts forwarding a file as soon as it
+   has received the first page of it, instead of waiting for the
+   entire file. Pages thus flow through several hops concurrently. */
+#ifdef RUDOLPH2_CONF_PIPELINING
+#define PIPELINING RUDOLPH2_CONF_PIPELINING
+#else /* RUDOLPH2_CONF_PIPELINING */
+#define PIPELINING 0
+#endif /* RUDOLPH2_CONF_PIPELINING */
+
+#ifdef RUDOLPH2_CONF_PAGE_CHUNKS
+#define PAGE_CHUNKS RUDOLPH2_CONF_PAGE_CHUNKS
+#else /* RUDOLPH2_CONF_PAGE_CHUNKS */
+#define PAGE_CHUNKS 8
+#endif /* RUDOLPH2_CONF_PAGE_CHUNKS */
+
+/* A NACK sent or overheard for a page suppresses further NACKs for
+   the same page for roughly the time it takes to send the page. */
+#define NACK_SUPPRESS_TIME (PAGE_CHUNKS * SEND_INTERVAL)
+
 struct rudolph2_hdr {
   uint8_t type;
   uint8_t hops_from_base;
@@ -69,7 +88,14 @@ struct rudolph2_hdr {
   uint16_t chunk;
 };
 
+#if PIPELINING
+/* Only suppress our own packets when someone else sends the exact
+   same packet, so that forwarding is not suppressed by the data
+   sent by the node upstream of us. */
+#define POLITE_HEADER sizeof(struct rudolph2_hdr)
+#else /* PIPELINING */
 #define POLITE_HEADER 1
+#endif /* PIPELINING */
 
 #define HOPS_MAX 64
 
@@ -81,6 +107,7 @@ enum {
 #define FLAG_LAST_SENT     0x01
 #define FLAG_LAST_RECEIVED 0x02
 #define FLAG_IS_STOPPED    0x04
+#define FLAG_FORWARDING    0x08
 
 #define DEBUG 0
 #if DEBUG
@@ -92,6 +119,8 @@ enum {
 
 #define LT(a, b) ((signed short)((a) - (b)) < 0)
 
+#define PAGE(chunk) ((chunk) / PAGE_CHUNKS)
+
 /*---------------------------------------------------------------------------*/
 static int
 read_data(struct rudolph2_conn *c, uint8_t *dataptr, int chunk)
@@ -170,6 +199,23 @@ static void
 send_nack(struct rudolph2_conn *c)
 {
   struct rudolph2_hdr *hdr;
+
+#if PIPELINING
+  /* If a NACK was recently sent, by us or by a neighbor, for an
+     earlier chunk in the same page, the repair will cover our chunk
+     as well so we do not need to send another NACK. */
+  if(PAGE(c->nack_chunk) == PAGE(c->rcv_nxt) &&
+     c->nack_chunk <= c->rcv_nxt &&
+     clock_time() - c->nack_time < NACK_SUPPRESS_TIME) {
+    PRINTF("%d.%d: suppressing nack for %d\n",
+	   rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+	   c->rcv_nxt);
+    return;
+  }
+  c->nack_chunk = c->rcv_nxt;
+  c->nack_time = clock_time();
+#endif /* PIPELINING */
+
   packetbuf_clear();
   packetbuf_hdralloc(sizeof(struct rudolph2_hdr));
   hdr = packetbuf_hdrptr();
@@ -245,15 +291,39 @@ dropped(struct polite_conn *polite)
     }*/
 }
 /*---------------------------------------------------------------------------*/
+#if PIPELINING
+static uint16_t
+send_limit(struct rudolph2_conn *c)
+{
+  /* We forward all received chunks once the entire file has been
+     received, but only complete pages before that. */
+  if(c->flags & FLAG_LAST_RECEIVED) {
+    return c->rcv_nxt;
+  }
+  return PAGE(c->rcv_nxt) * PAGE_CHUNKS;
+}
+#endif /* PIPELINING */
+/*---------------------------------------------------------------------------*/
 static void
 timed_send(void *ptr)
 {
   struct rudolph2_conn *c = (struct rudolph2_conn *)ptr;
   clock_time_t interval;
   int len;
-  
+
+#if PIPELINING
+  if((c->flags & FLAG_LAST_RECEIVED) == 0 &&
+     c->snd_nxt >= send_limit(c)) {
+    /* We have sent all complete pages, so we wait for the next page
+       to be received before we continue. */
+    c->flags &= ~FLAG_FORWARDING;
+    return;
+  }
+  if((c->flags & FLAG_IS_STOPPED) == 0) {
+#else /* PIPELINING */
   if((c->flags & FLAG_IS_STOPPED) == 0 &&
      (c->flags & FLAG_LAST_RECEIVED)) {
+#endif /* PIPELINING */
     /*    if(c->snd_nxt + 1 < c->rcv_nxt) {
       interval = SEND_INTERVAL;
     } else {
@@ -278,7 +348,8 @@ timed_send(void *ptr)
     
     if(c->nacks == 0 &&
        len == RUDOLPH2_DATASIZE &&
-     c->snd_nxt + 1 < c->rcv_nxt) {
+       (c->snd_nxt + 1 < c->rcv_nxt ||
+	(c->flags & FLAG_LAST_RECEIVED) == 0)) {
       c->snd_nxt++;
     }
     c->nacks = 0;
@@ -286,6 +357,17 @@ timed_send(void *ptr)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if PIPELINING
+static void
+start_forwarding(struct rudolph2_conn *c)
+{
+  if((c->flags & FLAG_FORWARDING) == 0) {
+    c->flags |= FLAG_FORWARDING;
+    ctimer_set(&c->t, SEND_INTERVAL, timed_send, c);
+  }
+}
+#endif /* PIPELINING */
+/*---------------------------------------------------------------------------*/
 static void
 recv(struct polite_conn *polite)
 {
@@ -302,14 +384,45 @@ recv(struct polite_conn *polite)
 	   hdr->version, hdr->chunk,
 	   c->version, c->rcv_nxt);
     if(hdr->version == c->version) {
+#if PIPELINING
+      /* If we already are sending the requested page and have not
+	 yet passed the requested chunk, the NACK is answered by the
+	 packets we are about to send anyway. */
+      if(hdr->chunk < c->rcv_nxt &&
+	 ((c->flags & FLAG_FORWARDING) == 0 ||
+	  (c->flags & FLAG_LAST_SENT) ||
+	  PAGE(hdr->chunk) != PAGE(c->snd_nxt) ||
+	  hdr->chunk < c->snd_nxt)) {
+	c->snd_nxt = hdr->chunk;
+	send_data(c, SEND_INTERVAL);
+	if((c->flags & FLAG_LAST_RECEIVED) == 0) {
+	  start_forwarding(c);
+	}
+      }
+#else /* PIPELINING */
       if(hdr->chunk < c->rcv_nxt) {
 	c->snd_nxt = hdr->chunk;
 	send_data(c, SEND_INTERVAL);
       }
+#endif /* PIPELINING */
     } else if(LT(hdr->version, c->version)) {
       c->snd_nxt = 0;
       send_data(c, SEND_INTERVAL);
     }
+#if PIPELINING
+  } else if(hdr->type == TYPE_NACK &&
+	    hdr->hops_from_base == c->hops_from_base &&
+	    hdr->version == c->version) {
+    /* A neighbor at the same distance from the base as us requested
+       a chunk. Remember it so that we can suppress our own request
+       if it is for the same page. */
+    if(PAGE(hdr->chunk) != PAGE(c->nack_chunk) ||
+       hdr->chunk < c->nack_chunk ||
+       clock_time() - c->nack_time >= NACK_SUPPRESS_TIME) {
+      c->nack_chunk = hdr->chunk;
+      c->nack_time = clock_time();
+    }
+#endif /* PIPELINING */
   } else if(hdr->type == TYPE_DATA) {
     if(hdr->hops_from_base < c->hops_from_base) {
       /* Only accept data from nodes that are closer to the base than
@@ -323,6 +436,14 @@ recv(struct polite_conn *polite)
 	c->snd_nxt = c->rcv_nxt = 0;
 	c->flags &= ~FLAG_LAST_RECEIVED;
 	c->flags &= ~FLAG_LAST_SENT;
+	c->start_time = clock_time();
+	c->first_page_time = c->done_time = 0;
+	c->pages = 0;
+#if PIPELINING
+	c->flags &= ~FLAG_FORWARDING;
+	ctimer_stop(&c->t);
+	c->nack_time = c->start_time - NACK_SUPPRESS_TIME;
+#endif /* PIPELINING */
 	if(hdr->chunk != 0) {
 	  send_nack(c);
 	} else {
@@ -341,12 +462,32 @@ recv(struct polite_conn *polite)
 		 rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
 		 hdr->chunk, packetbuf_totlen());
 	  len = packetbuf_totlen();
+	  /* Update the statistics before the chunk is handed to the
+	     application, so that they are complete when it is told
+	     that the last chunk has arrived. */
+	  if(len < RUDOLPH2_DATASIZE || (c->rcv_nxt + 1) % PAGE_CHUNKS == 0) {
+	    if(c->pages == 0) {
+	      c->first_page_time = clock_time() - c->start_time;
+	    }
+	    c->pages++;
+	  }
+	  if(len < RUDOLPH2_DATASIZE) {
+	    c->done_time = clock_time() - c->start_time;
+	  }
 	  write_data(c, hdr->chunk, packetbuf_dataptr(), packetbuf_totlen());
 	  c->rcv_nxt++;
 	  if(len < RUDOLPH2_DATASIZE) {
 	    c->flags |= FLAG_LAST_RECEIVED;
 	    send_data(c, RESEND_INTERVAL);
 	    ctimer_set(&c->t, RESEND_INTERVAL, timed_send, c);
+#if PIPELINING
+	    c->flags |= FLAG_FORWARDING;
+	  } else if(c->rcv_nxt % PAGE_CHUNKS == 0) {
+	    PRINTF("%d.%d: received page %d\n",
+		   rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+		   c->pages - 1);
+	    start_forwarding(c);
+#endif /* PIPELINING */
 	  }
 	} else if(hdr->chunk > c->rcv_nxt) {
 	  PRINTF("%d.%d: received chunk %d > %d, sending NACK\n",
@@ -371,6 +512,10 @@ rudolph2_open(struct rudolph2_conn *c, uint16_t channel,
   c->cb = cb;
   c->version = 0;
   c->hops_from_base = HOPS_MAX;
+  c->start_time = c->first_page_time = c->done_time = 0;
+  c->pages = 0;
+  c->nack_chunk = 0;
+  c->nack_time = clock_time() - NACK_SUPPRESS_TIME;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -393,6 +538,9 @@ rudolph2_send(struct rudolph2_conn *c, clock_time_t send_interval)
     len = read_data(c, packetbuf_dataptr(), c->rcv_nxt);
   }
   c->flags = FLAG_LAST_RECEIVED;
+  c->start_time = clock_time();
+  c->first_page_time = c->done_time = 0;
+  c->pages = (c->rcv_nxt + PAGE_CHUNKS - 1) / PAGE_CHUNKS;
   /*  printf("Highest chunk %d\n", c->rcv_nxt);*/
   send_data(c, SEND_INTERVAL);
   ctimer_set(&c->t, SEND_INTERVAL, timed_send, c);
@@ -405,4 +553,13 @@ rudolph2_stop(struct rudolph2_conn *c)
   c->flags |= FLAG_IS_STOPPED;
 }
 /*---------------------------------------------------------------------------*/
+void
+rudolph2_print_stats(struct rudolph2_conn *c)
+{
+  printf("rudolph2 stats version %u hops %u pages %u first page %lu done %lu\n",
+	 c->version, c->hops_from_base, c->pages,
+	 (unsigned long)c->first_page_time,
+	 (unsigned long)c->done_time);
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
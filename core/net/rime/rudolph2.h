@@ -89,6 +89,15 @@ struct rudolph2_conn {
   uint8_t hops_from_base;
   uint8_t nacks;
   uint8_t flags;
+
+  /* Pipelined mode: the lowest chunk that a NACK was recently sent
+     or overheard for, used to suppress duplicate page requests. */
+  uint16_t nack_chunk;
+  clock_time_t nack_time;
+
+  /* Per-hop completion statistics for the current version. */
+  clock_time_t start_time, first_page_time, done_time;
+  uint16_t pages;
 };
 
 void rudolph2_open(struct rudolph2_conn *c, uint16_t channel,
@@ -100,6 +109,19 @@ void rudolph2_stop(struct rudolph2_conn *c);
 void rudolph2_set_version(struct rudolph2_conn *c, int version);
 int rudolph2_version(struct rudolph2_conn *c);
 
+/**
+ * \brief      Print the completion time statistics for a connection
+ * \param c    A pointer to a struct rudolph2_conn
+ *
+ *             This function prints the number of hops to the base,
+ *             the number of pages received, and the time it took
+ *             from the first data packet of the current version was
+ *             heard until the first page and the entire file were
+ *             received. Collecting the output from all nodes gives
+ *             the completion time per hop.
+ */
+void rudolph2_print_stats(struct rudolph2_conn *c);
+
 #endif /* __RUDOLPH2_H__ */
 /** @} */
 /** @} */
@@ -52,6 +52,7 @@
 #if TIMESYNCH_CONF_ENABLED
 static int authority_level;
 static rtimer_clock_t offset;
+static uint8_t synchronized;
 
 #define TIMESYNCH_CHANNEL  7
 
@@ -97,6 +98,12 @@ timesynch_set_authority_level(int level)
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+timesynch_is_synchronized(void)
+{
+  return synchronized || authority_level == 0;
+}
+/*---------------------------------------------------------------------------*/
 rtimer_clock_t
 timesynch_time(void)
 {
@@ -125,6 +132,7 @@ static void
 adjust_offset(rtimer_clock_t authoritative_time, rtimer_clock_t local_time)
 {
   offset = authoritative_time - local_time;
+  synchronized = 1;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -139,6 +139,18 @@ rtimer_clock_t timesynch_offset(void);
  */
 int timesynch_authority_level(void);
 
+/**
+ * \brief      Check if the time has been synchronized
+ * \return     Non-zero if the time is synchronized, zero otherwise
+ *
+ *             This function returns non-zero if this node has
+ *             synchronized its time to a node with a better authority
+ *             level, or if it has authority level 0 and therefore is
+ *             the source of the time.
+ *
+ */
+int timesynch_is_synchronized(void);
+
 /**
  * \brief      Set the authority level of the current time
  * \param level The authority level
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Windowed reliable unicast bulk transfer
+ *
+ *         Unlike rucb, which sends one chunk at a time and waits for
+ *         the ACK of each chunk, wrucb sends a window of chunks
+ *         before waiting for an ACK. The last chunk of a window asks
+ *         the receiver for an ACK, which holds the number of the
+ *         first missing chunk and a bitmap of the chunks received
+ *         after it. The sender then only resends the missing chunks
+ *         and moves the window forward. Chunks are read from and
+ *         written to the application by offset, so neither side needs
+ *         to buffer the window, except the receiver that holds on to
+ *         the last chunk until all chunks before it have arrived.
+ */
+
+#include "net/rime/wrucb.h"
+#include "net/rime.h"
+#include "lib/random.h"
+#include <string.h>
+
+/* The number of windows in a row that may go without an ACK before
+   the transfer is given up. */
+#define MAX_TRANSMISSIONS 8
+
+#ifdef WRUCB_CONF_REXMIT_TIME
+#define REXMIT_TIME WRUCB_CONF_REXMIT_TIME
+#else /* WRUCB_CONF_REXMIT_TIME */
+#define REXMIT_TIME CLOCK_SECOND
+#endif /* WRUCB_CONF_REXMIT_TIME */
+
+struct wrucb_hdr {
+  uint8_t type, flags;
+  uint8_t id, dummy;
+  uint16_t chunk;
+  uint16_t bitmap;
+};
+
+#define TYPE_DATA 0
+#define TYPE_ACK  1
+
+#define FLAG_POLL 0x01
+#define FLAG_LAST 0x02
+
+enum {
+  STATE_IDLE,
+  STATE_SENDING,
+  STATE_WAITING,
+  STATE_RECEIVING,
+  STATE_RECEIVED,
+};
+
+#define UNKNOWN_CHUNK 0xffff
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+static void send_next(void *ptr);
+/*---------------------------------------------------------------------------*/
+static int
+is_acked(struct wrucb_conn *c, uint16_t chunk)
+{
+  return chunk < c->base ||
+    (chunk - c->base < WRUCB_MAX_WINDOW &&
+     (c->bitmap & (1U << (chunk - c->base))) != 0);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+window_end(struct wrucb_conn *c)
+{
+  if(c->last != UNKNOWN_CHUNK && c->last < c->base + c->window) {
+    return c->last + 1;
+  }
+  return c->base + c->window;
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_window(struct wrucb_conn *c)
+{
+  c->state = STATE_SENDING;
+  c->next = c->base;
+  send_next(c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rexmit(void *ptr)
+{
+  struct wrucb_conn *c = ptr;
+
+  c->transmissions++;
+  PRINTF("%d.%d: wrucb: no ACK for chunk %d, transmission %d\n",
+         rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         c->base, c->transmissions);
+  if(c->transmissions >= MAX_TRANSMISSIONS) {
+    c->state = STATE_IDLE;
+    if(c->u->timedout) {
+      c->u->timedout(c);
+    }
+    return;
+  }
+  start_window(c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_next(void *ptr)
+{
+  struct wrucb_conn *c = ptr;
+  struct wrucb_hdr hdr;
+  uint16_t end, n;
+  int len;
+
+  if(c->state != STATE_SENDING) {
+    return;
+  }
+
+  /* Find the next chunk in the window that has not been acked. */
+  end = window_end(c);
+  while(c->next < end && is_acked(c, c->next)) {
+    c->next++;
+  }
+  if(c->next >= end) {
+    /* The whole window has been sent, so we wait for the ACK. */
+    c->state = STATE_WAITING;
+    ctimer_set(&c->t, REXMIT_TIME, rexmit, c);
+    return;
+  }
+
+  packetbuf_clear();
+  len = 0;
+  if(c->u->read_chunk) {
+    len = c->u->read_chunk(c, c->next * WRUCB_DATASIZE,
+                           (char *)packetbuf_dataptr() + sizeof(hdr),
+                           WRUCB_DATASIZE);
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.type = TYPE_DATA;
+  hdr.id = c->id;
+  hdr.chunk = c->next;
+  if(len < WRUCB_DATASIZE) {
+    hdr.flags |= FLAG_LAST;
+    c->last = c->next;
+    end = c->next + 1;
+  }
+  c->next++;
+
+  /* Ask for an ACK if this is the last chunk of the window that needs
+     to be sent. */
+  for(n = c->next; n < end && is_acked(c, n); n++);
+  if(n >= end) {
+    hdr.flags |= FLAG_POLL;
+  }
+
+  memcpy(packetbuf_dataptr(), &hdr, sizeof(hdr));
+  packetbuf_set_datalen(sizeof(hdr) + len);
+
+  PRINTF("%d.%d: wrucb: sending chunk %d len %d flags %02x\n",
+         rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         hdr.chunk, len, hdr.flags);
+
+  /* The sent callback schedules the next chunk. The timer catches the
+     case where the MAC layer never calls us back. */
+  ctimer_set(&c->t, REXMIT_TIME, rexmit, c);
+  unicast_send(&c->c, &c->receiver);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_ack(struct wrucb_conn *c, const rimeaddr_t *to)
+{
+  struct wrucb_hdr hdr;
+
+  packetbuf_clear();
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.type = TYPE_ACK;
+  hdr.id = c->id;
+  hdr.chunk = c->base;
+  hdr.bitmap = c->bitmap;
+  memcpy(packetbuf_dataptr(), &hdr, sizeof(hdr));
+  packetbuf_set_datalen(sizeof(hdr));
+
+  PRINTF("%d.%d: wrucb: ACK to %d.%d base %d bitmap %04x\n",
+         rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         to->u8[0], to->u8[1], c->base, c->bitmap);
+
+  unicast_send(&c->c, to);
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_ack(struct wrucb_conn *c, const rimeaddr_t *from, struct wrucb_hdr *hdr)
+{
+  if((c->state != STATE_SENDING && c->state != STATE_WAITING) ||
+     !rimeaddr_cmp(from, &c->receiver) || hdr->id != c->id ||
+     hdr->chunk < c->base) {
+    return;
+  }
+
+  /* The receiver is still there, so we start counting the windows
+     without an ACK from zero. */
+  c->transmissions = 0;
+  c->base = hdr->chunk;
+  c->bitmap = hdr->bitmap;
+
+  if(c->last != UNKNOWN_CHUNK && c->base > c->last) {
+    PRINTF("%d.%d: wrucb: transfer complete\n",
+           rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1]);
+    ctimer_stop(&c->t);
+    c->state = STATE_IDLE;
+    return;
+  }
+
+  if(c->state == STATE_WAITING) {
+    ctimer_stop(&c->t);
+    start_window(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_data(struct wrucb_conn *c, const rimeaddr_t *from, struct wrucb_hdr *hdr)
+{
+  char *data;
+  int len;
+  uint16_t bit;
+
+  if(c->state == STATE_RECEIVED && rimeaddr_cmp(from, &c->sender) &&
+     hdr->id == c->id) {
+    /* The sender did not get our final ACK. */
+    if(hdr->flags & FLAG_POLL) {
+      send_ack(c, from);
+    }
+    return;
+  }
+
+  if(c->state == STATE_IDLE || c->state == STATE_RECEIVED ||
+     (c->state == STATE_RECEIVING && rimeaddr_cmp(from, &c->sender) &&
+      hdr->id != c->id)) {
+    c->state = STATE_RECEIVING;
+    rimeaddr_copy(&c->sender, from);
+    c->id = hdr->id;
+    c->base = 0;
+    c->bitmap = 0;
+    c->last = UNKNOWN_CHUNK;
+    c->u->write_chunk(c, 0, WRUCB_FLAG_NEWFILE, packetbuf_dataptr(), 0);
+  }
+
+  if(c->state != STATE_RECEIVING || !rimeaddr_cmp(from, &c->sender)) {
+    return;
+  }
+
+  data = (char *)packetbuf_dataptr() + sizeof(struct wrucb_hdr);
+  len = packetbuf_datalen() - sizeof(struct wrucb_hdr);
+
+  if(hdr->chunk >= c->base && hdr->chunk - c->base < WRUCB_MAX_WINDOW) {
+    bit = 1U << (hdr->chunk - c->base);
+    if((c->bitmap & bit) == 0) {
+      PRINTF("%d.%d: wrucb: got chunk %d len %d\n",
+             rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+             hdr->chunk, len);
+      if(hdr->flags & FLAG_LAST) {
+        /* Hold the last chunk until all chunks before it are written. */
+        memcpy(c->last_data, data, len);
+        c->last_len = len;
+        c->last = hdr->chunk;
+      } else {
+        c->u->write_chunk(c, hdr->chunk * WRUCB_DATASIZE,
+                          WRUCB_FLAG_NONE, data, len);
+      }
+      c->bitmap |= bit;
+      while(c->bitmap & 1) {
+        c->bitmap >>= 1;
+        c->base++;
+      }
+      if(c->last != UNKNOWN_CHUNK && c->base > c->last) {
+        PRINTF("%d.%d: wrucb: file complete\n",
+               rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1]);
+        c->u->write_chunk(c, c->last * WRUCB_DATASIZE,
+                          WRUCB_FLAG_LASTCHUNK, c->last_data, c->last_len);
+        c->state = STATE_RECEIVED;
+      }
+    }
+  }
+
+  if(hdr->flags & FLAG_POLL) {
+    send_ack(c, from);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv(struct unicast_conn *uc, const rimeaddr_t *from)
+{
+  struct wrucb_conn *c = (struct wrucb_conn *)uc;
+  struct wrucb_hdr hdr;
+
+  if(packetbuf_datalen() < sizeof(struct wrucb_hdr) ||
+     packetbuf_datalen() > sizeof(struct wrucb_hdr) + WRUCB_DATASIZE) {
+    return;
+  }
+  memcpy(&hdr, packetbuf_dataptr(), sizeof(hdr));
+
+  if(hdr.type == TYPE_ACK) {
+    recv_ack(c, from, &hdr);
+  } else if(hdr.type == TYPE_DATA) {
+    recv_data(c, from, &hdr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sent(struct unicast_conn *uc, int status, int num_tx)
+{
+  struct wrucb_conn *c = (struct wrucb_conn *)uc;
+
+  if(c->state == STATE_SENDING) {
+    ctimer_set(&c->t, c->pacing, send_next, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct unicast_callbacks wrucb = {recv, sent};
+/*---------------------------------------------------------------------------*/
+void
+wrucb_open(struct wrucb_conn *c, uint16_t channel,
+	   const struct wrucb_callbacks *u)
+{
+  rimeaddr_copy(&c->sender, &rimeaddr_null);
+  unicast_open(&c->c, channel, &wrucb);
+  c->u = u;
+  c->state = STATE_IDLE;
+  c->id = random_rand();
+  wrucb_set_window(c, WRUCB_WINDOW, WRUCB_PACING);
+}
+/*---------------------------------------------------------------------------*/
+void
+wrucb_close(struct wrucb_conn *c)
+{
+  ctimer_stop(&c->t);
+  unicast_close(&c->c);
+}
+/*---------------------------------------------------------------------------*/
+void
+wrucb_set_window(struct wrucb_conn *c, uint8_t window, clock_time_t pacing)
+{
+  if(window < 1) {
+    window = 1;
+  } else if(window > WRUCB_MAX_WINDOW) {
+    window = WRUCB_MAX_WINDOW;
+  }
+  c->window = window;
+  c->pacing = pacing;
+}
+/*---------------------------------------------------------------------------*/
+int
+wrucb_send(struct wrucb_conn *c, const rimeaddr_t *receiver)
+{
+  rimeaddr_copy(&c->receiver, receiver);
+  c->id++;
+  c->base = 0;
+  c->bitmap = 0;
+  c->last = UNKNOWN_CHUNK;
+  c->transmissions = 0;
+  start_window(c);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
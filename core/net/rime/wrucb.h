@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the windowed reliable unicast bulk transfer module
+ */
+
+#ifndef __WRUCB_H__
+#define __WRUCB_H__
+
+#include "net/rime/unicast.h"
+#include "sys/ctimer.h"
+
+struct wrucb_conn;
+
+enum {
+  WRUCB_FLAG_NONE,
+  WRUCB_FLAG_NEWFILE,
+  WRUCB_FLAG_LASTCHUNK,
+};
+
+struct wrucb_callbacks {
+  void (* write_chunk)(struct wrucb_conn *c, int offset, int flag,
+		       char *data, int len);
+  int (* read_chunk)(struct wrucb_conn *c, int offset, char *to,
+		     int maxsize);
+  void (* timedout)(struct wrucb_conn *c);
+};
+
+#define WRUCB_DATASIZE 64
+
+/* The maximum number of chunks in flight, which is also the size of
+   the selective ACK bitmap. */
+#define WRUCB_MAX_WINDOW 16
+
+#ifdef WRUCB_CONF_WINDOW
+#define WRUCB_WINDOW WRUCB_CONF_WINDOW
+#else /* WRUCB_CONF_WINDOW */
+#define WRUCB_WINDOW 8
+#endif /* WRUCB_CONF_WINDOW */
+
+/* The time between two chunks in a window. */
+#ifdef WRUCB_CONF_PACING
+#define WRUCB_PACING WRUCB_CONF_PACING
+#else /* WRUCB_CONF_PACING */
+#define WRUCB_PACING 0
+#endif /* WRUCB_CONF_PACING */
+
+struct wrucb_conn {
+  struct unicast_conn c;
+  const struct wrucb_callbacks *u;
+  struct ctimer t;
+  rimeaddr_t receiver, sender;
+  clock_time_t pacing;
+  uint16_t base, next, last;
+  uint16_t bitmap;
+  uint8_t window, transmissions, id, state;
+  uint8_t last_len;
+  char last_data[WRUCB_DATASIZE];
+};
+
+void wrucb_open(struct wrucb_conn *c, uint16_t channel,
+		const struct wrucb_callbacks *u);
+void wrucb_close(struct wrucb_conn *c);
+
+/**
+ * \brief      Set the window size and the pacing of a connection
+ * \param c    The connection
+ * \param window The number of chunks that are sent before waiting for an ACK, at most WRUCB_MAX_WINDOW
+ * \param pacing The time to wait between two chunks
+ */
+void wrucb_set_window(struct wrucb_conn *c, uint8_t window,
+		      clock_time_t pacing);
+
+int wrucb_send(struct wrucb_conn *c, const rimeaddr_t *receiver);
+
+#endif /* __WRUCB_H__ */
@@ -45,6 +45,8 @@
 
 #include "net/uip-packetqueue.h"
 
+#include "net/netcapture.h"
+
 #include <string.h>
 
 #if UIP_CONF_IPV6
@@ -126,6 +128,7 @@ u8_t
 tcpip_output(uip_lladdr_t *a)
 {
   int ret;
+  NETCAPTURE_IP(NETCAPTURE_OUT);
   if(outputfunc != NULL) {
     ret = outputfunc(a);
     return ret;
@@ -145,6 +148,7 @@ static u8_t (* outputfunc)(void);
 u8_t
 tcpip_output(void)
 {
+  NETCAPTURE_IP(NETCAPTURE_OUT);
   if(outputfunc != NULL) {
     return outputfunc();
   }
@@ -423,7 +427,7 @@ eventhandler(process_event_t ev, process_data_t data)
         for(cptr = &uip_udp_conns[0];
             cptr < &uip_udp_conns[UIP_UDP_CONNS]; ++cptr) {
           if(cptr->appstate.p == p) {
-            cptr->lport = 0;
+            uip_udp_remove(cptr);
           }
         }
       
@@ -539,6 +543,7 @@ eventhandler(process_event_t ev, process_data_t data)
 void
 tcpip_input(void)
 {
+  NETCAPTURE_IP(NETCAPTURE_IN);
   process_post_synch(&tcpip_process, PACKET_INPUT, NULL);
   uip_len = 0;
 #if UIP_CONF_IPV6
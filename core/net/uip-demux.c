@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Address maps for finding the uIP connection of an
+ *         incoming packet
+ */
+
+#include <string.h>
+
+#include "net/uip-demux.h"
+#include "lib/addrmap.h"
+
+#if UIP_HASHED_DEMUX
+
+#if (UIP_DEMUX_SLOTS & (UIP_DEMUX_SLOTS - 1)) || UIP_DEMUX_SLOTS > 128
+#error UIP_CONF_DEMUX_SLOTS must be a power of two, not larger than 128
+#endif
+
+#if UIP_DEMUX_SLOTS <= UIP_CONNS || UIP_DEMUX_SLOTS <= UIP_LISTENPORTS
+#error UIP_CONF_DEMUX_SLOTS must be larger than the number of connections
+#endif
+
+/* The remote address, the local port and the remote port are the
+   first fields of struct uip_conn, and form the key of the TCP
+   map. */
+#define TCP_KEYLEN (offsetof(struct uip_conn, rport) + sizeof(u16_t))
+
+static void *tcp_slots[UIP_DEMUX_SLOTS];
+static struct addrmap tcp_map;
+
+static void *listen_slots[UIP_DEMUX_SLOTS];
+static struct addrmap listen_map;
+
+#if UIP_UDP
+#if UIP_DEMUX_SLOTS <= UIP_UDP_CONNS
+#error UIP_CONF_DEMUX_SLOTS must be larger than the number of connections
+#endif
+
+static void *udp_slots[UIP_DEMUX_SLOTS];
+static struct addrmap udp_map;
+#endif /* UIP_UDP */
+
+/*---------------------------------------------------------------------------*/
+void
+uip_demux_init(void)
+{
+  addrmap_init(&tcp_map, tcp_slots, UIP_DEMUX_SLOTS, 0, TCP_KEYLEN);
+  addrmap_init(&listen_map, listen_slots, UIP_DEMUX_SLOTS, 0,
+               sizeof(u16_t));
+#if UIP_UDP
+  addrmap_init(&udp_map, udp_slots, UIP_DEMUX_SLOTS,
+               offsetof(struct uip_udp_conn, lport), sizeof(u16_t));
+#endif /* UIP_UDP */
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_demux_tcp_add(struct uip_conn *conn)
+{
+  addrmap_add(&tcp_map, conn);
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_demux_tcp_remove(struct uip_conn *conn)
+{
+  addrmap_remove(&tcp_map, conn);
+}
+/*---------------------------------------------------------------------------*/
+struct uip_conn *
+uip_demux_tcp_lookup(const uip_ipaddr_t *ripaddr, u16_t lport, u16_t rport)
+{
+  u8_t key[TCP_KEYLEN];
+
+  memcpy(&key[offsetof(struct uip_conn, ripaddr)], ripaddr,
+         sizeof(uip_ipaddr_t));
+  memcpy(&key[offsetof(struct uip_conn, lport)], &lport, sizeof(u16_t));
+  memcpy(&key[offsetof(struct uip_conn, rport)], &rport, sizeof(u16_t));
+  return addrmap_get(&tcp_map, key);
+}
+/*---------------------------------------------------------------------------*/
+struct uip_conn *
+uip_demux_tcp_next(struct uip_conn *conn)
+{
+  return addrmap_get_next(&tcp_map, conn);
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP
+void
+uip_demux_udp_bind(struct uip_udp_conn *conn, u16_t port)
+{
+  addrmap_remove(&udp_map, conn);
+  conn->lport = port;
+  if(port != 0) {
+    addrmap_add(&udp_map, conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct uip_udp_conn *
+uip_demux_udp_lookup(u16_t lport)
+{
+  return addrmap_get(&udp_map, &lport);
+}
+/*---------------------------------------------------------------------------*/
+struct uip_udp_conn *
+uip_demux_udp_next(struct uip_udp_conn *conn)
+{
+  return addrmap_get_next(&udp_map, conn);
+}
+#endif /* UIP_UDP */
+/*---------------------------------------------------------------------------*/
+void
+uip_demux_listen(u16_t *listenport)
+{
+  addrmap_add(&listen_map, listenport);
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_demux_unlisten(u16_t *listenport)
+{
+  addrmap_remove(&listen_map, listenport);
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_demux_listening(u16_t port)
+{
+  return addrmap_get(&listen_map, &port) != NULL;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_HASHED_DEMUX */
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \defgroup uipdemux uIP hashed demultiplexing
+ * @{
+ *
+ * When an incoming packet is processed, uIP has to find the
+ * connection that the packet belongs to. By default this is done by
+ * going through the uip_conns[], uip_udp_conns[] or
+ * uip_listenports[] arrays, which makes the cost of every incoming
+ * packet grow with the number of connections.
+ *
+ * The uip-demux module keeps address maps of the connections,
+ * keyed on the remote IP address and the two port numbers for TCP,
+ * on the local port for UDP, and on the port number for listening
+ * ports. The module is used by uIP when UIP_CONF_HASHED_DEMUX is
+ * set, and is not called by applications, which bind and remove UDP
+ * connections through uip_udp_bind() and uip_udp_remove() as usual.
+ *
+ * TCP connections are put in the map when they are set up, and are
+ * only taken out when the connection structure is reused, so the
+ * lookup functions may return closed connections.
+ */
+
+/**
+ * \file
+ *         Header file for uIP hashed demultiplexing
+ */
+
+#ifndef __UIP_DEMUX_H__
+#define __UIP_DEMUX_H__
+
+#include "net/uip.h"
+
+/**
+ * Remove all connections and listening ports from the maps.
+ */
+void uip_demux_init(void);
+
+/**
+ * Put a TCP connection in the map.
+ *
+ * The remote address and the port numbers of the connection must
+ * not be changed while the connection is in the map.
+ */
+void uip_demux_tcp_add(struct uip_conn *conn);
+
+/**
+ * Take a TCP connection out of the map.
+ */
+void uip_demux_tcp_remove(struct uip_conn *conn);
+
+/**
+ * Find the first TCP connection with a remote address and port pair.
+ *
+ * \param ripaddr The remote IP address.
+ * \param lport The local port, in network byte order.
+ * \param rport The remote port, in network byte order.
+ *
+ * \return The connection, or NULL if there is no such connection.
+ */
+struct uip_conn *uip_demux_tcp_lookup(const uip_ipaddr_t *ripaddr,
+                                      u16_t lport, u16_t rport);
+
+/**
+ * Find the next TCP connection with the same addresses and ports.
+ */
+struct uip_conn *uip_demux_tcp_next(struct uip_conn *conn);
+
+#if UIP_UDP
+/*
+ * uip_demux_udp_bind() is declared in uip.h, where the
+ * uip_udp_bind() and uip_udp_remove() macros use it.
+ */
+
+/**
+ * Find the first UDP connection bound to a local port.
+ *
+ * \param lport The local port, in network byte order.
+ *
+ * \return The connection, or NULL if there is no such connection.
+ */
+struct uip_udp_conn *uip_demux_udp_lookup(u16_t lport);
+
+/**
+ * Find the next UDP connection bound to the same local port.
+ */
+struct uip_udp_conn *uip_demux_udp_next(struct uip_udp_conn *conn);
+#endif /* UIP_UDP */
+
+/**
+ * Put an entry of uip_listenports[] in the map.
+ */
+void uip_demux_listen(u16_t *listenport);
+
+/**
+ * Take an entry of uip_listenports[] out of the map.
+ */
+void uip_demux_unlisten(u16_t *listenport);
+
+/**
+ * Check if a port is listened to.
+ *
+ * \param port The port, in network byte order.
+ *
+ * \return Non-zero if the port is listened to.
+ */
+int uip_demux_listening(u16_t port);
+
+#endif /* __UIP_DEMUX_H__ */
+
+/** @} */
+/** @} */
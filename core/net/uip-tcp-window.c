@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Retransmission buffers and RTT estimation for the uIP TCP
+ *         sliding window mode
+ */
+
+#include <string.h>
+
+#include "net/uip-tcp-window.h"
+#include "net/uip_arch.h"
+#include "net/tcpip.h"
+
+#if UIP_TCP && UIP_TCP_WINDOW
+
+static struct uip_tcp_seg segs[UIP_TCP_WINDOW_BUFS];
+
+/*---------------------------------------------------------------------------*/
+static u32_t
+seqno32(const u8_t *seqno)
+{
+  return ((u32_t)seqno[0] << 24) | ((u32_t)seqno[1] << 16) |
+    ((u32_t)seqno[2] << 8) | seqno[3];
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Poll the connections whose data did not fit because all buffers
+ * were in use, now that a buffer has been freed.
+ */
+static void
+poll_waiting(struct uip_conn *except)
+{
+  struct uip_conn *c;
+
+  for(c = &uip_conns[0]; c <= &uip_conns[UIP_CONNS - 1]; ++c) {
+    if(c != except && (c->winflags & UIP_TCP_WINDOW_REXMIT) &&
+       (c->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+      tcpip_poll_tcp(c);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct uip_tcp_seg *
+alloc_seg(void)
+{
+  int i;
+
+  for(i = 0; i < UIP_TCP_WINDOW_BUFS; ++i) {
+    if(segs[i].conn == NULL) {
+      return &segs[i];
+    }
+  }
+
+  /* Reclaim the buffers of connections that have been closed without
+     their buffers being freed. */
+  for(i = 0; i < UIP_TCP_WINDOW_BUFS; ++i) {
+    if(segs[i].conn->tcpstateflags == UIP_CLOSED) {
+      uip_tcp_window_free(segs[i].conn);
+      return &segs[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_full(struct uip_conn *c)
+{
+  struct uip_tcp_seg *s;
+  int n;
+
+  if(c->winflags & UIP_TCP_WINDOW_CLOSE) {
+    return 1;
+  }
+
+  n = 0;
+  for(s = c->segs; s != NULL; s = s->next) {
+    ++n;
+  }
+  if(n >= UIP_TCP_WINDOW_SEGS) {
+    return 1;
+  }
+
+  /* We always allow one segment to be sent, even if the remote host
+     has advertised a zero window. This segment acts as the window
+     probe. */
+  if(c->len > 0 && c->len + c->mss > c->sndwnd) {
+    return 1;
+  }
+
+  return alloc_seg() == NULL;
+}
+/*---------------------------------------------------------------------------*/
+u16_t
+uip_tcp_window_add(struct uip_conn *c, const void *data, u16_t len)
+{
+  struct uip_tcp_seg *s, **p;
+
+  s = alloc_seg();
+  if(s == NULL) {
+    return 0;
+  }
+
+  if(len > UIP_TCP_MSS) {
+    len = UIP_TCP_MSS;
+  }
+  memcpy(s->data, data, len);
+  s->conn = c;
+  s->len = len;
+  s->age = 0;
+  s->rexmit = 0;
+  s->next = NULL;
+
+  for(p = &c->segs; *p != NULL; p = &(*p)->next);
+  *p = s;
+
+  /* Start the retransmission timer if this is the only segment in
+     flight. */
+  if(c->len == 0) {
+    c->timer = c->rto;
+  }
+  c->len += len;
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_ack(struct uip_conn *c, const u8_t *ackno)
+{
+  struct uip_tcp_seg *s;
+  u32_t acked;
+  u16_t n;
+  signed char m;
+  u8_t sampled;
+
+  acked = seqno32(ackno) - seqno32(c->snd_nxt);
+  if(acked == 0) {
+    return 0;
+  }
+  if(acked > c->len) {
+    return -1;
+  }
+
+  uip_add32(c->snd_nxt, (u16_t)acked);
+  memcpy(c->snd_nxt, uip_acc32, 4);
+  c->len -= (u16_t)acked;
+
+  sampled = 0;
+  n = (u16_t)acked;
+  while((s = c->segs) != NULL && n >= s->len) {
+    /* Do RTT estimation on the oldest segment that was acknowledged,
+       unless it has been retransmitted. */
+    if(!sampled && !s->rexmit) {
+      /* This is taken directly from VJs original code in his paper */
+      m = s->age;
+      m = m - (c->sa >> 3);
+      c->sa += m;
+      if(m < 0) {
+        m = -m;
+      }
+      m = m - (c->sv >> 2);
+      c->sv += m;
+      c->rto = (c->sa >> 3) + c->sv;
+    }
+    sampled = 1;
+
+    n -= s->len;
+    c->segs = s->next;
+    s->conn = NULL;
+  }
+  if(sampled) {
+    poll_waiting(c);
+  }
+
+  /* If the remote host only acknowledged a part of a segment, we keep
+     the rest of it for retransmission. */
+  if(n > 0) {
+    s = c->segs;
+    memmove(s->data, &s->data[n], s->len - n);
+    s->len -= n;
+  }
+
+  return (int)acked;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_periodic(struct uip_conn *c)
+{
+  struct uip_tcp_seg *s;
+
+  for(s = c->segs; s != NULL; s = s->next) {
+    if(s->age < 127) {
+      ++s->age;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_free(struct uip_conn *c)
+{
+  struct uip_tcp_seg *s;
+
+  for(s = c->segs; s != NULL; s = s->next) {
+    s->conn = NULL;
+  }
+  c->winflags = 0;
+  c->dupacks = 0;
+  if(c->segs != NULL) {
+    c->segs = NULL;
+    poll_waiting(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_TCP && UIP_TCP_WINDOW */
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \defgroup uiptcpwindow uIP TCP sliding window
+ * @{
+ *
+ * The basic uIP TCP implementation only allows each TCP connection to
+ * have a single TCP segment in flight at any given time, and asks the
+ * application to regenerate the data of the segment when it needs to
+ * be retransmitted. Together with the delayed ACK algorithm used by
+ * most TCP receivers, this severely limits the throughput, in
+ * particular over multi-hop networks with long round-trip times.
+ *
+ * The uip-tcp-window module lets a connection have up to
+ * UIP_TCP_WINDOW_SEGS segments in flight. A copy of each segment is
+ * kept in a retransmission buffer, taken from a pool of
+ * UIP_TCP_WINDOW_BUFS buffers shared by all connections, until the
+ * segment has been acknowledged. The module is used by uIP when
+ * UIP_CONF_TCP_WINDOW is set, and is not called by applications.
+ */
+
+/**
+ * \file
+ *         Header file for the uIP TCP sliding window module
+ */
+
+#ifndef __UIP_TCP_WINDOW_H__
+#define __UIP_TCP_WINDOW_H__
+
+#include "net/uip.h"
+
+/* The application has sent data that has been buffered, but it has
+   not yet been told that the data was acknowledged. */
+#define UIP_TCP_WINDOW_ACKED  0x01
+/* The application sent data that did not fit in the window, and
+   must be asked to retransmit it. */
+#define UIP_TCP_WINDOW_REXMIT 0x02
+/* The application has closed the connection, and a FIN should be
+   sent as soon as all data in flight has been acknowledged. */
+#define UIP_TCP_WINDOW_CLOSE  0x04
+
+/* The number of duplicate ACKs that trigger a fast retransmit. */
+#define UIP_TCP_WINDOW_DUPACKS 3
+
+struct uip_tcp_seg {
+  struct uip_tcp_seg *next;
+  struct uip_conn *conn;
+  u16_t len;
+  u8_t age;
+  u8_t rexmit;
+  u8_t data[UIP_TCP_MSS];
+};
+
+/**
+ * Check if a connection can send another segment.
+ *
+ * \param c The connection.
+ *
+ * \return Non-zero if the connection already has the maximum number
+ * of segments in flight, if the remote host's window is full, or if
+ * there are no free retransmission buffers.
+ */
+int uip_tcp_window_full(struct uip_conn *c);
+
+/**
+ * Copy a new segment into a retransmission buffer.
+ *
+ * \param c The connection.
+ * \param data A pointer to the segment data.
+ * \param len The length of the segment data.
+ *
+ * \return The number of bytes buffered, or zero if no retransmission
+ * buffer was available.
+ */
+u16_t uip_tcp_window_add(struct uip_conn *c, const void *data, u16_t len);
+
+/**
+ * Process the acknowledgment number of an incoming segment.
+ *
+ * This function frees all retransmission buffers that are covered
+ * by the acknowledgment, updates the sequence number and length of
+ * outstanding data of the connection, and updates the RTT estimate
+ * from the oldest acknowledged segment that was not retransmitted.
+ *
+ * \param c The connection.
+ * \param ackno The acknowledgment number of the incoming segment.
+ *
+ * \return The number of bytes acknowledged, zero for a duplicate
+ * ACK, or -1 if the acknowledgment number is out of range.
+ */
+int uip_tcp_window_ack(struct uip_conn *c, const u8_t *ackno);
+
+/**
+ * Age the segments in flight on a connection.
+ *
+ * This function must be called on every TCP timer pulse for the
+ * connection.
+ */
+void uip_tcp_window_periodic(struct uip_conn *c);
+
+/**
+ * Free all retransmission buffers of a connection.
+ */
+void uip_tcp_window_free(struct uip_conn *c);
+
+#endif /* __UIP_TCP_WINDOW_H__ */
+
+/** @} */
+/** @} */
@@ -75,6 +75,13 @@
 #include "net/uipopt.h"
 #include "net/uip_arp.h"
 #include "net/uip_arch.h"
+#if UIP_TCP_WINDOW
+#include "net/uip-tcp-window.h"
+#include "net/tcpip.h"
+#endif /* UIP_TCP_WINDOW */
+#if UIP_HASHED_DEMUX
+#include "net/uip-demux.h"
+#endif /* UIP_HASHED_DEMUX */
 
 #if !UIP_CONF_IPV6 /* If UIP_CONF_IPV6 is defined, we compile the
 		      uip6.c file instead of this one. Therefore
@@ -181,6 +188,12 @@ static u16_t lastport;       /* Keeps track of the last port used for
 u8_t uip_acc32[4];
 static u8_t c, opt;
 static u16_t tmp16;
+#if UIP_TCP_WINDOW
+/* The length of the new segment that is being sent, and whether the
+   oldest segment is being retransmitted, in sliding window mode. */
+static u16_t window_newlen;
+static u8_t window_rexmit;
+#endif /* UIP_TCP_WINDOW */
 
 /* Structures and definitions. */
 #define TCP_FIN 0x01
@@ -385,6 +398,10 @@ uip_init(void)
     uip_udp_conns[c].lport = 0;
   }
 #endif /* UIP_UDP */
+
+#if UIP_HASHED_DEMUX
+  uip_demux_init();
+#endif /* UIP_HASHED_DEMUX */
   
 
   /* IPv4 initialization. */
@@ -452,9 +469,19 @@ uip_connect(uip_ipaddr_t *ripaddr, u16_t rport)
   conn->rto = UIP_RTO;
   conn->sa = 0;
   conn->sv = 16;   /* Initial value of the RTT variance. */
+#if UIP_TCP_WINDOW
+  uip_tcp_window_free(conn);
+  conn->sndwnd = UIP_TCP_MSS;
+#endif /* UIP_TCP_WINDOW */
+#if UIP_HASHED_DEMUX
+  uip_demux_tcp_remove(conn);
+#endif /* UIP_HASHED_DEMUX */
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+#if UIP_HASHED_DEMUX
+  uip_demux_tcp_add(conn);
+#endif /* UIP_HASHED_DEMUX */
   
   return conn;
 }
@@ -493,7 +520,7 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, u16_t rport)
     return 0;
   }
   
-  conn->lport = UIP_HTONS(lastport);
+  uip_udp_bind(conn, UIP_HTONS(lastport));
   conn->rport = rport;
   if(ripaddr == NULL) {
     memset(&conn->ripaddr, 0, sizeof(uip_ipaddr_t));
@@ -511,6 +538,9 @@ uip_unlisten(u16_t port)
 {
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(uip_listenports[c] == port) {
+#if UIP_HASHED_DEMUX
+      uip_demux_unlisten(&uip_listenports[c]);
+#endif /* UIP_HASHED_DEMUX */
       uip_listenports[c] = 0;
       return;
     }
@@ -523,6 +553,9 @@ uip_listen(u16_t port)
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(uip_listenports[c] == 0) {
       uip_listenports[c] = port;
+#if UIP_HASHED_DEMUX
+      uip_demux_listen(&uip_listenports[c]);
+#endif /* UIP_HASHED_DEMUX */
       return;
     }
   }
@@ -687,8 +720,24 @@ uip_process(u8_t flag)
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+#if UIP_TCP_WINDOW
+       !uip_tcp_window_full(uip_connr)) {
+    tcp_window_poll:
+	/* Tell the application if the data it sent last has been
+	   buffered, or if it has to send it again since it did not
+	   fit in the window. Otherwise, we poll it for new data. */
+	if(uip_connr->winflags & UIP_TCP_WINDOW_ACKED) {
+	  uip_flags = UIP_ACKDATA;
+	} else if(uip_connr->winflags & UIP_TCP_WINDOW_REXMIT) {
+	  uip_flags = UIP_REXMIT;
+	} else {
+	  uip_flags = UIP_POLL;
+	}
+	uip_connr->winflags &= ~(UIP_TCP_WINDOW_ACKED | UIP_TCP_WINDOW_REXMIT);
+#else /* UIP_TCP_WINDOW */
        !uip_outstanding(uip_connr)) {
 	uip_flags = UIP_POLL;
+#endif /* UIP_TCP_WINDOW */
 	UIP_APPCALL();
 	goto appsend;
 #if UIP_ACTIVE_OPEN
@@ -736,12 +785,18 @@ uip_process(u8_t flag)
 	 in which case we retransmit. */
 
       if(uip_outstanding(uip_connr)) {
+#if UIP_TCP_WINDOW
+	uip_tcp_window_periodic(uip_connr);
+#endif /* UIP_TCP_WINDOW */
 	if(uip_connr->timer-- == 0) {
 	  if(uip_connr->nrtx == UIP_MAXRTX ||
 	     ((uip_connr->tcpstateflags == UIP_SYN_SENT ||
 	       uip_connr->tcpstateflags == UIP_SYN_RCVD) &&
 	      uip_connr->nrtx == UIP_MAXSYNRTX)) {
 	    uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+	    uip_tcp_window_free(uip_connr);
+#endif /* UIP_TCP_WINDOW */
 
 	    /* We call UIP_APPCALL() with uip_flags set to
 	       UIP_TIMEDOUT to inform the application that the
@@ -784,7 +839,14 @@ uip_process(u8_t flag)
 	    /* In the ESTABLISHED state, we call upon the application
                to do the actual retransmit after which we jump into
                the code for sending out the packet (the apprexmit
-               label). */
+               label). In sliding window mode, we retransmit the
+               oldest segment from the retransmission buffer
+               instead. */
+#if UIP_TCP_WINDOW
+	    if(uip_connr->segs != NULL) {
+	      goto tcp_window_rexmit;
+	    }
+#endif /* UIP_TCP_WINDOW */
 	    uip_flags = UIP_REXMIT;
 	    UIP_APPCALL();
 	    goto apprexmit;
@@ -797,12 +859,26 @@ uip_process(u8_t flag)
 	    
 	  }
 	}
+#if UIP_TCP_WINDOW
+	/* If there is room for more data in the window, we poll the
+	   application for it. */
+	if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+	   !uip_tcp_window_full(uip_connr)) {
+	  goto tcp_window_poll;
+	}
+#endif /* UIP_TCP_WINDOW */
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
 	/* If there was no need for a retransmission, we poll the
            application for new data. */
+#if UIP_TCP_WINDOW
+	/* The application may also have data to send again that did
+	   not fit in the window. */
+	goto tcp_window_poll;
+#else /* UIP_TCP_WINDOW */
 	uip_flags = UIP_POLL;
 	UIP_APPCALL();
 	goto appsend;
+#endif /* UIP_TCP_WINDOW */
       }
     }
     goto drop;
@@ -1112,9 +1188,15 @@ uip_process(u8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+#if UIP_HASHED_DEMUX
+  for(uip_udp_conn = uip_demux_udp_lookup(UDPBUF->destport);
+      uip_udp_conn != NULL;
+      uip_udp_conn = uip_demux_udp_next(uip_udp_conn)) {
+#else /* UIP_HASHED_DEMUX */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
+#endif /* UIP_HASHED_DEMUX */
     /* If the local UDP port is non-zero, the connection is considered
        to be used. If so, the local port number is checked against the
        destination port number in the received packet. If the two port
@@ -1235,8 +1317,15 @@ uip_process(u8_t flag)
   
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#if UIP_HASHED_DEMUX
+  for(uip_connr = uip_demux_tcp_lookup(&BUF->srcipaddr, BUF->destport,
+                                       BUF->srcport);
+      uip_connr != NULL;
+      uip_connr = uip_demux_tcp_next(uip_connr)) {
+#else /* UIP_HASHED_DEMUX */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
+#endif /* UIP_HASHED_DEMUX */
     if(uip_connr->tcpstateflags != UIP_CLOSED &&
        BUF->destport == uip_connr->lport &&
        BUF->srcport == uip_connr->rport &&
@@ -1255,11 +1344,17 @@ uip_process(u8_t flag)
   
   tmp16 = BUF->destport;
   /* Next, check listening connections. */
+#if UIP_HASHED_DEMUX
+  if(uip_demux_listening(tmp16)) {
+    goto found_listen;
+  }
+#else /* UIP_HASHED_DEMUX */
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(tmp16 == uip_listenports[c]) {
       goto found_listen;
     }
   }
+#endif /* UIP_HASHED_DEMUX */
   
   /* No matching connection found, so we send a RST packet. */
   UIP_STAT(++uip_stat.tcp.synrst);
@@ -1355,9 +1450,19 @@ uip_process(u8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+#if UIP_TCP_WINDOW
+  uip_tcp_window_free(uip_connr);
+  uip_connr->sndwnd = UIP_TCP_MSS;
+#endif /* UIP_TCP_WINDOW */
+#if UIP_HASHED_DEMUX
+  uip_demux_tcp_remove(uip_connr);
+#endif /* UIP_HASHED_DEMUX */
   uip_connr->lport = BUF->destport;
   uip_connr->rport = BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &BUF->srcipaddr);
+#if UIP_HASHED_DEMUX
+  uip_demux_tcp_add(uip_connr);
+#endif /* UIP_HASHED_DEMUX */
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
 
   uip_connr->snd_nxt[0] = iss[0];
@@ -1438,6 +1543,9 @@ uip_process(u8_t flag)
      before we accept the reset. */
   if(BUF->flags & TCP_RST) {
     uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+    uip_tcp_window_free(uip_connr);
+#endif /* UIP_TCP_WINDOW */
     UIP_LOG("tcp: got reset, aborting connection.");
     uip_flags = UIP_ABORT;
     UIP_APPCALL();
@@ -1473,6 +1581,39 @@ uip_process(u8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_WINDOW
+  /* In sliding window mode, the segment may acknowledge any number of
+     the segments in flight. */
+  if((BUF->flags & TCP_ACK) && uip_connr->segs != NULL) {
+    int acked;
+
+    acked = uip_tcp_window_ack(uip_connr, BUF->ackno);
+    if(acked > 0) {
+      /* Reset the retransmission timer. */
+      uip_connr->timer = uip_connr->rto;
+      uip_connr->nrtx = 0;
+      uip_connr->dupacks = 0;
+
+      /* If the application has been waiting for room in the window,
+	 we let it know that its data has been acknowledged. */
+      if(uip_connr->winflags & UIP_TCP_WINDOW_ACKED) {
+	uip_connr->winflags &= ~UIP_TCP_WINDOW_ACKED;
+	uip_flags = UIP_ACKDATA;
+      } else if(uip_connr->winflags & UIP_TCP_WINDOW_REXMIT) {
+	tcpip_poll_tcp(uip_connr);
+      }
+    } else if(acked == 0 && uip_len == 0 &&
+	      (BUF->flags & (TCP_SYN | TCP_FIN)) == 0) {
+      /* A duplicate ACK. If we get enough of them, the oldest segment
+	 was probably lost, and we retransmit it without waiting for
+	 the retransmission timer. */
+      if(++uip_connr->dupacks == UIP_TCP_WINDOW_DUPACKS) {
+	UIP_STAT(++uip_stat.tcp.rexmit);
+	goto tcp_window_rexmit;
+      }
+    }
+  } else
+#endif /* UIP_TCP_WINDOW */
   if((BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
@@ -1614,6 +1755,24 @@ uip_process(u8_t flag)
     state. We require that there is no outstanding data; otherwise the
     sequence numbers will be screwed up. */
 
+#if UIP_TCP_WINDOW
+    /* If the application has closed the connection while data was in
+       flight, we send our FIN when all data has been acknowledged.
+       Until then, incoming data is acknowledged but not passed to
+       the application. */
+    if(uip_connr->winflags & UIP_TCP_WINDOW_CLOSE) {
+      if(uip_connr->segs == NULL) {
+	uip_connr->winflags = 0;
+	goto tcp_window_close;
+      }
+      if(uip_len > 0) {
+	uip_add_rcv_nxt(uip_len);
+	goto tcp_send_ack;
+      }
+      goto drop;
+    }
+#endif /* UIP_TCP_WINDOW */
+
     if(BUF->flags & TCP_FIN && !(uip_connr->tcpstateflags & UIP_STOPPED)) {
       if(uip_outstanding(uip_connr)) {
 	goto drop;
@@ -1676,6 +1835,9 @@ uip_process(u8_t flag)
        "persistent timer" and uses the retransmission mechanim.
     */
     tmp16 = ((u16_t)BUF->wnd[0] << 8) + (u16_t)BUF->wnd[1];
+#if UIP_TCP_WINDOW
+    uip_connr->sndwnd = tmp16;
+#endif /* UIP_TCP_WINDOW */
     if(tmp16 > uip_connr->initialmss ||
        tmp16 == 0) {
       tmp16 = uip_connr->initialmss;
@@ -1707,12 +1869,22 @@ uip_process(u8_t flag)
       if(uip_flags & UIP_ABORT) {
 	uip_slen = 0;
 	uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+	uip_tcp_window_free(uip_connr);
+#endif /* UIP_TCP_WINDOW */
 	BUF->flags = TCP_RST | TCP_ACK;
 	goto tcp_send_nodata;
       }
 
       if(uip_flags & UIP_CLOSE) {
 	uip_slen = 0;
+#if UIP_TCP_WINDOW
+	if(uip_connr->segs != NULL) {
+	  uip_connr->winflags |= UIP_TCP_WINDOW_CLOSE;
+	  goto tcp_send_ack;
+	}
+      tcp_window_close:
+#endif /* UIP_TCP_WINDOW */
 	uip_connr->len = 1;
 	uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
 	uip_connr->nrtx = 0;
@@ -1722,6 +1894,28 @@ uip_process(u8_t flag)
 
       /* If uip_slen > 0, the application has data to be sent. */
       if(uip_slen > 0) {
+#if UIP_TCP_WINDOW
+	/* In sliding window mode, the data is copied into a
+	   retransmission buffer and sent as a new segment, if there is
+	   room for it in the window. Otherwise, the application is
+	   asked to send it again later. */
+	if(uip_slen > uip_connr->mss) {
+	  uip_slen = uip_connr->mss;
+	}
+	if(uip_tcp_window_full(uip_connr) ||
+	   uip_tcp_window_add(uip_connr, uip_sappdata, uip_slen) == 0) {
+	  uip_connr->winflags |= UIP_TCP_WINDOW_REXMIT;
+	  uip_slen = 0;
+	} else {
+	  window_newlen = uip_slen;
+	  uip_connr->winflags |= UIP_TCP_WINDOW_ACKED;
+	  if(!uip_tcp_window_full(uip_connr)) {
+	    /* There is room for more, so we ask the application for
+	       the next segment right away. */
+	    tcpip_poll_tcp(uip_connr);
+	  }
+	}
+#else /* UIP_TCP_WINDOW */
 
 	/* If the connection has acknowledged data, the contents of
 	   the ->len variable should be discarded. */
@@ -1751,8 +1945,11 @@ uip_process(u8_t flag)
 	     retransmit) out more than it previously sent out. */
 	  uip_slen = uip_connr->len;
 	}
+#endif /* UIP_TCP_WINDOW */
       }
+#if !UIP_TCP_WINDOW
       uip_connr->nrtx = 0;
+#endif /* !UIP_TCP_WINDOW */
     apprexmit:
       uip_appdata = uip_sappdata;
       
@@ -1760,7 +1957,11 @@ uip_process(u8_t flag)
          packet had new data in it, we must send out a packet. */
       if(uip_slen > 0 && uip_connr->len > 0) {
 	/* Add the length of the IP and TCP headers. */
+#if UIP_TCP_WINDOW
+	uip_len = uip_slen + UIP_TCPIP_HLEN;
+#else /* UIP_TCP_WINDOW */
 	uip_len = uip_connr->len + UIP_TCPIP_HLEN;
+#endif /* UIP_TCP_WINDOW */
 	/* We always set the ACK flag in response packets. */
 	BUF->flags = TCP_ACK | TCP_PSH;
 	/* Send the packet. */
@@ -1841,6 +2042,19 @@ uip_process(u8_t flag)
     }
   }
   goto drop;
+
+#if UIP_TCP_WINDOW
+  /* We jump here to retransmit the oldest unacknowledged segment from
+     the retransmission buffer. */
+ tcp_window_rexmit:
+  uip_connr->segs->rexmit = 1;
+  window_rexmit = 1;
+  memcpy(uip_sappdata, uip_connr->segs->data, uip_connr->segs->len);
+  uip_appdata = uip_sappdata;
+  uip_len = uip_connr->segs->len + UIP_TCPIP_HLEN;
+  BUF->flags = TCP_ACK | TCP_PSH;
+  goto tcp_send_noopts;
+#endif /* UIP_TCP_WINDOW */
   
   /* We jump here when we are ready to send the packet, and just want
      to set the appropriate TCP sequence numbers in the TCP header. */
@@ -1868,6 +2082,17 @@ uip_process(u8_t flag)
   BUF->seqno[2] = uip_connr->snd_nxt[2];
   BUF->seqno[3] = uip_connr->snd_nxt[3];
 
+#if UIP_TCP_WINDOW
+  /* Except for retransmissions, segments are sent with the sequence
+     number that follows the data already in flight. */
+  if(uip_connr->segs != NULL && !window_rexmit) {
+    uip_add32(BUF->seqno, uip_connr->len - window_newlen);
+    memcpy(BUF->seqno, uip_acc32, 4);
+  }
+  window_newlen = 0;
+  window_rexmit = 0;
+#endif /* UIP_TCP_WINDOW */
+
   BUF->proto = UIP_PROTO_TCP;
   
   BUF->srcport  = uip_connr->lport;
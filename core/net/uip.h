@@ -837,7 +837,11 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, u16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_HASHED_DEMUX
+#define uip_udp_remove(conn) uip_demux_udp_bind((conn), 0)
+#else /* UIP_HASHED_DEMUX */
 #define uip_udp_remove(conn) (conn)->lport = 0
+#endif /* UIP_HASHED_DEMUX */
 
 /**
  * Bind a UDP connection to a local port.
@@ -849,7 +853,13 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, u16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_HASHED_DEMUX
+#define uip_udp_bind(conn, port) uip_demux_udp_bind((conn), (port))
+struct uip_udp_conn;
+void uip_demux_udp_bind(struct uip_udp_conn *conn, u16_t port);
+#else /* UIP_HASHED_DEMUX */
 #define uip_udp_bind(conn, port) (conn)->lport = port
+#endif /* UIP_HASHED_DEMUX */
 
 /**
  * Send a UDP datagram of length len on the current connection.
@@ -1288,6 +1298,10 @@ extern u16_t uip_urglen, uip_surglen;
  * file pointers) for the connection. The type of this field is
  * configured in the "uipopt.h" header file.
  */
+#if UIP_TCP_WINDOW
+struct uip_tcp_seg;
+#endif /* UIP_TCP_WINDOW */
+
 struct uip_conn {
   uip_ipaddr_t ripaddr;   /**< The IP address of the remote host. */
   
@@ -1313,6 +1327,13 @@ struct uip_conn {
   u8_t timer;         /**< The retransmission timer. */
   u8_t nrtx;          /**< The number of retransmissions for the last
 			 segment sent. */
+#if UIP_TCP_WINDOW
+  struct uip_tcp_seg *segs; /**< The unacknowledged segments, oldest
+			       first. */
+  u16_t sndwnd;       /**< The window advertised by the remote host. */
+  u8_t dupacks;       /**< The number of duplicate ACKs received. */
+  u8_t winflags;      /**< Sliding window state flags. */
+#endif /* UIP_TCP_WINDOW */
 
   /** The application state. */
   uip_tcp_appstate_t appstate;
@@ -342,6 +342,41 @@
 #define UIP_LISTENPORTS (UIP_CONF_MAX_LISTENPORTS)
 #endif /* UIP_CONF_MAX_LISTENPORTS */
 
+/**
+ * Determines if incoming packets should be matched with connections
+ * through hash tables.
+ *
+ * By default, uIP finds the connection of an incoming packet by
+ * going through all TCP connections, all UDP connections, or all
+ * listening ports. With this option, uIP keeps hash tables keyed on
+ * the local port, the remote port and the remote address for TCP,
+ * on the local port for UDP, and on the listening port, so that the
+ * cost of a lookup does not depend on the number of connections. If
+ * several UDP connections match an incoming packet, it is not
+ * specified which of them gets the packet.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_HASHED_DEMUX
+#define UIP_HASHED_DEMUX (UIP_CONF_HASHED_DEMUX)
+#else /* UIP_CONF_HASHED_DEMUX */
+#define UIP_HASHED_DEMUX 0
+#endif /* UIP_CONF_HASHED_DEMUX */
+
+/**
+ * The number of slots in each of the demultiplexing hash tables.
+ *
+ * Must be a power of two, not larger than 128, and larger than
+ * UIP_CONNS, UIP_UDP_CONNS and UIP_LISTENPORTS.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_DEMUX_SLOTS
+#define UIP_DEMUX_SLOTS (UIP_CONF_DEMUX_SLOTS)
+#else /* UIP_CONF_DEMUX_SLOTS */
+#define UIP_DEMUX_SLOTS 32
+#endif /* UIP_CONF_DEMUX_SLOTS */
+
 /**
  * Determines if support for TCP urgent data notification should be
  * compiled in.
@@ -415,6 +450,53 @@
 #define UIP_TIME_WAIT_TIMEOUT UIP_CONF_WAIT_TIMEOUT
 #endif
 
+/**
+ * Determines if the sliding window mode of TCP should be compiled in.
+ *
+ * By default, uIP allows only one unacknowledged segment per
+ * connection and asks the application to regenerate the data when
+ * it must be retransmitted. In sliding window mode, uIP keeps a
+ * copy of every segment it sends in a retransmission buffer, so that
+ * several segments can be in flight at the same time. The stack then
+ * does all retransmissions itself, and the application is told that
+ * its data has been acknowledged as soon as it has been buffered.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW
+#define UIP_TCP_WINDOW (UIP_CONF_TCP_WINDOW)
+#else /* UIP_CONF_TCP_WINDOW */
+#define UIP_TCP_WINDOW 0
+#endif /* UIP_CONF_TCP_WINDOW */
+
+/**
+ * The number of TCP retransmission buffers.
+ *
+ * The buffers are shared by all connections, and each buffer
+ * requires UIP_TCP_MSS bytes of memory. Only used in sliding window
+ * mode.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_BUFS
+#define UIP_TCP_WINDOW_BUFS (UIP_CONF_TCP_WINDOW_BUFS)
+#else /* UIP_CONF_TCP_WINDOW_BUFS */
+#define UIP_TCP_WINDOW_BUFS 4
+#endif /* UIP_CONF_TCP_WINDOW_BUFS */
+
+/**
+ * The maximum number of unacknowledged segments per TCP connection.
+ *
+ * Only used in sliding window mode.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_SEGS
+#define UIP_TCP_WINDOW_SEGS (UIP_CONF_TCP_WINDOW_SEGS)
+#else /* UIP_CONF_TCP_WINDOW_SEGS */
+#define UIP_TCP_WINDOW_SEGS 4
+#endif /* UIP_CONF_TCP_WINDOW_SEGS */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 /**
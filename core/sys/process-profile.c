@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Event queue latency and process run time histograms
+ */
+
+#include "sys/process-profile.h"
+#include "dev/serial-line.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static struct process_profile profiles[PROCESS_PROFILE_PROCESSES];
+static unsigned short untracked;
+static struct process_profile *last;
+
+PROCESS(process_profile_process, "Process profile");
+
+/*---------------------------------------------------------------------------*/
+void
+process_profile_init(void)
+{
+  memset(profiles, 0, sizeof(profiles));
+  untracked = 0;
+  last = NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_profile_reset(void)
+{
+  int i;
+
+  for(i = 0; i < PROCESS_PROFILE_PROCESSES; ++i) {
+    memset(&profiles[i].latency, 0, sizeof(struct process_profile_hist));
+    memset(&profiles[i].runtime, 0, sizeof(struct process_profile_hist));
+  }
+  untracked = 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct process_profile *
+find_profile(struct process *p)
+{
+  int i;
+
+  /* Most events are delivered to the same process in a row (a poll
+     followed by the run of the thread), so we check the last hit
+     first. */
+  if(last != NULL && last->p == p) {
+    return last;
+  }
+
+  for(i = 0; i < PROCESS_PROFILE_PROCESSES; ++i) {
+    if(profiles[i].p == p) {
+      last = &profiles[i];
+      return last;
+    }
+    if(profiles[i].p == NULL) {
+      profiles[i].p = p;
+      last = &profiles[i];
+      return last;
+    }
+  }
+
+  if(untracked < 0xffff) {
+    untracked++;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_profile_exited(struct process *p)
+{
+  int i, n;
+
+  for(n = 0; n < PROCESS_PROFILE_PROCESSES && profiles[n].p != NULL; ++n);
+
+  for(i = 0; i < n; ++i) {
+    if(profiles[i].p == p) {
+      /* The used entries are kept at the start of the table, so we
+         move the last one into the hole. */
+      n--;
+      if(i != n) {
+        memcpy(&profiles[i], &profiles[n], sizeof(struct process_profile));
+      }
+      memset(&profiles[n], 0, sizeof(struct process_profile));
+      last = NULL;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+hist_add(struct process_profile_hist *h, rtimer_clock_t t)
+{
+  rtimer_clock_t v;
+  int n;
+
+  n = 0;
+  for(v = t; v != 0 && n < PROCESS_PROFILE_BUCKETS - 1; v >>= 1) {
+    n++;
+  }
+  if(h->bucket[n] < 0xffff) {
+    h->bucket[n]++;
+  }
+  if(t > h->max) {
+    h->max = t;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+process_profile_latency(struct process *p,
+                        rtimer_clock_t posted, rtimer_clock_t now)
+{
+  struct process_profile *pp;
+
+  pp = find_profile(p);
+  if(pp != NULL) {
+    hist_add(&pp->latency, now - posted);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+process_profile_runtime(struct process *p,
+                        rtimer_clock_t start, rtimer_clock_t end)
+{
+  struct process_profile *pp;
+
+  pp = find_profile(p);
+  if(pp != NULL) {
+    hist_add(&pp->runtime, end - start);
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct process_profile *
+process_profile_get(int n)
+{
+  if(n < 0 || n >= PROCESS_PROFILE_PROCESSES || profiles[n].p == NULL) {
+    return NULL;
+  }
+  return &profiles[n];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hist_print(const char *type, struct process_profile_hist *h)
+{
+  int i;
+
+  printf(" %s", type);
+  for(i = 0; i < PROCESS_PROFILE_BUCKETS; ++i) {
+    printf(" %u", h->bucket[i]);
+  }
+  printf(" max %lu", (unsigned long)h->max);
+}
+/*---------------------------------------------------------------------------*/
+void
+process_profile_print(void)
+{
+  int i;
+
+  printf("PP second %lu buckets %d untracked %u\n",
+         (unsigned long)RTIMER_SECOND, PROCESS_PROFILE_BUCKETS, untracked);
+  for(i = 0; i < PROCESS_PROFILE_PROCESSES && profiles[i].p != NULL; ++i) {
+    printf("PP '%s'", PROCESS_NAME_STRING(profiles[i].p));
+    hist_print("lat", &profiles[i].latency);
+    hist_print("run", &profiles[i].runtime);
+    printf("\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(process_profile_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message && data != NULL);
+    if(strcmp((char *)data, "profile") == 0) {
+      process_profile_print();
+    } else if(strcmp((char *)data, "profile reset") == 0) {
+      process_profile_reset();
+      printf("PP reset\n");
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Event queue latency and process run time histograms
+ *
+ *         When PROCESS_CONF_PROFILE is set, the kernel timestamps every
+ *         event when it is posted with process_post() and records, per
+ *         receiving process, how long the event waited in the event
+ *         queue before it was dispatched and how long the process
+ *         thread ran. Times are measured in rtimer ticks and stored in
+ *         logarithmic histograms: bucket 0 counts zero-tick samples and
+ *         bucket n counts samples in [2^(n-1), 2^n) ticks. The last
+ *         bucket also collects everything longer than that.
+ *
+ *         Run times are inclusive: a process that calls
+ *         process_post_synch() is charged for the time the receiving
+ *         process runs as well.
+ */
+
+#ifndef __PROCESS_PROFILE_H__
+#define __PROCESS_PROFILE_H__
+
+#include "sys/process.h"
+#include "sys/rtimer.h"
+
+#ifdef PROCESS_PROFILE_CONF_PROCESSES
+#define PROCESS_PROFILE_PROCESSES PROCESS_PROFILE_CONF_PROCESSES
+#else
+#define PROCESS_PROFILE_PROCESSES 16
+#endif
+
+#ifdef PROCESS_PROFILE_CONF_BUCKETS
+#define PROCESS_PROFILE_BUCKETS PROCESS_PROFILE_CONF_BUCKETS
+#else
+#define PROCESS_PROFILE_BUCKETS 12
+#endif
+
+struct process_profile_hist {
+  unsigned short bucket[PROCESS_PROFILE_BUCKETS];
+  rtimer_clock_t max;
+};
+
+struct process_profile {
+  struct process *p;
+  struct process_profile_hist latency;
+  struct process_profile_hist runtime;
+};
+
+void process_profile_init(void);
+void process_profile_reset(void);
+
+/**
+ * \brief      Release the profile entry of a process that has exited
+ * \param p    The process
+ *
+ *             Called by the kernel when a process exits, so that the
+ *             entry can be reused by processes that are started later.
+ */
+void process_profile_exited(struct process *p);
+
+/**
+ * \brief      Record the queueing latency of an event
+ * \param p    The process that receives the event
+ * \param posted The rtimer time at which the event was posted
+ * \param now  The rtimer time at which the event is dispatched
+ */
+void process_profile_latency(struct process *p,
+                             rtimer_clock_t posted, rtimer_clock_t now);
+
+/**
+ * \brief      Record the time a process thread ran
+ * \param p    The process
+ * \param start The rtimer time at which the process was invoked
+ * \param end  The rtimer time at which the process returned
+ */
+void process_profile_runtime(struct process *p,
+                             rtimer_clock_t start, rtimer_clock_t end);
+
+/**
+ * \brief      Get the profile entry of the n:th profiled process
+ * \return     A pointer to the entry, or NULL if n is out of range
+ */
+struct process_profile *process_profile_get(int n);
+
+/**
+ * \brief      Print all histograms as text, one line per process
+ *
+ *             The output is intended to be parsed by host scripts and
+ *             can be triggered from a shell command or a serial line
+ *             handler.
+ */
+void process_profile_print(void);
+
+/**
+ * A process that prints the histograms when the line "profile" is
+ * received on the serial line, and clears them on "profile reset".
+ * Applications start it with process_start() after serial_line_init().
+ */
+PROCESS_NAME(process_profile_process);
+
+#endif /* __PROCESS_PROFILE_H__ */
@@ -49,6 +49,10 @@
 #include "sys/process.h"
 #include "sys/arg.h"
 
+#if PROCESS_CONF_PROFILE
+#include "sys/process-profile.h"
+#endif /* PROCESS_CONF_PROFILE */
+
 /*
  * Pointer to the currently running process structure.
  */
@@ -64,6 +68,9 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_CONF_PROFILE
+  rtimer_clock_t posted;
+#endif /* PROCESS_CONF_PROFILE */
 };
 
 static process_num_events_t nevents, fevent;
@@ -169,6 +176,10 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_CONF_PROFILE
+  process_profile_exited(p);
+#endif /* PROCESS_CONF_PROFILE */
+
   process_current = old_current;
 }
 /*---------------------------------------------------------------------------*/
@@ -188,7 +199,15 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_CONF_PROFILE
+    {
+      rtimer_clock_t start = RTIMER_NOW();
+      ret = p->thread(&p->pt, ev, data);
+      process_profile_runtime(p, start, RTIMER_NOW());
+    }
+#else /* PROCESS_CONF_PROFILE */
     ret = p->thread(&p->pt, ev, data);
+#endif /* PROCESS_CONF_PROFILE */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -214,6 +233,9 @@ process_init(void)
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
+#if PROCESS_CONF_PROFILE
+  process_profile_init();
+#endif /* PROCESS_CONF_PROFILE */
 
   process_current = process_list = NULL;
 }
@@ -250,6 +272,9 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+#if PROCESS_CONF_PROFILE
+  static rtimer_clock_t posted;
+#endif /* PROCESS_CONF_PROFILE */
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -266,6 +291,9 @@ do_event(void)
     
     data = events[fevent].data;
     receiver = events[fevent].p;
+#if PROCESS_CONF_PROFILE
+    posted = events[fevent].posted;
+#endif /* PROCESS_CONF_PROFILE */
 
     /* Since we have seen the new event, we move pointer upwards
        and decrese the number of events. */
@@ -282,6 +310,9 @@ do_event(void)
 	if(poll_requested) {
 	  do_poll();
 	}
+#if PROCESS_CONF_PROFILE
+	process_profile_latency(p, posted, RTIMER_NOW());
+#endif /* PROCESS_CONF_PROFILE */
 	call_process(p, ev, data);
       }
     } else {
@@ -293,6 +324,14 @@ do_event(void)
 	receiver->state = PROCESS_STATE_RUNNING;
       }
 
+#if PROCESS_CONF_PROFILE
+      /* Events for a process that has exited are dropped, and must
+	 not take a new profile entry. */
+      if(process_is_running(receiver)) {
+	process_profile_latency(receiver, posted, RTIMER_NOW());
+      }
+#endif /* PROCESS_CONF_PROFILE */
+
       /* Make sure that the process actually is running. */
       call_process(receiver, ev, data);
     }
@@ -348,6 +387,9 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
   events[snum].ev = ev;
   events[snum].data = data;
   events[snum].p = p;
+#if PROCESS_CONF_PROFILE
+  events[snum].posted = RTIMER_NOW();
+#endif /* PROCESS_CONF_PROFILE */
   ++nevents;
 
 #if PROCESS_CONF_STATS
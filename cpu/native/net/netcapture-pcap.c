@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         A pcapng writer for the packet capture ring
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "netcapture-pcap.h"
+
+/* The number of records written before the process lets other
+   processes run. */
+#define BATCH 8
+
+#define BLOCK_SHB 0x0a0d0d0a
+#define BLOCK_IDB 0x00000001
+#define BLOCK_EPB 0x00000006
+
+#define OPT_ENDOFOPT 0
+#define OPT_EPB_FLAGS 2
+
+#define LINKTYPE_RAW 101
+#define LINKTYPE_IEEE802_15_4_NOFCS 230
+
+static FILE *file;
+
+PROCESS(netcapture_pcap_process, "pcapng writer");
+
+/*---------------------------------------------------------------------------*/
+static void
+write32(uint32_t v)
+{
+  fwrite(&v, sizeof(v), 1, file);
+}
+/*---------------------------------------------------------------------------*/
+static void
+write16(uint16_t v)
+{
+  fwrite(&v, sizeof(v), 1, file);
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_idb(uint16_t linktype)
+{
+  write32(BLOCK_IDB);
+  write32(20);
+  write16(linktype);
+  write16(0);
+  write32(NETCAPTURE_SNAPLEN);
+  write32(20);
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_epb(const struct netcapture_record *r)
+{
+  static const uint8_t pad[3];
+  unsigned long long usec;
+  uint32_t padlen, blocklen;
+
+  padlen = (4 - (r->len & 3)) & 3;
+  blocklen = 28 + r->len + padlen + 8 + 4 + 4;
+  usec = (unsigned long long)r->time * 1000000 / CLOCK_SECOND;
+
+  write32(BLOCK_EPB);
+  write32(blocklen);
+  write32(r->iface);
+  write32(usec >> 32);
+  write32(usec & 0xffffffff);
+  write32(r->len);
+  write32(r->origlen);
+  fwrite(r->data, 1, r->len, file);
+  fwrite(pad, 1, padlen, file);
+
+  /* The direction is stored in the lowest bits of the flags. */
+  write16(OPT_EPB_FLAGS);
+  write16(4);
+  write32(r->dir);
+  write16(OPT_ENDOFOPT);
+  write16(0);
+
+  write32(blocklen);
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_records(int max)
+{
+  struct netcapture_record *r;
+  int n;
+
+  for(n = 0; n < max && (r = netcapture_peek()) != NULL; ++n) {
+    write_epb(r);
+    netcapture_remove();
+  }
+  fflush(file);
+  return netcapture_peek() != NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+netcapture_pcap_open(const char *filename)
+{
+  file = fopen(filename, "wb");
+  if(file == NULL) {
+    return 0;
+  }
+
+  /* The section header. The byte order magic lets readers detect the
+     byte order of the host. */
+  write32(BLOCK_SHB);
+  write32(28);
+  write32(0x1a2b3c4d);
+  write16(1);
+  write16(0);
+  write32(0xffffffff);
+  write32(0xffffffff);
+  write32(28);
+
+  write_idb(LINKTYPE_RAW);
+  write_idb(LINKTYPE_IEEE802_15_4_NOFCS);
+  fflush(file);
+
+  process_start(&netcapture_pcap_process, NULL);
+  netcapture_set_consumer(&netcapture_pcap_process);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+netcapture_pcap_close(void)
+{
+  if(file == NULL) {
+    return;
+  }
+  netcapture_set_consumer(NULL);
+  process_exit(&netcapture_pcap_process);
+  while(write_records(BATCH));
+  printf("netcapture: %lu packets dropped\n", netcapture_dropped());
+  fclose(file);
+  file = NULL;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(netcapture_pcap_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    /* Write a few records at a time, so that the file writes do not
+       hold up the processes that forward packets. */
+    while(write_records(BATCH)) {
+      PROCESS_PAUSE();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
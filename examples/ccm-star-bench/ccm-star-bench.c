@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Checks the configured AES-128 driver and CCM* against
+ *         known answers, and measures how many 802.15.4 frames per
+ *         second can be secured and verified with them
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "net/mac/ccm-star.h"
+#include "dev/watchdog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FRAMES      100
+
+/* A maximum size frame with long addresses, a 5-byte auxiliary
+   security header, and ENC-MIC-64. */
+#define HDR_LEN     26
+#define MIC_LEN     8
+#define PAYLOAD_LEN (127 - 2 - HDR_LEN - MIC_LEN)
+
+static uint8_t frame[HDR_LEN + PAYLOAD_LEN + MIC_LEN];
+static uint8_t secured[HDR_LEN + PAYLOAD_LEN + MIC_LEN];
+static uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+
+PROCESS(ccm_star_bench_process, "CCM* benchmark");
+AUTOSTART_PROCESSES(&ccm_star_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+print_result(const char *name, clock_time_t elapsed)
+{
+  if(elapsed == 0) {
+    elapsed = 1;
+  }
+  printf("%s: %u frames in %lu ticks, %lu frames/s\n",
+         name, FRAMES, (unsigned long)elapsed,
+         (unsigned long)FRAMES * CLOCK_SECOND / elapsed);
+}
+/*---------------------------------------------------------------------------*/
+/* The AES-128 example of FIPS-197, appendix C.1. */
+static int
+check_aes(void)
+{
+  static const uint8_t key[AES_128_KEY_LENGTH] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+  };
+  static const uint8_t ciphertext[AES_128_BLOCK_SIZE] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+  };
+  uint8_t block[AES_128_BLOCK_SIZE];
+  uint8_t i;
+
+  for(i = 0; i < AES_128_BLOCK_SIZE; i++) {
+    block[i] = i * 0x11;
+  }
+  AES_128.set_key(key);
+  AES_128.start(block);
+  AES_128.finish(block);
+  return memcmp(block, ciphertext, sizeof(block)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Packet vector #1 of RFC 3610, which is also valid CCM*. */
+static int
+check_ccm_star(void)
+{
+  static const uint8_t key[AES_128_KEY_LENGTH] = {
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+    0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+  };
+  static const uint8_t vector_nonce[CCM_STAR_NONCE_LENGTH] = {
+    0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00,
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5
+  };
+  static const uint8_t result[39] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+    0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+    0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84, 0x17,
+    0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0
+  };
+  uint8_t packet[39];
+  uint8_t i;
+  int ok;
+
+  for(i = 0; i < 31; i++) {
+    packet[i] = i;
+  }
+  AES_128.set_key(key);
+  ccm_star_encrypt(vector_nonce, packet, 8, &packet[8], 23, &packet[31], 8);
+  ok = memcmp(packet, result, sizeof(packet)) == 0;
+  ok = ccm_star_decrypt(vector_nonce, packet, 8, &packet[8], 23,
+                        &packet[31], 8) && ok;
+  for(i = 0; i < 31; i++) {
+    if(packet[i] != i) {
+      ok = 0;
+    }
+  }
+  return ok;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ccm_star_bench_process, ev, data)
+{
+  static const uint8_t key[AES_128_KEY_LENGTH] = {
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+    0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+  };
+  static clock_time_t start;
+  static uint16_t i;
+  static uint16_t bad;
+
+  PROCESS_BEGIN();
+
+  printf("AES-128 FIPS-197 C.1: %s\n", check_aes() ? "pass" : "FAIL");
+  printf("CCM* RFC 3610 vector 1: %s\n", check_ccm_star() ? "pass" : "FAIL");
+
+  for(i = 0; i < sizeof(frame); i++) {
+    frame[i] = i;
+  }
+  AES_128.set_key(key);
+
+  /* Secure frames with a new frame counter each. */
+  start = clock_time();
+  for(i = 0; i < FRAMES; i++) {
+    nonce[11] = i;
+    ccm_star_encrypt(nonce, frame, HDR_LEN, &frame[HDR_LEN], PAYLOAD_LEN,
+                     &frame[HDR_LEN + PAYLOAD_LEN], MIC_LEN);
+    watchdog_periodic();
+  }
+  print_result("encrypt", clock_time() - start);
+
+  PROCESS_PAUSE();
+
+  /* Verify copies of the last frame. The copy takes little time
+     next to the AES blocks. */
+  memcpy(secured, frame, sizeof(frame));
+  bad = 0;
+  start = clock_time();
+  for(i = 0; i < FRAMES; i++) {
+    memcpy(frame, secured, sizeof(frame));
+    if(!ccm_star_decrypt(nonce, frame, HDR_LEN, &frame[HDR_LEN], PAYLOAD_LEN,
+                         &frame[HDR_LEN + PAYLOAD_LEN], MIC_LEN)) {
+      bad++;
+    }
+    watchdog_periodic();
+  }
+  print_result("decrypt", clock_time() - start);
+
+  printf("%u of %u frames failed verification\n", bad, FRAMES);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of Chameleon header construction and parsing
+ *         for the attribute lists of the Rime primitives. Build once
+ *         as is and once with
+ *         DEFINES=CHAMELEON_BITOPT_CONF_COMPILED=1 to compare the
+ *         generic and the compiled chameleon-bitopt modes.
+ */
+
+#include "contiki.h"
+#include "net/rime.h"
+#include "random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ROUNDS 1000
+
+#define BENCH_CHANNEL 200
+
+static const struct packetbuf_attrlist broadcast_attributes[] =
+  { BROADCAST_ATTRIBUTES PACKETBUF_ATTR_LAST };
+static const struct packetbuf_attrlist unicast_attributes[] =
+  { UNICAST_ATTRIBUTES PACKETBUF_ATTR_LAST };
+static const struct packetbuf_attrlist runicast_attributes[] =
+  { RUNICAST_ATTRIBUTES PACKETBUF_ATTR_LAST };
+static const struct packetbuf_attrlist multihop_attributes[] =
+  { MULTIHOP_ATTRIBUTES PACKETBUF_ATTR_LAST };
+static const struct packetbuf_attrlist trickle_attributes[] =
+  { TRICKLE_ATTRIBUTES PACKETBUF_ATTR_LAST };
+static const struct packetbuf_attrlist collect_attributes[] =
+  { COLLECT_ATTRIBUTES PACKETBUF_ATTR_LAST };
+
+static const struct {
+  const char *name;
+  const struct packetbuf_attrlist *attrlist;
+} benchmarks[] = {
+  { "broadcast", broadcast_attributes },
+  { "unicast", unicast_attributes },
+  { "runicast", runicast_attributes },
+  { "multihop", multihop_attributes },
+  { "trickle", trickle_attributes },
+  { "collect", collect_attributes },
+};
+#define NUM_BENCHMARKS ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+static struct channel channels[NUM_BENCHMARKS];
+/*---------------------------------------------------------------------------*/
+PROCESS(example_chameleon_bench_process, "Chameleon benchmark");
+AUTOSTART_PROCESSES(&example_chameleon_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+set_attributes(const struct packetbuf_attrlist *a)
+{
+  rimeaddr_t addr;
+
+  for(; a->type != PACKETBUF_ATTR_NONE; ++a) {
+    if(PACKETBUF_IS_ADDR(a->type)) {
+      rimeaddr_copy(&addr, &rimeaddr_node_addr);
+      addr.u8[0] = random_rand();
+      packetbuf_set_addr(a->type, &addr);
+    } else if(a->len < 16) {
+      packetbuf_set_attr(a->type, random_rand() & ((1 << a->len) - 1));
+    } else {
+      packetbuf_set_attr(a->type, random_rand());
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_attributes(const struct packetbuf_attrlist *a,
+                 const struct packetbuf_attr *attrs,
+                 const struct packetbuf_addr *addrs)
+{
+  for(; a->type != PACKETBUF_ATTR_NONE; ++a) {
+    if(PACKETBUF_IS_ADDR(a->type)) {
+      if(!rimeaddr_cmp(packetbuf_addr(a->type),
+                       &addrs[a->type - PACKETBUF_ADDR_FIRST].addr)) {
+        return 0;
+      }
+    } else if(packetbuf_attr(a->type) != attrs[a->type].val) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_benchmark(int i)
+{
+  static struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  static struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  static uint8_t buf[PACKETBUF_SIZE];
+  unsigned long create_time, parse_time;
+  rtimer_clock_t t;
+  int round, len, errors;
+
+  create_time = parse_time = 0;
+  errors = 0;
+  for(round = 0; round < ROUNDS; ++round) {
+    packetbuf_clear();
+    packetbuf_copyfrom("Chameleon", 10);
+    set_attributes(benchmarks[i].attrlist);
+    packetbuf_attr_copyto(attrs, addrs);
+
+    t = RTIMER_NOW();
+    chameleon_create(&channels[i]);
+    create_time += (rtimer_clock_t)(RTIMER_NOW() - t);
+
+    len = packetbuf_totlen();
+    memcpy(buf, packetbuf_hdrptr(), len);
+    packetbuf_clear();
+    packetbuf_copyfrom(buf, len);
+    /* The link addresses are normally filled in by the MAC layer. */
+    packetbuf_set_addr(PACKETBUF_ADDR_SENDER,
+                       &addrs[PACKETBUF_ADDR_SENDER - PACKETBUF_ADDR_FIRST].addr);
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
+                       &addrs[PACKETBUF_ADDR_RECEIVER - PACKETBUF_ADDR_FIRST].addr);
+
+    t = RTIMER_NOW();
+    chameleon_parse();
+    parse_time += (rtimer_clock_t)(RTIMER_NOW() - t);
+
+    if(!check_attributes(benchmarks[i].attrlist, attrs, addrs)) {
+      ++errors;
+    }
+  }
+
+  printf("%s: hdrsize %d bits, create %lu parse %lu ticks per %d rounds, %d errors\n",
+         benchmarks[i].name, channels[i].hdrsize,
+         create_time, parse_time, ROUNDS, errors);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(example_chameleon_bench_process, ev, data)
+{
+  static struct etimer et;
+  static int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_BENCHMARKS; ++i) {
+    channel_open(&channels[i], BENCH_CHANNEL + i);
+    channel_set_attributes(BENCH_CHANNEL + i, benchmarks[i].attrlist);
+  }
+
+  while(1) {
+    etimer_set(&et, CLOCK_SECOND * 10);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+    printf("Chameleon benchmark, %u ticks per second\n",
+           (unsigned)RTIMER_SECOND);
+    for(i = 0; i < NUM_BENCHMARKS; ++i) {
+      run_benchmark(i);
+      /* Let other processes run between the benchmarks. */
+      PROCESS_PAUSE();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -95,6 +95,7 @@ write_chunk(struct rudolph2_conn *c, int offset, int flag,
     int i;
     printf("+++ rudolph2 entire file received at %d, %d\n",
 	   rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1]);
+    rudolph2_print_stats(c);
     leds_off(LEDS_RED);
     leds_on(LEDS_YELLOW);
 
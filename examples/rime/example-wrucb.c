@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Testing the wrucb code in Rime
+ */
+
+#include "contiki.h"
+#include "net/rime/wrucb.h"
+
+#include "dev/button-sensor.h"
+
+#include "dev/leds.h"
+
+#include "lib/print-stats.h"
+
+#include <stdio.h>
+
+#define FILESIZE 40000
+
+static clock_time_t start_time;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(example_wrucb_process, "Wrucb example");
+AUTOSTART_PROCESSES(&example_wrucb_process);
+/*---------------------------------------------------------------------------*/
+static void
+write_chunk(struct wrucb_conn *c, int offset, int flag,
+	    char *data, int datalen)
+{
+  if(flag == WRUCB_FLAG_NEWFILE) {
+    start_time = clock_time();
+  } else if(flag == WRUCB_FLAG_LASTCHUNK) {
+    printf("Completion time %lu / %u\n",
+           (unsigned long)(clock_time() - start_time), CLOCK_SECOND);
+    printf("Received %d bytes\n", offset + datalen);
+    print_stats();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_chunk(struct wrucb_conn *c, int offset, char *to, int maxsize)
+{
+  int size;
+
+  /* Chunks may be read more than once, so the size only depends on
+     the offset. */
+  size = maxsize;
+  if((long)offset + maxsize >= FILESIZE) {
+    size = FILESIZE - offset;
+  }
+  return size;
+}
+/*---------------------------------------------------------------------------*/
+static void
+timedout(struct wrucb_conn *c)
+{
+  printf("Transfer timed out\n");
+}
+/*---------------------------------------------------------------------------*/
+const static struct wrucb_callbacks wrucb_call = {write_chunk, read_chunk,
+						  timedout};
+static struct wrucb_conn wrucb;
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(example_wrucb_process, ev, data)
+{
+  PROCESS_EXITHANDLER(wrucb_close(&wrucb);)
+  PROCESS_BEGIN();
+
+  PROCESS_PAUSE();
+
+  wrucb_open(&wrucb, 137, &wrucb_call);
+  SENSORS_ACTIVATE(button_sensor);
+
+  PROCESS_PAUSE();
+
+  if(rimeaddr_node_addr.u8[0] == 51 &&
+      rimeaddr_node_addr.u8[1] == 0) {
+    rimeaddr_t recv;
+
+    recv.u8[0] = 52;
+    recv.u8[1] = 0;
+
+    wrucb_send(&wrucb, &recv);
+  }
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == sensors_event &&
+			     data == &button_sensor);
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -73,14 +73,77 @@ static char msg[30 + 10];
 
 static struct rudolph0_conn rudolph0;
 
+#if ELFLOADER_CONF_STREAM
+/* The number of bytes at the start of codeprop.out that have been
+   received and handed to the streaming loader. */
+static unsigned int received;
+static int stream_ret;
+/* Set when a chunk did not start where the previous one ended. The
+   loader cannot skip bytes, so the rest of the transfer is refused. */
+static uint8_t stream_failed;
+#endif /* ELFLOADER_CONF_STREAM */
+
+/*---------------------------------------------------------------------*/
+#if ELFLOADER_CONF_STREAM
+static void
+new_file(void)
+{
+  received = 0;
+  stream_ret = ELFLOADER_STREAM_MORE;
+  stream_failed = 0;
+  elfloader_stream_open();
+}
+/*---------------------------------------------------------------------*/
+static int
+write_file(unsigned int offset, uint8_t *data, int len)
+{
+  int fd;
+
+  if(stream_failed) {
+    return -1;
+  }
+  if(offset > received) {
+    PRINTF("codeprop: chunk at %u, expected %u\n", offset, received);
+    stream_failed = 1;
+    return -1;
+  }
+
+  /* The loader may already have relocated the bytes below received
+     in place, so a retransmitted copy must not be written over them. */
+  if(offset + len <= received) {
+    return 0;
+  }
+  data += received - offset;
+  len -= received - offset;
+
+  fd = cfs_open("codeprop.out", CFS_READ | CFS_WRITE | CFS_APPEND);
+  cfs_seek(fd, received, CFS_SEEK_SET);
+  cfs_write(fd, data, len);
+  received += len;
+  stream_ret = elfloader_stream_data(fd, received);
+  cfs_close(fd);
+  return 0;
+}
+#endif /* ELFLOADER_CONF_STREAM */
 /*---------------------------------------------------------------------*/
 static int
 start_program(void)
 {
   /* Link, load, and start new program. */
   int ret;
+#if ELFLOADER_CONF_STREAM
+  /* The module has been relocated while it was received. */
+  ret = stream_ret;
+  if(ret == ELFLOADER_STREAM_MORE || stream_failed) {
+    /* The file ended, or had a gap, before the loader had all
+       sections. */
+    ret = ELFLOADER_BAD_ELF_HEADER;
+  }
+#else /* ELFLOADER_CONF_STREAM */
   s.fd = cfs_open("codeprop.out", CFS_READ);
   ret = elfloader_load(s.fd);
+  cfs_close(s.fd);
+#endif /* ELFLOADER_CONF_STREAM */
 
   /* XXX: Interrupts seems to be turned off a little too long during the
      ELF loading process, so we need to "manually" trigger a timer
@@ -96,7 +159,6 @@ start_program(void)
     sprintf(msg, "err %d %s", ret, elfloader_unknown);
     PRINTF("Error: '%s'.\n", msg);
   }
-  cfs_close(s.fd);
   return ret;
 }
 /*---------------------------------------------------------------------*/
@@ -125,17 +187,28 @@ PT_THREAD(recv_tcpthread(struct pt *pt))
 
   s.fd = cfs_open("codeprop.out", CFS_WRITE);
   cfs_close(s.fd);
+#if ELFLOADER_CONF_STREAM
+  new_file();
+#endif /* ELFLOADER_CONF_STREAM */
   /*  xmem_erase(XMEM_ERASE_UNIT_SIZE, EEPROMFS_ADDR_CODEPROP);*/
 
   /* Read the rest of the data. */
   do {
     leds_toggle(LEDS_RED);
     if(uip_len > 0) {
+#if ELFLOADER_CONF_STREAM
+      if(write_file(s.addr, uip_appdata, uip_len) < 0) {
+        leds_off(LEDS_RED);
+        uip_abort();
+        goto thread_done;
+      }
+#else /* ELFLOADER_CONF_STREAM */
       s.fd = cfs_open("codeprop.out", CFS_WRITE + CFS_APPEND);
       cfs_seek(s.fd, s.addr, CFS_SEEK_SET);
       /*      xmem_pwrite(uip_appdata, uip_len, EEPROMFS_ADDR_CODEPROP + s.addr);*/
       cfs_write(s.fd, uip_appdata, uip_len);
       cfs_close(s.fd);
+#endif /* ELFLOADER_CONF_STREAM */
       
       PRINTF("Wrote %d bytes to file\n", uip_len);
       s.addr += uip_len;
@@ -207,6 +280,9 @@ write_chunk(struct rudolph0_conn *c, int offset, int flag,
   if(flag == RUDOLPH0_FLAG_NEWFILE) {
     printf("+++ rudolph0 new file incoming at %u\n", clock_time());
     fd = cfs_open("codeprop.out", CFS_WRITE);
+#if ELFLOADER_CONF_STREAM
+    new_file();
+#endif /* ELFLOADER_CONF_STREAM */
     
     if(elfloader_autostart_processes != NULL) {
       PRINTF("Stopping old programs.\n");
@@ -218,6 +294,14 @@ write_chunk(struct rudolph0_conn *c, int offset, int flag,
     fd = cfs_open("codeprop.out", CFS_WRITE + CFS_APPEND);
   }
   
+#if ELFLOADER_CONF_STREAM
+  cfs_close(fd);
+  if(datalen > 0 && !stream_failed &&
+     write_file(offset, data, datalen) < 0) {
+    printf("+++ rudolph0 chunk at %d does not follow %u, transfer aborted\n",
+           offset, received);
+  }
+#else /* ELFLOADER_CONF_STREAM */
   if(datalen > 0) {
     int ret;
     cfs_seek(fd, offset, CFS_SEEK_SET);
@@ -226,6 +310,7 @@ write_chunk(struct rudolph0_conn *c, int offset, int flag,
   }
 
   cfs_close(fd);
+#endif /* ELFLOADER_CONF_STREAM */
 
   if(flag == RUDOLPH0_FLAG_LASTCHUNK) {
     printf("+++ rudolph0 entire file received at %u\n", clock_time());
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Convergecast test for comparing radio duty cycling drivers
+ *
+ *         Every node except the sink sends a sequence-numbered packet
+ *         to the sink with collect at random times, and every node
+ *         periodically prints its accumulated energest times. The
+ *         Cooja test tools/cooja/contiki_tests/sky_rdc.csc uses the
+ *         output to compute delivery latency and radio duty cycle.
+ *         RUN_RDC in the same directory runs it once per RDC driver.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/rime.h"
+#include "net/rime/collect.h"
+#include "net/netstack.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SEND_INTERVAL   (CLOCK_SECOND * 30)
+#define REPORT_INTERVAL (CLOCK_SECOND * 60)
+
+struct test_rdc_msg {
+  uint16_t seqno;
+};
+
+static struct collect_conn tc;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(test_rdc_process, "Test RDC process");
+PROCESS(test_rdc_report_process, "Test RDC report process");
+AUTOSTART_PROCESSES(&test_rdc_process, &test_rdc_report_process);
+/*---------------------------------------------------------------------------*/
+static void
+recv(const rimeaddr_t *originator, uint8_t seqno, uint8_t hops)
+{
+  struct test_rdc_msg msg;
+
+  memcpy(&msg, packetbuf_dataptr(), sizeof(msg));
+  printf("Sink got message from %d.%d, seqno %u, hops %d\n",
+	 originator->u8[0], originator->u8[1], msg.seqno, hops);
+}
+/*---------------------------------------------------------------------------*/
+static const struct collect_callbacks callbacks = { recv };
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_rdc_process, ev, data)
+{
+  static struct etimer periodic;
+  static struct etimer et;
+  static uint16_t seqno;
+
+  PROCESS_BEGIN();
+
+  printf("RDC %s, channel check interval %u\n",
+	 NETSTACK_RDC.name, NETSTACK_RDC.channel_check_interval());
+
+  collect_open(&tc, 130, COLLECT_ROUTER, &callbacks);
+
+  if(rimeaddr_node_addr.u8[0] == 1 &&
+     rimeaddr_node_addr.u8[1] == 0) {
+    printf("I am sink\n");
+    collect_set_sink(&tc, 1);
+    PROCESS_EXIT();
+  }
+
+  /* Allow some time for the network to settle. */
+  etimer_set(&et, 120 * CLOCK_SECOND);
+  PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+  while(1) {
+    struct test_rdc_msg *msg;
+
+    etimer_set(&periodic, SEND_INTERVAL);
+    etimer_set(&et, random_rand() % SEND_INTERVAL);
+    PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+    printf("Sending %u\n", seqno);
+    packetbuf_clear();
+    msg = packetbuf_dataptr();
+    msg->seqno = seqno++;
+    packetbuf_set_datalen(sizeof(struct test_rdc_msg));
+    collect_send(&tc, 15);
+
+    PROCESS_WAIT_UNTIL(etimer_expired(&periodic));
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_rdc_report_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    etimer_set(&et, REPORT_INTERVAL);
+    PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+    energest_flush();
+    printf("Energest %lu %lu %lu %lu\n",
+	   energest_type_time(ENERGEST_TYPE_CPU),
+	   energest_type_time(ENERGEST_TYPE_LPM),
+	   energest_type_time(ENERGEST_TYPE_TRANSMIT),
+	   energest_type_time(ENERGEST_TYPE_LISTEN));
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
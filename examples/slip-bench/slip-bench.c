@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Measures the SLIP receive and transmit paths by looping
+ *         the output of the SLIP driver back into its input
+ */
+
+#include "contiki.h"
+#include "net/uip.h"
+#include "dev/slip.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FRAMES     10000
+#define FRAME_LEN  1000
+
+#define SLIP_END   0300
+#define SLIP_ESC   0333
+
+/*
+ * The number of frames sent back to back. The ring buffer that is
+ * used without SLIP_CONF_RX_FRAMES can only hold two frames if they
+ * are short, so some of these may be dropped.
+ */
+#if defined(SLIP_CONF_RX_FRAMES) && SLIP_CONF_RX_FRAMES > 0
+#define BURST SLIP_CONF_RX_FRAMES
+#else
+#define BURST 2
+#endif
+
+static u8_t frame[FRAME_LEN];
+static unsigned long received, corrupt, bytes;
+
+PROCESS(slip_bench_process, "SLIP benchmark");
+AUTOSTART_PROCESSES(&slip_bench_process);
+/*---------------------------------------------------------------------------*/
+void
+slip_arch_init(unsigned long ubr)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+slip_arch_writeb(unsigned char c)
+{
+  slip_input_byte(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+slip_bench_input(void)
+{
+  if(uip_len == FRAME_LEN &&
+     memcmp(&uip_buf[UIP_LLH_LEN], frame, FRAME_LEN) == 0) {
+    received++;
+    bytes += uip_len;
+  } else {
+    corrupt++;
+  }
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(slip_bench_process, ev, data)
+{
+  static unsigned long sent;
+  static clock_time_t start;
+  clock_time_t elapsed;
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Every 64th byte has to be escaped. */
+  for(i = 0; i < FRAME_LEN; i++) {
+    frame[i] = (i & 63) == 0 ? (i & 64 ? SLIP_END : SLIP_ESC) : i;
+  }
+
+  slip_arch_init(0);
+  process_start(&slip_process, NULL);
+  PROCESS_PAUSE();
+
+  start = clock_time();
+  for(sent = 0; sent < FRAMES;) {
+    for(i = 0; i < BURST && sent < FRAMES; i++, sent++) {
+      slip_write(frame, FRAME_LEN);
+    }
+    /* Let the SLIP process hand the frames over. */
+    PROCESS_PAUSE();
+  }
+  elapsed = clock_time() - start;
+  if(elapsed == 0) {
+    elapsed = 1;
+  }
+
+  printf("%lu frames sent, %lu received, %lu corrupt\n",
+	 sent, received, corrupt);
+  printf("%lu frames/s, %lu bytes/s\n",
+	 received * CLOCK_SECOND / elapsed,
+	 bytes * CLOCK_SECOND / elapsed);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Compares the time it takes to find the TCP connection of an
+ *         incoming segment with a linear search and with the hashed
+ *         demultiplexing of uIP
+ */
+
+#include "contiki.h"
+#include "net/uip.h"
+#include "net/uip-demux.h"
+
+#include <stdio.h>
+
+#define LOOKUPS 10000
+
+PROCESS(uip_demux_bench_process, "uIP demux benchmark");
+AUTOSTART_PROCESSES(&uip_demux_bench_process);
+/*---------------------------------------------------------------------------*/
+static struct uip_conn *
+linear_lookup(const uip_ipaddr_t *ripaddr, u16_t lport, u16_t rport)
+{
+  struct uip_conn *c;
+
+  for(c = &uip_conns[0]; c <= &uip_conns[UIP_CONNS - 1]; ++c) {
+    if(c->tcpstateflags != UIP_CLOSED &&
+       lport == c->lport &&
+       rport == c->rport &&
+       uip_ipaddr_cmp(ripaddr, &c->ripaddr)) {
+      return c;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct uip_conn *
+hashed_lookup(const uip_ipaddr_t *ripaddr, u16_t lport, u16_t rport)
+{
+  struct uip_conn *c;
+
+  for(c = uip_demux_tcp_lookup(ripaddr, lport, rport); c != NULL;
+      c = uip_demux_tcp_next(c)) {
+    if(c->tcpstateflags != UIP_CLOSED &&
+       lport == c->lport &&
+       rport == c->rport &&
+       uip_ipaddr_cmp(ripaddr, &c->ripaddr)) {
+      return c;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name,
+    struct uip_conn *(*lookup)(const uip_ipaddr_t *, u16_t, u16_t),
+    struct uip_conn *last)
+{
+  clock_time_t start, hit, miss;
+  uip_ipaddr_t unknown;
+  unsigned int i;
+
+  /* The last connection is the worst case for a linear search, and a
+     segment that does not belong to any connection has to be checked
+     against all of them. */
+  start = clock_time();
+  for(i = 0; i < LOOKUPS; ++i) {
+    if(lookup(&last->ripaddr, last->lport, last->rport) != last) {
+      printf("%s: lookup failed\n", name);
+      return;
+    }
+  }
+  hit = clock_time() - start;
+
+  uip_ipaddr(&unknown, 10, 1, 1, 1);
+  start = clock_time();
+  for(i = 0; i < LOOKUPS; ++i) {
+    if(lookup(&unknown, last->lport, last->rport) != NULL) {
+      printf("%s: lookup failed\n", name);
+      return;
+    }
+  }
+  miss = clock_time() - start;
+
+  printf("%s: %d connections, %u lookups: %lu ticks found, "
+         "%lu ticks not found (%u ticks/s)\n",
+         name, UIP_CONNS, LOOKUPS, (unsigned long)hit, (unsigned long)miss,
+         CLOCK_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(uip_demux_bench_process, ev, data)
+{
+  static struct uip_conn *last;
+  uip_ipaddr_t addr;
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Fill the connection table. The connections are closed again
+     before uIP gets to run, so no SYNs are sent. */
+  last = NULL;
+  for(i = 0; i < UIP_CONNS; ++i) {
+    uip_ipaddr(&addr, 10, 0, i / 256, i % 256);
+    last = uip_connect(&addr, UIP_HTONS(80));
+    if(last == NULL) {
+      printf("could not open connection %d\n", i);
+      PROCESS_EXIT();
+    }
+  }
+
+  run("linear", linear_lookup, last);
+  run("hashed", hashed_lookup, last);
+
+  for(i = 0; i < UIP_CONNS; ++i) {
+    uip_conns[i].tcpstateflags = UIP_CLOSED;
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
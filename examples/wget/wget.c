@@ -47,6 +47,7 @@ AUTOSTART_PROCESSES(&wget_process);
 
 static int file = -1;
 static char url[128];
+static clock_time_t start_time;
 
 /*-----------------------------------------------------------------------------------*/
 /* Called when the URL present in the global "url" variable should be
@@ -230,6 +231,7 @@ void
 webclient_connected(void)
 {    
   puts("Request sent...");
+  start_time = clock_time();
 }
 /*-----------------------------------------------------------------------------------*/
 /* Callback function. Called from the webclient module when HTTP data
@@ -253,7 +255,12 @@ webclient_datahandler(char *data, u16_t len)
   }
 
   if(data == NULL) {
+    clock_time_t elapsed = clock_time() - start_time;
     printf("Finished downloading %lu bytes.\n", dload_bytes);
+    if(elapsed > 0) {
+      printf("%lu bytes/second\n",
+	     (dload_bytes * CLOCK_SECOND) / (unsigned long)elapsed);
+    }
     app_quit();
   }
 }
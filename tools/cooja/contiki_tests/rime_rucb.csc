@@ -170,6 +170,10 @@
       <script>TIMEOUT(120000);
 
 WAIT_UNTIL(msg.startsWith('Completion time'));
+parts = msg.split(" ");
+ticks = parseInt(parts[2]);
+second = parseInt(parts[4]);
+log.log("Throughput " + Math.floor(40000 * second / ticks) + " bytes/s\n");
 log.testOK();</script>
       <active>true</active>
     </plugin_config>
@@ -0,0 +1,190 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<simconf>
+  <project>../apps/mrm</project>
+  <project>../apps/mspsim</project>
+  <project>../apps/avrora</project>
+  <project>../apps/native_gateway</project>
+  <simulation>
+    <title>My simulation</title>
+    <delaytime>0</delaytime>
+    <randomseed>generated</randomseed>
+    <motedelay_us>1000000</motedelay_us>
+    <radiomedium>
+      se.sics.cooja.radiomediums.UDGM
+      <transmitting_range>25.0</transmitting_range>
+      <interference_range>40.0</interference_range>
+      <success_ratio_tx>0.99</success_ratio_tx>
+      <success_ratio_rx>1.0</success_ratio_rx>
+    </radiomedium>
+    <motetype>
+      se.sics.cooja.contikimote.ContikiMoteType
+      <identifier>mtype296</identifier>
+      <description>Contiki Mote #1</description>
+      <contikiapp>../../../examples/rime/example-wrucb.c</contikiapp>
+      <commands>make example-wrucb.cooja TARGET=cooja</commands>
+      <moteinterface>se.sics.cooja.interfaces.Position</moteinterface>
+      <moteinterface>se.sics.cooja.interfaces.Battery</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiVib</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiMoteID</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiRS232</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiBeeper</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiIPAddress</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiRadio</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiButton</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiPIR</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiClock</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiLED</moteinterface>
+      <moteinterface>se.sics.cooja.contikimote.interfaces.ContikiCFS</moteinterface>
+      <moteinterface>se.sics.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <symbols>false</symbols>
+      <commstack>Rime</commstack>
+    </motetype>
+    <mote>
+      se.sics.cooja.contikimote.ContikiMote
+      <motetype_identifier>mtype296</motetype_identifier>
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>0.0</x>
+        <y>50.00000000000001</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.interfaces.Battery
+        <infinite>false</infinite>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.contikimote.interfaces.ContikiMoteID
+        <id>51</id>
+      </interface_config>
+    </mote>
+    <mote>
+      se.sics.cooja.contikimote.ContikiMote
+      <motetype_identifier>mtype296</motetype_identifier>
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>14.102564102564104</x>
+        <y>45.28301886792453</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.interfaces.Battery
+        <infinite>false</infinite>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.contikimote.interfaces.ContikiMoteID
+        <id>52</id>
+      </interface_config>
+    </mote>
+    <mote>
+      se.sics.cooja.contikimote.ContikiMote
+      <motetype_identifier>mtype296</motetype_identifier>
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>-32.16814655285737</x>
+        <y>42.92182758760039</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.interfaces.Battery
+        <infinite>false</infinite>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.contikimote.interfaces.ContikiMoteID
+        <id>53</id>
+      </interface_config>
+    </mote>
+    <mote>
+      se.sics.cooja.contikimote.ContikiMote
+      <motetype_identifier>mtype296</motetype_identifier>
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>-1.5917258339289355</x>
+        <y>37.3750708005199</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.interfaces.Battery
+        <infinite>false</infinite>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.contikimote.interfaces.ContikiMoteID
+        <id>54</id>
+      </interface_config>
+    </mote>
+    <mote>
+      se.sics.cooja.contikimote.ContikiMote
+      <motetype_identifier>mtype296</motetype_identifier>
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>26.334899854939632</x>
+        <y>53.05390331866741</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.interfaces.Battery
+        <infinite>false</infinite>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.contikimote.interfaces.ContikiMoteID
+        <id>55</id>
+      </interface_config>
+    </mote>
+  </simulation>
+  <plugin>
+    se.sics.cooja.plugins.SimControl
+    <width>265</width>
+    <z>3</z>
+    <height>200</height>
+    <location_x>0</location_x>
+    <location_y>0</location_y>
+    <minimized>false</minimized>
+  </plugin>
+  <plugin>
+    se.sics.cooja.plugins.LogListener
+    <plugin_config>
+      <filter />
+    </plugin_config>
+    <width>798</width>
+    <z>2</z>
+    <height>289</height>
+    <location_x>0</location_x>
+    <location_y>354</location_y>
+    <minimized>false</minimized>
+  </plugin>
+  <plugin>
+    se.sics.cooja.plugins.Visualizer
+    <plugin_config>
+      <skin>Mote IDs</skin>
+      <skin>Radio environment (UDGM)</skin>
+    </plugin_config>
+    <width>265</width>
+    <z>0</z>
+    <height>155</height>
+    <location_x>0</location_x>
+    <location_y>200</location_y>
+    <minimized>false</minimized>
+  </plugin>
+  <plugin>
+    se.sics.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <script>TIMEOUT(120000);
+
+/* Same setup as rime_rucb.csc: a 40000 byte file from mote 51 to
+   mote 52. Completion time is printed as "ticks / ticks per second". */
+WAIT_UNTIL(msg.startsWith('Completion time'));
+parts = msg.split(" ");
+ticks = parseInt(parts[2]);
+second = parseInt(parts[4]);
+log.log("Throughput " + Math.floor(40000 * second / ticks) + " bytes/s\n");
+log.testOK();</script>
+      <active>true</active>
+    </plugin_config>
+    <width>534</width>
+    <z>1</z>
+    <height>354</height>
+    <location_x>264</location_x>
+    <location_y>0</location_y>
+    <minimized>false</minimized>
+  </plugin>
+</simconf>
+
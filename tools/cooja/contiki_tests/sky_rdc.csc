@@ -0,0 +1,301 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<simconf>
+  <simulation>
+    <title>RDC comparison</title>
+    <delaytime>0</delaytime>
+    <randomseed>generated</randomseed>
+    <motedelay_us>1000000</motedelay_us>
+    <radiomedium>
+      se.sics.cooja.radiomediums.UDGM
+      <transmitting_range>50.0</transmitting_range>
+      <interference_range>50.0</interference_range>
+      <success_ratio_tx>1.0</success_ratio_tx>
+      <success_ratio_rx>1.0</success_ratio_rx>
+    </radiomedium>
+    <events>
+      <logoutput>400000</logoutput>
+    </events>
+    <motetype>
+      se.sics.cooja.mspmote.SkyMoteType
+      <identifier>sky1</identifier>
+      <description>Sky Mote Type #1</description>
+      <source EXPORT="discard">[CONTIKI_DIR]/examples/sky/test-rdc.c</source>
+      <commands EXPORT="discard">make clean TARGET=sky
+make test-rdc.sky TARGET=sky</commands>
+      <firmware EXPORT="copy">[CONTIKI_DIR]/examples/sky/test-rdc.sky</firmware>
+      <moteinterface>se.sics.cooja.interfaces.Position</moteinterface>
+      <moteinterface>se.sics.cooja.interfaces.IPAddress</moteinterface>
+      <moteinterface>se.sics.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.MspClock</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.MspMoteID</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.SkyButton</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.SkyFlash</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.SkyByteRadio</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.MspSerial</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.SkyLED</moteinterface>
+      <moteinterface>se.sics.cooja.interfaces.RimeAddress</moteinterface>
+      <moteinterface>se.sics.cooja.interfaces.MoteAttributes</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.SkyCoffeeFilesystem</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.MspDebugOutput</moteinterface>
+      <moteinterface>se.sics.cooja.mspmote.interfaces.SkyTemperature</moteinterface>
+    </motetype>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>87.29845932913939</x>
+        <y>60.286214311723164</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>1</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>94.30809966340686</x>
+        <y>22.50388779326399</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>2</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>82.40423567500785</x>
+        <y>39.56979106929553</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>3</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>26.185019854469438</x>
+        <y>4.800834369523899</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>4</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>1.9530156130507015</x>
+        <y>78.3175061800706</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>5</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>48.35216700543414</x>
+        <y>80.36988713780997</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>6</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>24.825985087266833</x>
+        <y>74.27809432062487</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>7</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>8.356165164293616</x>
+        <y>94.33967355724187</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>8</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>45.11740613004886</x>
+        <y>31.7059041432301</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>9</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        se.sics.cooja.interfaces.Position
+        <x>68.9908548386292</x>
+        <y>55.01991960639596</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        se.sics.cooja.mspmote.interfaces.MspMoteID
+        <id>10</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+  </simulation>
+  <plugin>
+    se.sics.cooja.plugins.SimControl
+    <width>247</width>
+    <z>3</z>
+    <height>227</height>
+    <location_x>0</location_x>
+    <location_y>0</location_y>
+  </plugin>
+  <plugin>
+    se.sics.cooja.plugins.Visualizer
+    <plugin_config>
+      <skin>se.sics.cooja.plugins.skins.IDVisualizerSkin</skin>
+      <skin>se.sics.cooja.plugins.skins.UDGMVisualizerSkin</skin>
+      <viewport>1.685403700540615 0.0 0.0 1.685403700540615 23.872012513439184 -0.545889466623605</viewport>
+    </plugin_config>
+    <width>224</width>
+    <z>2</z>
+    <height>225</height>
+    <location_x>247</location_x>
+    <location_y>1</location_y>
+  </plugin>
+  <plugin>
+    se.sics.cooja.plugins.LogListener
+    <plugin_config>
+      <filter />
+      <formatted_time />
+    </plugin_config>
+    <width>469</width>
+    <z>0</z>
+    <height>473</height>
+    <location_x>0</location_x>
+    <location_y>226</location_y>
+  </plugin>
+  <plugin>
+    se.sics.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <script>TIMEOUT(1800000);
+
+/* Number of packets each node must deliver to the sink. */
+PACKETS = 5;
+
+num_nodes = mote.getSimulation().getMotesCount();
+sink = 1;
+
+sent = new Array();
+received = new Array();
+energest = new Array();
+latency_sum = 0;
+latency_count = 0;
+
+for(i = 1; i &lt;= num_nodes; i++) {
+    sent[i] = new Array();
+    received[i] = 0;
+}
+
+function print_stats() {
+  duty_cycle_sum = 0;
+  duty_cycle_count = 0;
+  for(i = 1; i &lt;= num_nodes; i++) {
+    e = energest[i];
+    if(e) {
+      duty_cycle_sum += 100 * (e[2] + e[3]) / (e[0] + e[1]);
+      duty_cycle_count++;
+    }
+  }
+  log.log("Delivered " + latency_count + " packets, average latency " +
+          Math.round(latency_sum / latency_count / 1000) + " ms\n");
+  if(duty_cycle_count &gt; 0) {
+    log.log("Average radio duty cycle " +
+            (duty_cycle_sum / duty_cycle_count).toFixed(2) + " %\n");
+  }
+}
+
+log.log("Simulation has " + num_nodes + " nodes\n");
+
+while(true) {
+  YIELD();
+  log.log(time + " " + id + " " + msg + "\n");
+
+  if(msg.startsWith("Sending ")) {
+    sent[id][parseInt(msg.split(" ")[1])] = time;
+  } else if(msg.startsWith("Sink got message")) {
+    source = parseInt(msg.split(" ")[4]);
+    seqno = parseInt(msg.split(" ")[6]);
+    if(sent[source] &amp;&amp; sent[source][seqno] != undefined) {
+      /* Count each packet once, even if it is duplicated. */
+      latency_sum += time - sent[source][seqno];
+      latency_count++;
+      received[source]++;
+      sent[source][seqno] = undefined;
+    }
+  } else if(msg.startsWith("Energest ")) {
+    e = msg.split(" ");
+    energest[id] = new Array(parseInt(e[1]), parseInt(e[2]),
+                             parseInt(e[3]), parseInt(e[4]));
+  }
+
+  /* Signal OK when all nodes have delivered enough packets. */
+  done = true;
+  for(i = 1; i &lt;= num_nodes; i++) {
+    if(i != sink &amp;&amp; received[i] &lt; PACKETS) {
+      done = false;
+    }
+  }
+  if(done) {
+    print_stats();
+    log.testOK();
+  }
+}</script>
+      <active>true</active>
+    </plugin_config>
+    <width>600</width>
+    <z>1</z>
+    <height>700</height>
+    <location_x>469</location_x>
+    <location_y>0</location_y>
+  </plugin>
+</simconf>
+
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2011, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/*
+ * Rewrite a 32-bit little-endian ELF relocatable object so that its
+ * parts appear in the order that the streaming ELF loader
+ * (elfloader_stream_data()) can use them while the file is being
+ * received:
+ *
+ *   ELF header, section header table, section names, symbol table,
+ *   symbol names, then each loaded section (code, read-only data,
+ *   writable data) directly followed by its relocation section, and
+ *   finally all other sections.
+ *
+ * Only file offsets change; section numbers and contents are kept,
+ * so the result is an equivalent object file.
+ *
+ * Usage: elf-stream-order infile outfile
+ *
+ * Build with "make elf-stream-order" in the tools directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EHDR_SIZE      52
+#define SHT_SYMTAB     2
+#define SHT_RELA       4
+#define SHT_NOBITS     8
+#define SHT_REL        9
+#define SHF_WRITE      0x1
+#define SHF_ALLOC      0x2
+#define SHF_EXECINSTR  0x4
+
+static unsigned char *in, *out;
+static unsigned long insize, outsize;
+static unsigned int shoff, shentsize, shnum, shstrndx;
+static int *order, norder;
+
+/*---------------------------------------------------------------------------*/
+static unsigned int
+get(unsigned char *p, int len)
+{
+  unsigned int v = 0;
+  while(len-- > 0) {
+    v = (v << 8) | p[len];
+  }
+  return v;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put(unsigned char *p, int len, unsigned int v)
+{
+  while(len-- > 0) {
+    *p++ = v & 0xff;
+    v >>= 8;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned char *
+shdr(int i)
+{
+  return &in[shoff + i * shentsize];
+}
+#define SH_TYPE(i)      get(shdr(i) + 4, 4)
+#define SH_FLAGS(i)     get(shdr(i) + 8, 4)
+#define SH_OFFSET(i)    get(shdr(i) + 16, 4)
+#define SH_SIZE(i)      get(shdr(i) + 20, 4)
+#define SH_LINK(i)      get(shdr(i) + 24, 4)
+#define SH_INFO(i)      get(shdr(i) + 28, 4)
+#define SH_ADDRALIGN(i) get(shdr(i) + 32, 4)
+/*---------------------------------------------------------------------------*/
+static void
+add(int i)
+{
+  int j;
+
+  if(i <= 0 || i >= shnum) {
+    return;
+  }
+  for(j = 0; j < norder; ++j) {
+    if(order[j] == i) {
+      return;
+    }
+  }
+  order[norder++] = i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_loaded(int rank)
+{
+  int i, j, r;
+
+  for(i = 1; i < shnum; ++i) {
+    if(!(SH_FLAGS(i) & SHF_ALLOC)) {
+      continue;
+    }
+    if(SH_FLAGS(i) & SHF_EXECINSTR) {
+      r = 0;
+    } else if(!(SH_FLAGS(i) & SHF_WRITE)) {
+      r = 1;
+    } else {
+      r = 2;
+    }
+    if(r != rank) {
+      continue;
+    }
+    add(i);
+    for(j = 1; j < shnum; ++j) {
+      if((SH_TYPE(j) == SHT_REL || SH_TYPE(j) == SHT_RELA) &&
+	 SH_INFO(j) == i) {
+	add(j);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  FILE *f;
+  unsigned long off, align, newshoff;
+  int i, n, symtab;
+
+  if(argc != 3) {
+    fprintf(stderr, "usage: %s infile outfile\n", argv[0]);
+    return 1;
+  }
+
+  f = fopen(argv[1], "rb");
+  if(f == NULL) {
+    perror(argv[1]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  insize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  in = malloc(insize);
+  if(in == NULL || fread(in, 1, insize, f) != insize) {
+    fprintf(stderr, "%s: read error\n", argv[1]);
+    return 1;
+  }
+  fclose(f);
+
+  if(insize < EHDR_SIZE || memcmp(in, "\177ELF\001\001", 6) != 0) {
+    fprintf(stderr, "%s: not a 32-bit little-endian ELF file\n", argv[1]);
+    return 1;
+  }
+  if(get(&in[16], 2) != 1 || get(&in[44], 2) != 0) {
+    fprintf(stderr, "%s: not a relocatable object\n", argv[1]);
+    return 1;
+  }
+
+  shoff = get(&in[32], 4);
+  shentsize = get(&in[46], 2);
+  shnum = get(&in[48], 2);
+  shstrndx = get(&in[50], 2);
+  if(shoff + shentsize * shnum > insize) {
+    fprintf(stderr, "%s: bad section header table\n", argv[1]);
+    return 1;
+  }
+
+  order = malloc(shnum * sizeof(int));
+  norder = 0;
+
+  symtab = 0;
+  for(i = 1; i < shnum; ++i) {
+    if(SH_TYPE(i) == SHT_SYMTAB) {
+      symtab = i;
+    }
+  }
+
+  add(shstrndx);
+  if(symtab != 0) {
+    add(symtab);
+    add(SH_LINK(symtab));
+  }
+  for(n = 0; n < 3; ++n) {
+    add_loaded(n);
+  }
+  for(i = 1; i < shnum; ++i) {
+    add(i);
+  }
+
+  /* Lay out the new file. */
+  off = EHDR_SIZE;
+  off = (off + 3) & ~3UL;
+  outsize = off + shentsize * shnum;
+  for(n = 0; n < norder; ++n) {
+    i = order[n];
+    if(SH_TYPE(i) != SHT_NOBITS) {
+      outsize += SH_ADDRALIGN(i) + SH_SIZE(i);
+    }
+  }
+  out = calloc(1, outsize);
+
+  memcpy(out, in, EHDR_SIZE);
+  memcpy(&out[off], &in[shoff], shentsize * shnum);
+  put(&out[32], 4, off);
+  newshoff = off;
+  off += shentsize * shnum;
+
+  for(n = 0; n < norder; ++n) {
+    i = order[n];
+    if(SH_TYPE(i) == SHT_NOBITS) {
+      continue;
+    }
+    align = SH_ADDRALIGN(i);
+    if(align > 1) {
+      off = (off + align - 1) / align * align;
+    }
+    memcpy(&out[off], &in[SH_OFFSET(i)], SH_SIZE(i));
+    put(&out[newshoff + i * shentsize + 16], 4, off);
+    off += SH_SIZE(i);
+  }
+
+  f = fopen(argv[2], "wb");
+  if(f == NULL) {
+    perror(argv[2]);
+    return 1;
+  }
+  fwrite(out, 1, off, f);
+  fclose(f);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/